@@ -0,0 +1,140 @@
+#include "bench.hpp"
+#include <random>
+#include <algorithm>
+
+// Moves entities by their velocity. Every entity has a position and a velocity and
+// a third also have health. Half the entities are destroyed and created again in a
+// random order first, the way a running game churns them. The per-type run keeps
+// every component in its type's RDA pool and an entity as pointers to them, the
+// archetype run keeps them in archetype_storage_t and walks a query
+
+constexpr size_t entity_count = 1000000;
+constexpr int    passes       = 20;
+
+struct position_t {
+    float x, y, z;
+};
+
+struct velocity_t {
+    float x, y, z;
+};
+
+struct health_t {
+    float value;
+};
+
+struct pooled_entity_t {
+    position_t* position;
+    velocity_t* velocity;
+    health_t*   health;
+};
+
+void create(ptm::rda_t& rda, pooled_entity_t& entity, size_t i) {
+    entity.position = rda.create<position_t>(1, position_t{(float)i, 0.0f, 0.0f});
+    entity.velocity = rda.create<velocity_t>(1, velocity_t{1.0f, 0.5f, 0.25f});
+    entity.health   = i % 3 == 0 ? rda.create<health_t>(1, health_t{100.0f}) : nullptr;
+}
+
+void destroy(ptm::rda_t& rda, pooled_entity_t& entity) {
+    rda.destroy(entity.position, 1);
+    rda.destroy(entity.velocity, 1);
+    if(entity.health)
+        rda.destroy(entity.health, 1);
+}
+
+ptm::entity_t create(ptm::archetype_storage_t& storage, size_t i) {
+    ptm::entity_t entity = storage.create();
+
+    storage.add<position_t>(entity, position_t{(float)i, 0.0f, 0.0f});
+    storage.add<velocity_t>(entity, velocity_t{1.0f, 0.5f, 0.25f});
+    if(i % 3 == 0)
+        storage.add<health_t>(entity, health_t{100.0f});
+
+    return entity;
+}
+
+std::vector<size_t> churn_order() {
+    std::vector<size_t> order;
+    for(size_t i = 0; i < entity_count; i += 2)
+        order.push_back(i);
+
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(5));
+    return order;
+}
+
+int main() {
+    std::vector<size_t> order = churn_order();
+
+    {
+        ptm::rda_t rda;
+        rda.register_type<position_t>(entity_count);
+        rda.register_type<velocity_t>(entity_count);
+        rda.register_type<health_t>(entity_count);
+
+        std::vector<pooled_entity_t> entities(entity_count);
+        for(size_t i = 0; i < entity_count; i++)
+            create(rda, entities[i], i);
+
+        for(size_t i : order)
+            destroy(rda, entities[i]);
+        for(size_t i : order)
+            create(rda, entities[i], i);
+
+        double seconds = bench::time([&]() {
+            for(int pass = 0; pass < passes; pass++) {
+                for(pooled_entity_t& entity : entities) {
+                    entity.position->x += entity.velocity->x;
+                    entity.position->y += entity.velocity->y;
+                    entity.position->z += entity.velocity->z;
+                }
+            }
+        });
+        bench::do_not_optimize(entities[1].position->x);
+        bench::report("iterate, per-type RDA pools", seconds, entity_count * passes);
+
+        for(pooled_entity_t& entity : entities)
+            destroy(rda, entity);
+    }
+
+    {
+        ptm::rda_t rda;
+        rda.register_type<position_t>(1);
+        rda.register_type<velocity_t>(1);
+        rda.register_type<health_t>(1);
+
+        ptm::archetype_storage_t storage(rda, entity_count * sizeof(pooled_entity_t) / ptm::archetype_t::chunk_bytesize);
+
+        std::vector<ptm::entity_t> entities(entity_count);
+        for(size_t i = 0; i < entity_count; i++)
+            entities[i] = create(storage, i);
+
+        for(size_t i : order)
+            storage.destroy(entities[i]);
+        for(size_t i : order)
+            entities[i] = create(storage, i);
+
+        ptm::query_t<position_t, velocity_t> query(storage);
+
+        double seconds = bench::time([&]() {
+            for(int pass = 0; pass < passes; pass++) {
+                query.each([](position_t& position, velocity_t& velocity) {
+                    position.x += velocity.x;
+                    position.y += velocity.y;
+                    position.z += velocity.z;
+                });
+            }
+        });
+        bench::do_not_optimize(storage.get<position_t>(entities[1])->x);
+        bench::report("iterate, archetype_storage_t query", seconds, entity_count * passes);
+
+        seconds = bench::time([&]() {
+            for(size_t i = 0; i < entity_count; i += 3)
+                storage.remove<health_t>(entities[i]);
+            for(size_t i = 0; i < entity_count; i += 3)
+                storage.add<health_t>(entities[i], health_t{100.0f});
+        });
+        bench::report("move between archetypes", seconds, (entity_count / 3) * 2);
+    }
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "bench.hpp"
+
+// Creates and destroys objects in batches, freeing every other one first so the
+// pools have holes to fit into, with object_pool_t as the baseline and a few
+// basic_pool_t configurations. The policies that are not picked cost nothing,
+// so the default basic_pool_t should keep up with object_pool_t
+
+struct object_t {
+    uint64_t data[8];
+};
+
+constexpr size_t batch_size = 1024;
+constexpr size_t batches    = 10000;
+constexpr size_t operations = batch_size * batches * 2;
+
+template<typename create_t, typename destroy_t>
+double churn(create_t&& create, destroy_t&& destroy) {
+    std::vector<object_t*> objects(batch_size);
+
+    return bench::time([&]() {
+        for(size_t batch = 0; batch < batches; batch++) {
+            for(size_t i = 0; i < batch_size; i++)
+                objects[i] = create();
+
+            bench::do_not_optimize(objects.data());
+
+            for(size_t i = 0; i < batch_size; i += 2)
+                destroy(objects[i]);
+            for(size_t i = 1; i < batch_size; i += 2)
+                destroy(objects[i]);
+        }
+    });
+}
+
+template<typename pool_t>
+void run(const char* name) {
+    pool_t pool(batch_size);
+    double seconds = churn([&]() { return pool.create(); }, [&](object_t* object) { pool.destroy(object); });
+
+    bench::report(name, seconds, operations);
+}
+
+int main() {
+    namespace policy = ptm::pool_policy;
+
+    {
+        ptm::object_pool_t<object_t> pool(batch_size);
+        double seconds = churn([&]() { return pool.create(1); }, [&](object_t* object) { pool.destroy(object, 1); });
+
+        bench::report("object_pool_t", seconds, operations);
+    }
+
+    run<ptm::basic_pool_t<object_t>>("basic_pool_t first fit");
+    run<ptm::basic_pool_t<object_t, policy::next_fit_t>>("basic_pool_t next fit");
+    run<ptm::basic_pool_t<object_t, policy::best_fit_t>>("basic_pool_t best fit");
+    run<ptm::basic_pool_t<object_t, policy::counted_stats_t>>("basic_pool_t counted stats");
+    run<ptm::basic_pool_t<object_t, policy::mutex_locked_t>>("basic_pool_t mutex locked");
+    run<ptm::basic_pool_t<object_t, policy::lock_free_t>>("basic_pool_t lock free");
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <ptm/portem.hpp>
+#include <chrono>
+#include <stdio.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+namespace bench {
+    using clock_t = std::chrono::steady_clock;
+
+    // runs func once and returns how long it took in seconds
+    template<typename func_t>
+    double time(func_t&& func) {
+        auto begin = clock_t::now();
+        func();
+        auto end = clock_t::now();
+
+        return std::chrono::duration<double>(end - begin).count();
+    }
+
+    inline void report(const char* name, double seconds, size_t operations) {
+        printf("%-40s %10.3f ms %10.2f ns/op\n", name, seconds * 1e3, seconds * 1e9 / (double)operations);
+    }
+
+    // keeps the compiler from optimizing value away
+    template<typename T>
+    inline void do_not_optimize(T const& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Counts a hardware event of this thread, like cache misses, between start and
+    // stop. Many machines don't give access to the counters, virtual machines and
+    // systems where perf_event_paranoid forbids it, valid() is false on those and
+    // on systems other than Linux
+    class event_counter_t {
+    public:
+        // type and config as in perf_event_attr, e.g. PERF_TYPE_HARDWARE and PERF_COUNT_HW_CACHE_MISSES
+        event_counter_t(uint32_t type, uint64_t config) {
+#if defined(__linux__)
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size           = sizeof(attr);
+            attr.type           = type;
+            attr.config         = config;
+            attr.disabled       = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+
+            fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+        }
+
+        ~event_counter_t() {
+#if defined(__linux__)
+            if(fd >= 0)
+                close(fd);
+#endif
+        }
+
+        event_counter_t(const event_counter_t&) = delete;
+        event_counter_t& operator=(const event_counter_t&) = delete;
+
+        bool valid() { return fd >= 0; }
+
+        void start() {
+#if defined(__linux__)
+            if(fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        // the events since start, 0 if the counter is not valid
+        uint64_t stop() {
+            uint64_t count = 0;
+#if defined(__linux__)
+            if(fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if(read(fd, &count, sizeof(count)) != sizeof(count))
+                    count = 0;
+            }
+#endif
+            return count;
+        }
+
+    private:
+        int fd = -1;
+    };
+}
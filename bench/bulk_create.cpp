@@ -0,0 +1,80 @@
+#include "bench.hpp"
+
+// Creates and destroys arrays of 10k POD structs. The per element loop is
+// what object_pool_t::create used to do, a memset is the floor
+
+struct pod_t {
+    uint64_t id;
+    float    position[3];
+    uint32_t flags;
+};
+
+constexpr size_t array_size = 10000;
+constexpr size_t repeats    = 2000;
+
+int main() {
+    {
+        ptm::memory_pool_t<pod_t> pool(array_size);
+        pod_t value = {1, {1.0f, 2.0f, 3.0f}, 4};
+
+        double seconds = bench::time([&]() {
+            for(size_t repeat = 0; repeat < repeats; repeat++) {
+                pod_t* elements = pool.allocate(array_size);
+                for(size_t i = 0; i < array_size; i++) {
+                    pool.construct(&elements[i], value);
+                }
+                bench::do_not_optimize(elements);
+
+                for(size_t i = 0; i < array_size; i++) {
+                    pool.destroy(&elements[i]);
+                }
+                pool.deallocate(elements, array_size);
+            }
+        });
+
+        bench::report("per element construct", seconds, repeats);
+    }
+
+    {
+        ptm::object_pool_t<pod_t> pool(array_size);
+
+        double seconds = bench::time([&]() {
+            for(size_t repeat = 0; repeat < repeats; repeat++) {
+                pod_t* elements = pool.create(array_size, pod_t{1, {1.0f, 2.0f, 3.0f}, 4});
+                bench::do_not_optimize(elements);
+                pool.destroy(elements, array_size);
+            }
+        });
+
+        bench::report("create, copy broadcast", seconds, repeats);
+    }
+
+    {
+        ptm::object_pool_t<pod_t> pool(array_size);
+
+        double seconds = bench::time([&]() {
+            for(size_t repeat = 0; repeat < repeats; repeat++) {
+                pod_t* elements = pool.create(array_size);
+                bench::do_not_optimize(elements);
+                pool.destroy(elements, array_size);
+            }
+        });
+
+        bench::report("create, zeroed", seconds, repeats);
+    }
+
+    {
+        std::vector<pod_t> elements(array_size);
+
+        double seconds = bench::time([&]() {
+            for(size_t repeat = 0; repeat < repeats; repeat++) {
+                memset((void*)elements.data(), 0, array_size * sizeof(pod_t));
+                bench::do_not_optimize(elements.data());
+            }
+        });
+
+        bench::report("memset", seconds, repeats);
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "bench.hpp"
+#include <random>
+
+// Allocates and frees blocks of random sizes, most of them small. The composed
+// allocator routes them through a segregator and a bucketizer of pools, the
+// hand written one does the same with an if and an array of pools
+
+constexpr size_t live_blocks = 4096;
+constexpr size_t operations  = 10000000;
+
+using composed_t = ptm::segregator_t<256, ptm::bucketizer_t<ptm::pool_allocator_t, 0, 256, 32>, ptm::malloc_allocator_t>;
+
+struct hand_written_t {
+    ptm::_impl_sparse_memory_pool_t pools[8] = {
+        {32}, {64}, {96}, {128}, {160}, {192}, {224}, {256}
+    };
+
+    void* allocate(size_t bytesize) {
+        if(bytesize <= 256)
+            return pools[(bytesize - 1) / 32].allocate(1);
+
+        return malloc(bytesize);
+    }
+
+    void deallocate(void* ptr, size_t bytesize) {
+        if(bytesize <= 256) {
+            pools[(bytesize - 1) / 32].deallocate(ptr, 1);
+        } else {
+            free(ptr);
+        }
+    }
+};
+
+template<typename allocator_t>
+double run(allocator_t& allocator) {
+    std::mt19937 random(4);
+    std::vector<std::pair<void*, size_t>> blocks(live_blocks, {nullptr, 0});
+
+    auto size_of = [&]() -> size_t {
+        // one in 16 blocks is big
+        return random() % 16 ? 1 + random() % 256 : 257 + random() % 4096;
+    };
+
+    return bench::time([&]() {
+        for(size_t i = 0; i < operations; i++) {
+            auto& block = blocks[random() % live_blocks];
+
+            if(block.first)
+                allocator.deallocate(block.first, block.second);
+
+            block.second = size_of();
+            block.first  = allocator.allocate(block.second);
+            bench::do_not_optimize(block.first);
+        }
+
+        for(auto& block : blocks) {
+            if(block.first)
+                allocator.deallocate(block.first, block.second);
+        }
+    });
+}
+
+int main() {
+    {
+        ptm::malloc_allocator_t allocator;
+        bench::report("malloc", run(allocator), operations);
+    }
+
+    {
+        hand_written_t allocator;
+        bench::report("hand written if + pools", run(allocator), operations);
+    }
+
+    {
+        composed_t allocator;
+        bench::report("segregator + bucketizer", run(allocator), operations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "bench.hpp"
+#include <algorithm>
+#include <random>
+
+// Walks a linked list whose nodes are linked in a random order, once with
+// 8 byte pointers and once with 32 bit pool_ptr_t. Smaller nodes mean more of
+// them per cache line and page, so fewer cache and TLB misses on the walk. The
+// misses are counted with the hardware counters where the system allows it
+
+struct raw_node_t {
+    uint32_t    value;
+    raw_node_t* next;
+};
+
+struct compressed_node_t;
+using compressed_pool_t = ptm::compressed_object_pool_t<compressed_node_t>;
+
+struct compressed_node_t {
+    uint32_t value;
+    compressed_pool_t::pointer_t next;
+};
+
+constexpr size_t node_count = 1 << 23;
+
+template<typename node_t, typename create_t>
+node_t* build_list(const std::vector<uint32_t>& order, create_t&& create) {
+    std::vector<node_t*> nodes(node_count);
+
+    for(size_t i = 0; i < node_count; i++) {
+        nodes[i] = create();
+        nodes[i]->value = (uint32_t)i;
+    }
+
+    for(size_t i = 0; i + 1 < node_count; i++)
+        nodes[order[i]]->next = nodes[order[i + 1]];
+    nodes[order.back()]->next = nullptr;
+
+    return nodes[order.front()];
+}
+
+template<typename node_t>
+uint64_t walk(node_t* head) {
+    uint64_t sum = 0;
+
+    for(node_t* node = head; node; node = (node_t*)node->next) {
+        sum += node->value;
+    }
+
+    return sum;
+}
+
+int main() {
+    std::vector<uint32_t> order(node_count);
+    for(size_t i = 0; i < node_count; i++)
+        order[i] = (uint32_t)i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    ptm::reserved_memory_pool_t<raw_node_t> raw_pool(node_count);
+    raw_node_t* raw_head = build_list<raw_node_t>(order, [&]() { return raw_pool.allocate(1); });
+
+    compressed_pool_t compressed_pool(node_count);
+    compressed_node_t* compressed_head = build_list<compressed_node_t>(order, [&]() { return compressed_pool.create().get(); });
+
+    printf("%-40s %10zu bytes\n", "raw node", sizeof(raw_node_t));
+    printf("%-40s %10zu bytes\n", "compressed node", sizeof(compressed_node_t));
+
+#if defined(__linux__)
+    bench::event_counter_t cache_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    bench::event_counter_t tlb_misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+    bench::event_counter_t cache_misses(0, 0);
+    bench::event_counter_t tlb_misses(0, 0);
+#endif
+
+    if(!cache_misses.valid())
+        printf("cache misses can't be counted here, the hardware counters are not available\n");
+
+    auto measure = [&](const char* name, auto&& func) {
+        cache_misses.start();
+        tlb_misses.start();
+        double seconds = bench::time(func);
+        uint64_t misses = cache_misses.stop();
+        uint64_t tlb    = tlb_misses.stop();
+
+        bench::report(name, seconds, node_count);
+        if(cache_misses.valid())
+            printf("%-40s %10.3f per node\n", "    cache misses", (double)misses / node_count);
+        if(tlb_misses.valid())
+            printf("%-40s %10.3f per node\n", "    dTLB load misses", (double)tlb / node_count);
+    };
+
+    measure("walk with raw pointers", [&]() { bench::do_not_optimize(walk(raw_head)); });
+    measure("walk with pool_ptr_t", [&]() { bench::do_not_optimize(walk(compressed_head)); });
+
+    return 0;
+}
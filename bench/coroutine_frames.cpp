@@ -0,0 +1,58 @@
+#include "bench.hpp"
+#include <coroutine>
+
+// Spawns millions of short lived coroutines, once with frames from
+// the global heap and once with frames from coroutine_frame_pool_t
+
+template<typename base_t>
+struct task_t {
+    struct promise_type : base_t {
+        uint64_t value = 0;
+
+        task_t get_return_object() { return task_t{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_value(uint64_t result) { value = result; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    uint64_t run() {
+        handle.resume();
+        uint64_t value = handle.promise().value;
+        handle.destroy();
+
+        return value;
+    }
+};
+
+struct global_frame_t {};
+
+template<typename base_t>
+task_t<base_t> handle_request(uint64_t id) {
+    uint64_t scratch[8] = {id};
+    co_return scratch[0] * 2;
+}
+
+template<typename base_t>
+double spawn(size_t count) {
+    return bench::time([&]() {
+        uint64_t sum = 0;
+
+        for(size_t i = 0; i < count; i++) {
+            sum += handle_request<base_t>(i).run();
+        }
+
+        bench::do_not_optimize(sum);
+    });
+}
+
+int main() {
+    constexpr size_t count = 4'000'000;
+
+    bench::report("global operator new frames", spawn<global_frame_t>(count), count);
+    bench::report("pooled_coroutine_frame_t frames", spawn<ptm::pooled_coroutine_frame_t>(count), count);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "bench.hpp"
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+
+// A read mostly map with a fixed set of keys. One writer keeps replacing values
+// while the readers look them up. Compares a std::shared_mutex guarding values
+// updated in place with lock free reads where replaced nodes are retired to an epoch_t
+
+struct node_t {
+    uint64_t key;
+    uint64_t value;
+};
+
+constexpr size_t key_count    = 1 << 14;
+constexpr size_t reader_count = 3;
+constexpr size_t lookups      = 2'000'000; // per reader
+constexpr size_t updates      = 200'000;
+
+struct locked_map_t {
+    std::shared_mutex   mutex;
+    std::vector<node_t> nodes = std::vector<node_t>(key_count);
+
+    uint64_t lookup(uint64_t key) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return nodes[key].value;
+    }
+
+    void update(uint64_t key, uint64_t value) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        nodes[key].value = value;
+    }
+};
+
+struct epoch_map_t {
+    ptm::object_pool_t<node_t>          pool{key_count * 2};
+    ptm::epoch_t                        epoch;
+    std::vector<std::atomic<node_t*>>   nodes = std::vector<std::atomic<node_t*>>(key_count);
+
+    epoch_map_t() {
+        for(size_t i = 0; i < key_count; i++)
+            nodes[i].store(pool.create(1, node_t{i, 0}));
+    }
+
+    ~epoch_map_t() {
+        for(auto& node : nodes)
+            pool.destroy(node.load(), 1);
+    }
+
+    uint64_t lookup(ptm::epoch_t::local_t& local, uint64_t key) {
+        auto guard = local.pin();
+        return nodes[key].load(std::memory_order_acquire)->value;
+    }
+
+    // only the writer thread calls this, so it is the only one using the pool
+    void update(ptm::epoch_t::local_t& local, uint64_t key, uint64_t value) {
+        node_t* old = nodes[key].exchange(pool.create(1, node_t{key, value}), std::memory_order_acq_rel);
+        local.retire(pool, old);
+    }
+};
+
+template<typename read_t, typename write_t>
+double run(read_t&& read, write_t&& write) {
+    return bench::time([&]() {
+        std::vector<std::thread> readers;
+
+        for(size_t i = 0; i < reader_count; i++) {
+            readers.emplace_back([&, i]() {
+                read(i);
+            });
+        }
+
+        write();
+
+        for(auto& reader : readers)
+            reader.join();
+    });
+}
+
+int main() {
+    constexpr size_t operations = reader_count * lookups + updates;
+
+    {
+        locked_map_t map;
+
+        double seconds = run([&](size_t seed) {
+            uint64_t sum = 0;
+            for(size_t i = 0; i < lookups; i++)
+                sum += map.lookup((i * 2654435761u + seed) % key_count);
+            bench::do_not_optimize(sum);
+        }, [&]() {
+            for(size_t i = 0; i < updates; i++)
+                map.update((i * 40503u) % key_count, i);
+        });
+
+        bench::report("shared_mutex map", seconds, operations);
+    }
+
+    {
+        epoch_map_t map;
+
+        double seconds = run([&](size_t seed) {
+            ptm::epoch_t::local_t local(map.epoch);
+            uint64_t sum = 0;
+            for(size_t i = 0; i < lookups; i++)
+                sum += map.lookup(local, (i * 2654435761u + seed) % key_count);
+            bench::do_not_optimize(sum);
+        }, [&]() {
+            ptm::epoch_t::local_t local(map.epoch);
+            for(size_t i = 0; i < updates; i++)
+                map.update(local, (i * 40503u) % key_count, i);
+        });
+
+        bench::report("epoch_t map", seconds, operations);
+    }
+
+    return 0;
+}
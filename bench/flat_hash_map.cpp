@@ -0,0 +1,73 @@
+#include "bench.hpp"
+#include <random>
+#include <unordered_map>
+
+// flat_hash_map_t against std::unordered_map with random 64 bit ids
+
+constexpr size_t key_count = 1'000'000;
+
+template<typename map_t, typename insert_t, typename find_t, typename erase_t>
+void run(const char* name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& missing,
+         insert_t&& insert, find_t&& find, erase_t&& erase) {
+    map_t map;
+    char label[64];
+
+    snprintf(label, sizeof(label), "%s insert", name);
+    bench::report(label, bench::time([&]() {
+        for(uint64_t key : keys)
+            insert(map, key);
+    }), keys.size());
+
+    snprintf(label, sizeof(label), "%s lookup hit", name);
+    bench::report(label, bench::time([&]() {
+        uint64_t sum = 0;
+        for(uint64_t key : keys)
+            sum += find(map, key);
+        bench::do_not_optimize(sum);
+    }), keys.size());
+
+    snprintf(label, sizeof(label), "%s lookup miss", name);
+    bench::report(label, bench::time([&]() {
+        uint64_t sum = 0;
+        for(uint64_t key : missing)
+            sum += find(map, key);
+        bench::do_not_optimize(sum);
+    }), missing.size());
+
+    snprintf(label, sizeof(label), "%s erase", name);
+    bench::report(label, bench::time([&]() {
+        for(uint64_t key : keys)
+            erase(map, key);
+    }), keys.size());
+}
+
+int main() {
+    std::mt19937_64 random(42);
+    std::vector<uint64_t> keys(key_count), missing(key_count);
+
+    // odd keys are inserted, even keys are never in the map
+    for(size_t i = 0; i < key_count; i++) {
+        keys[i]    = random() | 1;
+        missing[i] = random() & ~(uint64_t)1;
+    }
+
+    using std_map_t = std::unordered_map<uint64_t, uint64_t>;
+    run<std_map_t>("std::unordered_map", keys, missing,
+        [](std_map_t& map, uint64_t key) { map.emplace(key, key); },
+        [](std_map_t& map, uint64_t key) { auto found = map.find(key); return found == map.end() ? 0 : found->second; },
+        [](std_map_t& map, uint64_t key) { map.erase(key); });
+
+    using flat_map_t = ptm::flat_hash_map_t<uint64_t, uint64_t>;
+    run<flat_map_t>("flat_hash_map_t", keys, missing,
+        [](flat_map_t& map, uint64_t key) { map.emplace(key, key); },
+        [](flat_map_t& map, uint64_t key) { uint64_t* value = map.find(key); return value ? *value : 0; },
+        [](flat_map_t& map, uint64_t key) { map.erase(key); });
+
+    using stable_map_t = ptm::flat_hash_map_t<uint64_t, uint64_t, true>;
+    run<stable_map_t>("flat_hash_map_t stable", keys, missing,
+        [](stable_map_t& map, uint64_t key) { map.emplace(key, key); },
+        [](stable_map_t& map, uint64_t key) { uint64_t* value = map.find(key); return value ? *value : 0; },
+        [](stable_map_t& map, uint64_t key) { map.erase(key); });
+
+    return 0;
+}
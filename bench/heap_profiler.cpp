@@ -0,0 +1,187 @@
+#include "bench.hpp"
+#include <algorithm>
+
+// Replays a mix of allocations like a program's: mostly small objects, some
+// medium and large ones and arrays of varied length, with a working set of live
+// allocations that are replaced at random. Runs with the profiler off and sampling
+// at its default period alternate, which goes first swapping every pair so drift
+// cancels out, and the overhead is the median over the pairs as a single pair is
+// dominated by noise. As even the median moves by a percent or two between runs
+// on a busy machine, allocation and free pairs of one pool are also timed on their
+// own, where the difference is steady, and the cost of the hooks in them is given as
+// a share of the workload's time per operation
+
+struct small_t {
+    uint64_t data[4];
+};
+
+struct medium_t {
+    uint64_t data[16];
+};
+
+struct large_t {
+    uint64_t data[64];
+};
+
+constexpr size_t working_set = 4096;
+constexpr size_t operations  = 1000000;
+constexpr int    pairs       = 41;
+
+enum class kind_t : uint8_t {
+    none,
+    small,
+    medium,
+    large,
+    array
+};
+
+struct slot_t {
+    kind_t kind = kind_t::none;
+    void*  ptr  = nullptr;
+    size_t n    = 0;
+};
+
+struct workload_t {
+    ptm::object_pool_t<small_t>  smalls{working_set};
+    ptm::object_pool_t<medium_t> mediums{working_set};
+    ptm::object_pool_t<large_t>  larges{working_set};
+    ptm::memory_pool_t<uint64_t> arrays{working_set * 32};
+
+    std::vector<slot_t> slots = std::vector<slot_t>(working_set);
+    uint64_t            state = 7;
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    void release(slot_t& slot) {
+        switch(slot.kind) {
+        case kind_t::small:  smalls.destroy((small_t*)slot.ptr, 1); break;
+        case kind_t::medium: mediums.destroy((medium_t*)slot.ptr, 1); break;
+        case kind_t::large:  larges.destroy((large_t*)slot.ptr, 1); break;
+        case kind_t::array:  arrays.deallocate((uint64_t*)slot.ptr, slot.n); break;
+        case kind_t::none:   break;
+        }
+
+        slot.kind = kind_t::none;
+    }
+
+    void replace(slot_t& slot) {
+        release(slot);
+
+        uint64_t roll = next() % 100;
+        if(roll < 50) {
+            slot = {kind_t::small, smalls.create(1), 1};
+        } else if(roll < 75) {
+            slot = {kind_t::medium, mediums.create(1), 1};
+        } else if(roll < 85) {
+            slot = {kind_t::large, larges.create(1), 1};
+        } else {
+            size_t n = next() % 64 + 1;
+            slot = {kind_t::array, arrays.allocate(n), n};
+        }
+    }
+
+    double run() {
+        return bench::time([&]() {
+            for(size_t i = 0; i < operations; i++)
+                replace(slots[next() % working_set]);
+
+            bench::do_not_optimize(slots.data());
+        });
+    }
+
+    ~workload_t() {
+        for(slot_t& slot : slots)
+            release(slot);
+    }
+};
+
+// the time per allocation and free pair spent in the profiler's hooks, with the
+// same average size as the workload. It goes through a pool so the check of the
+// sampled tags on free is counted too
+double hook_seconds() {
+    constexpr size_t calls = 10000000;
+
+    ptm::_impl_sparse_memory_pool_t pool(138, working_set);
+    std::vector<void*> ptrs(working_set);
+    for(void*& ptr : ptrs)
+        ptr = pool.allocate(1);
+
+    double seconds = bench::time([&]() {
+        for(size_t i = 0; i < calls; i++) {
+            void*& ptr = ptrs[i % working_set];
+            pool.deallocate(ptr, 1);
+            ptr = pool.allocate(1);
+            bench::do_not_optimize(ptr);
+        }
+    }) / calls;
+
+    for(void* ptr : ptrs)
+        pool.deallocate(ptr, 1);
+
+    return seconds;
+}
+
+int main() {
+    workload_t workload;
+
+    // fill the working set and warm up the pools so no run grows them
+    workload.run();
+
+    std::vector<double> offs, ons, overheads;
+    auto profiled = [&]() {
+        ptm::start_heap_profiler();
+        double seconds = workload.run();
+
+        const char* path = "/tmp/portem_bench_heap_profile";
+        ptm::write_allocation_profile(path);
+        remove(path);
+        ptm::stop_heap_profiler();
+
+        return seconds;
+    };
+
+    for(int pair = 0; pair < pairs; pair++) {
+        double off, on;
+        if(pair % 2 == 0) {
+            off = workload.run();
+            on  = profiled();
+        } else {
+            on  = profiled();
+            off = workload.run();
+        }
+
+        offs.push_back(off);
+        ons.push_back(on);
+        overheads.push_back((on - off) / off * 100.0);
+    }
+
+    auto median = [](std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    };
+
+    bench::report("mixed allocations, profiler off", median(offs), operations);
+    bench::report("mixed allocations, profiler sampling", median(ons), operations);
+    printf("%-40s %10.2f %%\n", "profiling overhead, median of pairs", median(overheads));
+
+    std::vector<double> hooks_off, hooks_on;
+    for(int repeat = 0; repeat < 11; repeat++) {
+        hooks_off.push_back(hook_seconds());
+
+        ptm::start_heap_profiler();
+        hooks_on.push_back(hook_seconds());
+        ptm::stop_heap_profiler();
+    }
+
+    double hook_cost = median(hooks_on) - median(hooks_off);
+    printf("%-40s %10.2f ns\n", "pool pair, profiler off", median(hooks_off) * 1e9);
+    printf("%-40s %10.2f ns\n", "pool pair, profiler sampling", median(hooks_on) * 1e9);
+    printf("%-40s %10.2f %%\n", "hook overhead of the workload", hook_cost / (median(offs) / operations) * 100.0);
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "bench.hpp"
+#include <list>
+#include <deque>
+#include <random>
+
+// A round robin run queue: the task at the front runs and goes to the back,
+// now and then a random task is blocked and woken up again later
+
+struct task_t : ptm::list_base_hook_t<> {
+    uint64_t id;
+    uint64_t runtime = 0;
+};
+
+constexpr size_t task_count = 1024;
+constexpr size_t steps      = 20000000;
+constexpr size_t block_rate = 16; // one step in this many blocks a task
+
+int main() {
+    std::vector<task_t> tasks(task_count);
+    for(size_t i = 0; i < task_count; i++)
+        tasks[i].id = i;
+
+    {
+        ptm::intrusive_list_t<task_t> queue;
+        for(task_t& task : tasks)
+            queue.push_back(&task);
+
+        std::mt19937 random(1);
+        std::vector<task_t*> blocked;
+
+        double seconds = bench::time([&]() {
+            for(size_t step = 0; step < steps; step++) {
+                task_t* task = queue.pop_front();
+                task->runtime++;
+                queue.push_back(task);
+
+                if(step % block_rate == 0) {
+                    task_t* victim = &tasks[random() % task_count];
+                    if(queue.is_linked(victim)) {
+                        queue.remove(victim);
+                        blocked.push_back(victim);
+                    }
+                } else if(step % block_rate == 1 && !blocked.empty()) {
+                    queue.push_back(blocked.back());
+                    blocked.pop_back();
+                }
+            }
+        });
+
+        bench::report("intrusive_list_t", seconds, steps);
+        queue.clear();
+    }
+
+    {
+        // the usual non intrusive way, each task remembers where it is in the queue
+        std::list<task_t*> queue;
+        std::vector<std::list<task_t*>::iterator> positions(task_count);
+        std::vector<bool> queued(task_count, true);
+        for(task_t& task : tasks)
+            positions[task.id] = queue.insert(queue.end(), &task);
+
+        std::mt19937 random(1);
+        std::vector<task_t*> blocked;
+
+        double seconds = bench::time([&]() {
+            for(size_t step = 0; step < steps; step++) {
+                task_t* task = queue.front();
+                queue.pop_front();
+                task->runtime++;
+                positions[task->id] = queue.insert(queue.end(), task);
+
+                if(step % block_rate == 0) {
+                    task_t* victim = &tasks[random() % task_count];
+                    if(queued[victim->id]) {
+                        queue.erase(positions[victim->id]);
+                        queued[victim->id] = false;
+                        blocked.push_back(victim);
+                    }
+                } else if(step % block_rate == 1 && !blocked.empty()) {
+                    task_t* woken = blocked.back();
+                    positions[woken->id] = queue.insert(queue.end(), woken);
+                    queued[woken->id] = true;
+                    blocked.pop_back();
+                }
+            }
+        });
+
+        bench::report("std::list", seconds, steps);
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "bench.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// Reads a file of 100 byte records in 256 KiB chunks and hands every record on,
+// the way a log or message reader would. The malloc run reads into a fresh buffer
+// and copies each record out of it, the pool run reads into a pooled buffer and
+// hands out slices of it. The file is read from the page cache both times
+
+constexpr size_t file_bytesize   = 64 * 1024 * 1024;
+constexpr size_t chunk_bytesize  = 256 * 1024;
+constexpr size_t record_bytesize = 100;
+constexpr int    passes          = 4;
+
+const char* path = "/tmp/portem_bench_io_buffer_pool";
+
+void write_file() {
+    int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+
+    std::string record(record_bytesize - 1, 'x');
+    record += '\n';
+
+    std::string chunk;
+    while(chunk.size() + record.size() <= chunk_bytesize)
+        chunk += record;
+    chunk.resize(chunk_bytesize, '\n');
+
+    for(size_t written = 0; written < file_bytesize; written += chunk.size()) {
+        if(write(fd, chunk.data(), chunk.size()) != (ssize_t)chunk.size())
+            abort();
+    }
+
+    close(fd);
+}
+
+// calls func with the start and size of every line in data
+template<typename func_t>
+void for_each_record(const uint8_t* data, size_t size, func_t&& func) {
+    size_t begin = 0;
+    for(size_t i = 0; i < size; i++) {
+        if(data[i] == '\n') {
+            func(begin, i - begin);
+            begin = i + 1;
+        }
+    }
+}
+
+int main() {
+    write_file();
+
+    size_t records = 0;
+
+    double seconds = bench::time([&]() {
+        std::vector<std::string> out;
+
+        for(int pass = 0; pass < passes; pass++) {
+            int fd = open(path, O_RDONLY);
+
+            while(true) {
+                uint8_t* buffer = (uint8_t*)malloc(chunk_bytesize);
+                ssize_t  size   = read(fd, buffer, chunk_bytesize);
+                if(size <= 0) {
+                    free(buffer);
+                    break;
+                }
+
+                for_each_record(buffer, size, [&](size_t offset, size_t length) {
+                    out.emplace_back((const char*)buffer + offset, length);
+                });
+
+                free(buffer);
+                records += out.size();
+                bench::do_not_optimize(out.data());
+                out.clear();
+            }
+
+            close(fd);
+        }
+    });
+    bench::report("read, malloc + copy records", seconds, records);
+
+    records = 0;
+    {
+        ptm::io_buffer_pool_t pool(chunk_bytesize, 4);
+
+        seconds = bench::time([&]() {
+            std::vector<ptm::io_slice_t> out;
+
+            for(int pass = 0; pass < passes; pass++) {
+                int fd = open(path, O_RDONLY);
+
+                while(true) {
+                    ptm::io_buffer_t buffer = pool.acquire();
+                    ssize_t          size   = read(fd, buffer.data(), buffer.capacity());
+                    if(size <= 0)
+                        break;
+
+                    buffer.resize(size);
+                    for_each_record(buffer.data(), size, [&](size_t offset, size_t length) {
+                        out.push_back(buffer.slice(offset, length));
+                    });
+
+                    records += out.size();
+                    bench::do_not_optimize(out.data());
+                    out.clear();
+                }
+
+                close(fd);
+            }
+        });
+    }
+    bench::report("read, io_buffer_pool_t + slices", seconds, records);
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "bench.hpp"
+#include <random>
+#include <algorithm>
+
+// Builds many binary trees at once in a pool that has free holes scattered
+// through it, then walks them depth first. With create_near children are
+// placed next to their parents, without it they land wherever the pool's cursor is
+
+struct node_t {
+    uint64_t value;
+    node_t*  left;
+    node_t*  right;
+    uint64_t padding;
+};
+
+constexpr size_t tree_count = 4096;
+constexpr size_t tree_depth = 9; // 511 nodes each
+constexpr size_t node_count = tree_count * ((1 << tree_depth) - 1);
+
+uint64_t walk(node_t* node) {
+    if(!node)
+        return 0;
+
+    return node->value + walk(node->left) + walk(node->right);
+}
+
+template<typename create_t>
+double build_and_walk(const std::vector<node_t*>& survivors, create_t&& create) {
+    // all trees grow a level at a time in a random order, so
+    // without a hint their nodes end up mixed with every other tree's
+    std::mt19937 random(3);
+    std::vector<node_t*> level, next;
+    std::vector<node_t*> roots;
+
+    // roots are spread over the pool, as if they were created over time
+    for(size_t i = 0; i < tree_count; i++) {
+        roots.push_back(create(survivors[i * (survivors.size() / tree_count)]));
+        level.push_back(roots.back());
+    }
+
+    for(size_t depth = 1; depth < tree_depth; depth++) {
+        next.clear();
+        std::shuffle(level.begin(), level.end(), random);
+
+        for(node_t* parent : level) {
+            parent->left  = create(parent);
+            parent->right = create(parent);
+            next.push_back(parent->left);
+            next.push_back(parent->right);
+        }
+
+        std::swap(level, next);
+    }
+
+    return bench::time([&]() {
+        uint64_t sum = 0;
+        for(size_t repeat = 0; repeat < 4; repeat++) {
+            for(node_t* root : roots)
+                sum += walk(root);
+        }
+        bench::do_not_optimize(sum);
+    });
+}
+
+// fills the pool and frees a random half of it, so there are holes everywhere
+std::vector<node_t*> fragment(ptm::object_pool_t<node_t>& pool) {
+    std::vector<node_t*> filler;
+    for(size_t i = 0; i < node_count * 2; i++)
+        filler.push_back(pool.create(1));
+
+    std::shuffle(filler.begin(), filler.end(), std::mt19937(7));
+    for(size_t i = 0; i < node_count; i++)
+        pool.destroy(filler[i], 1);
+
+    filler.erase(filler.begin(), filler.begin() + node_count);
+    std::sort(filler.begin(), filler.end());
+    return filler;
+}
+
+int main() {
+    {
+        ptm::object_pool_t<node_t> pool(node_count * 2);
+        std::vector<node_t*> survivors = fragment(pool);
+
+        double seconds = build_and_walk(survivors, [&](node_t* parent) {
+            return pool.create(1, node_t{1, nullptr, nullptr, 0});
+        });
+
+        bench::report("walk, create", seconds, node_count * 4);
+    }
+
+    {
+        ptm::object_pool_t<node_t> pool(node_count * 2);
+        std::vector<node_t*> survivors = fragment(pool);
+
+        double seconds = build_and_walk(survivors, [&](node_t* parent) {
+            return pool.create_near(parent, 1, node_t{1, nullptr, nullptr, 0});
+        });
+
+        bench::report("walk, create_near", seconds, node_count * 4);
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "bench.hpp"
+#include <list>
+#include <unordered_map>
+#include <random>
+
+// Looks keys up in a cache of 64k entries and inserts them on a miss. The hit
+// run only asks for keys that are cached, the miss run mostly for keys that are
+// not, so nearly every lookup inserts and evicts
+
+struct blob_t {
+    uint64_t data[8];
+};
+
+constexpr size_t cached_entries = 65536;
+constexpr size_t lookups        = 4000000;
+
+// the usual std::list + std::unordered_map cache
+struct map_list_cache_t {
+    using list_t = std::list<std::pair<uint64_t, blob_t>>;
+
+    size_t                                          max_entries;
+    list_t                                          recency;
+    std::unordered_map<uint64_t, list_t::iterator> index;
+
+    blob_t* get(uint64_t key) {
+        auto found = index.find(key);
+        if(found == index.end())
+            return nullptr;
+
+        recency.splice(recency.begin(), recency, found->second);
+        return &found->second->second;
+    }
+
+    void put(uint64_t key, const blob_t& value) {
+        recency.emplace_front(key, value);
+        index[key] = recency.begin();
+
+        if(recency.size() > max_entries) {
+            index.erase(recency.back().first);
+            recency.pop_back();
+        }
+    }
+};
+
+template<typename cache_t>
+double run(cache_t& cache, uint64_t key_range) {
+    std::mt19937_64 random(9);
+    blob_t blob = {};
+
+    return bench::time([&]() {
+        uint64_t sum = 0;
+        for(size_t i = 0; i < lookups; i++) {
+            uint64_t key = random() % key_range;
+
+            blob_t* value = cache.get(key);
+            if(value) {
+                sum += value->data[0];
+            } else {
+                blob.data[0] = key;
+                cache.put(key, blob);
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+}
+
+template<typename cache_t>
+void fill(cache_t& cache) {
+    blob_t blob = {};
+    for(uint64_t key = 0; key < cached_entries; key++)
+        cache.put(key, blob);
+}
+
+int main() {
+    size_t entry_bytesize = ptm::entry_bytesize_of_t<uint64_t, blob_t>()(0, blob_t());
+
+    {
+        map_list_cache_t cache{cached_entries};
+        fill(cache);
+        bench::report("hits, map + list", run(cache, cached_entries), lookups);
+        bench::report("misses, map + list", run(cache, cached_entries * 64), lookups);
+    }
+
+    {
+        ptm::lru_cache_t<uint64_t, blob_t> cache(entry_bytesize * cached_entries, cached_entries);
+        fill(cache);
+        bench::report("hits, lru_cache_t", run(cache, cached_entries), lookups);
+        bench::report("misses, lru_cache_t", run(cache, cached_entries * 64), lookups);
+    }
+
+    return 0;
+}
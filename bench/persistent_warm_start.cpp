@@ -0,0 +1,71 @@
+#include "bench.hpp"
+#include <unistd.h>
+
+// Compares starting up by rebuilding an object graph from scratch with
+// reopening a persistent pool that already holds it
+
+struct node_t {
+    uint64_t id;
+    double   weights[6];
+    ptm::relative_ptr_t<node_t> next;
+    ptm::relative_ptr_t<node_t> parent;
+};
+
+constexpr size_t node_count = 2'000'000;
+
+template<typename create_t>
+node_t* build_graph(create_t&& create) {
+    node_t* head = nullptr;
+
+    for(size_t i = 0; i < node_count; i++) {
+        node_t* node = create();
+        node->id = i;
+
+        for(size_t j = 0; j < 6; j++)
+            node->weights[j] = (double)(i * j) * 0.5;
+
+        node->next   = head;
+        node->parent = head ? head->next.get() : nullptr;
+        head = node;
+    }
+
+    return head;
+}
+
+uint64_t traverse(node_t* head) {
+    uint64_t sum = 0;
+
+    for(node_t* node = head; node; node = node->next.get())
+        sum += node->id + (uint64_t)node->weights[5];
+
+    return sum;
+}
+
+int main() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/portem_bench_%d.pool", (int)getpid());
+    remove(path);
+
+    {
+        ptm::persistent_object_pool_t<node_t> pool(path, node_count);
+        pool.set_root(build_graph([&]() { return pool.create(1); }));
+        pool.sync();
+    }
+
+    double rebuild = bench::time([&]() {
+        ptm::object_pool_t<node_t> pool(node_count);
+        bench::do_not_optimize(traverse(build_graph([&]() { return pool.create(1); })));
+    });
+
+    double reopen = bench::time([&]() {
+        ptm::persistent_object_pool_t<node_t> pool(path);
+        bench::do_not_optimize(traverse(pool.get_root()));
+    });
+
+    bench::report("rebuild in object_pool_t", rebuild, node_count);
+    bench::report("reopen persistent_object_pool_t", reopen, node_count);
+
+    remove(path);
+
+    return 0;
+}
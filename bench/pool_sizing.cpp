@@ -0,0 +1,49 @@
+#include "bench.hpp"
+
+// Fills a pool that starts at 100 elements up to a peak of a million, the way a
+// program loads its working set, and then frees it. Once with the default doubling,
+// once with a sizing name and nothing learned yet, and once more after loading the
+// profile the second run saved, where the whole peak is in the first sub pool
+
+struct object_t {
+    uint64_t data[8];
+};
+
+constexpr size_t peak = 1000000;
+
+void run(const char* name, const char* sizing_name) {
+    std::vector<void*> objects(peak);
+    size_t sub_pools = 0, max_elements = 0;
+
+    double seconds = bench::time([&]() {
+        ptm::_impl_sparse_memory_pool_t pool(sizeof(object_t), 100, sizing_name);
+
+        for(size_t i = 0; i < peak; i++)
+            objects[i] = pool.allocate(1);
+
+        bench::do_not_optimize(objects.data());
+        sub_pools    = pool.get_sub_pool_count();
+        max_elements = pool.get_max_elements();
+
+        for(size_t i = 0; i < peak; i++)
+            pool.deallocate(objects[i], 1);
+    });
+
+    bench::report(name, seconds, peak);
+    printf("%-40s %10zu sub pools, %5.1f%% unused\n", "", sub_pools, (max_elements - peak) * 100.0 / max_elements);
+}
+
+int main() {
+    const char* path = "/tmp/portem_bench_pool_sizes";
+
+    run("doubling", nullptr);
+    run("adaptive, first run", "objects");
+
+    ptm::save_pool_sizes(path);
+    ptm::load_pool_sizes(path);
+    remove(path);
+
+    run("adaptive, learned", "objects");
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "bench.hpp"
+#include <string>
+
+// Messages that own a string and a vector are created, filled and destroyed
+// over and over. object_pool_t frees the buffers every time, the recycling
+// pool keeps them and only clears them in reset
+
+struct message_t {
+    message_t() {}
+
+    void reset() {
+        name.clear();
+        payload.clear();
+    }
+
+    std::string           name;
+    std::vector<uint32_t> payload;
+};
+
+constexpr size_t batch_size = 64;
+constexpr size_t batches    = 100000;
+
+void fill(message_t* message, size_t i) {
+    message->name.append("a message that is too long for small string optimization");
+    for(uint32_t j = 0; j < 32; j++) {
+        message->payload.push_back(j + i);
+    }
+}
+
+int main() {
+    message_t* messages[batch_size];
+
+    {
+        ptm::object_pool_t<message_t> pool(batch_size);
+
+        double seconds = bench::time([&]() {
+            for(size_t batch = 0; batch < batches; batch++) {
+                for(size_t i = 0; i < batch_size; i++) {
+                    messages[i] = pool.create(1);
+                    fill(messages[i], i);
+                }
+
+                bench::do_not_optimize(messages);
+                for(size_t i = 0; i < batch_size; i++) {
+                    pool.destroy(messages[i], 1);
+                }
+            }
+        });
+
+        bench::report("object_pool_t", seconds, batch_size * batches);
+    }
+
+    {
+        ptm::recycling_object_pool_t<message_t> pool(batch_size);
+
+        double seconds = bench::time([&]() {
+            for(size_t batch = 0; batch < batches; batch++) {
+                for(size_t i = 0; i < batch_size; i++) {
+                    messages[i] = pool.create();
+                    fill(messages[i], i);
+                }
+
+                bench::do_not_optimize(messages);
+                for(size_t i = 0; i < batch_size; i++) {
+                    pool.destroy(messages[i]);
+                }
+            }
+        });
+
+        bench::report("recycling_object_pool_t", seconds, batch_size * batches);
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "bench.hpp"
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+
+// An I/O thread allocates messages and hands them to workers in batches,
+// the workers free them. Compares a mutex around a memory_pool_t with an
+// owned_memory_pool_t whose workers free through the remote free list
+
+struct message_t {
+    uint64_t id;
+    uint8_t  payload[56];
+};
+
+constexpr size_t batch_size   = 256;
+constexpr size_t worker_count = 3;
+constexpr size_t batch_count  = 2000;
+
+struct batch_queue_t {
+    std::mutex                          mutex;
+    std::condition_variable             ready;
+    std::deque<std::vector<message_t*>> batches;
+    bool                                done = false;
+
+    void push(std::vector<message_t*>&& batch) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.emplace_back(std::move(batch));
+        }
+        ready.notify_one();
+    }
+
+    bool pop(std::vector<message_t*>& batch) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&]() { return done || !batches.empty(); });
+
+        if(batches.empty())
+            return false;
+
+        batch = std::move(batches.front());
+        batches.pop_front();
+        return true;
+    }
+
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        ready.notify_all();
+    }
+};
+
+template<typename allocate_t, typename deallocate_t>
+double run(allocate_t&& allocate, deallocate_t&& deallocate) {
+    batch_queue_t queue;
+
+    return bench::time([&]() {
+        std::vector<std::thread> workers;
+        for(size_t i = 0; i < worker_count; i++) {
+            workers.emplace_back([&]() {
+                std::vector<message_t*> batch;
+
+                while(queue.pop(batch)) {
+                    for(message_t* message : batch) {
+                        bench::do_not_optimize(message->id);
+                        deallocate(message);
+                    }
+                }
+            });
+        }
+
+        for(size_t i = 0; i < batch_count; i++) {
+            std::vector<message_t*> batch;
+            batch.reserve(batch_size);
+
+            for(size_t j = 0; j < batch_size; j++) {
+                message_t* message = allocate();
+                message->id = i * batch_size + j;
+                batch.push_back(message);
+            }
+
+            queue.push(std::move(batch));
+        }
+
+        queue.finish();
+        for(auto& worker : workers)
+            worker.join();
+    });
+}
+
+int main() {
+    constexpr size_t operations = batch_size * batch_count;
+    constexpr size_t initial_max_elements = batch_size * 64;
+
+    {
+        ptm::memory_pool_t<message_t> pool(initial_max_elements);
+        std::mutex mutex;
+
+        double seconds = run(
+            [&]() { std::lock_guard<std::mutex> lock(mutex); return pool.allocate(1); },
+            [&](message_t* message) { std::lock_guard<std::mutex> lock(mutex); pool.deallocate(message, 1); });
+
+        bench::report("locked memory_pool_t", seconds, operations);
+    }
+
+    {
+        ptm::owned_memory_pool_t<message_t> pool(initial_max_elements);
+
+        double seconds = run(
+            [&]() { return pool.allocate(1); },
+            [&](message_t* message) { pool.deallocate(message, 1); });
+
+        bench::report("owned_memory_pool_t remote frees", seconds, operations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "bench.hpp"
+#include <thread>
+#include <mutex>
+#include <deque>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+// Hands integers from a producer thread to a consumer thread pinned to another
+// core. Throughput pushes a stream through each queue, latency bounces a single
+// value back and forth through a pair of them
+
+constexpr size_t item_count  = 10000000;
+constexpr size_t round_trips = 100000;
+constexpr size_t capacity    = 1024;
+constexpr size_t batch_size  = 32;
+
+void pin(std::thread& thread, size_t core) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core % std::thread::hardware_concurrency(), &cpus);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#endif
+}
+
+// what the ring replaces
+struct locked_deque_t {
+    std::mutex           mutex;
+    std::deque<uint64_t> items;
+
+    bool try_push(uint64_t value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.push_back(value);
+        return true;
+    }
+
+    bool try_pop(uint64_t& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(items.empty())
+            return false;
+
+        value = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+template<typename push_t, typename pop_t>
+double between_threads(push_t&& push, pop_t&& pop) {
+    return bench::time([&]() {
+        std::thread producer(push);
+        std::thread consumer(pop);
+        pin(producer, 0);
+        pin(consumer, 1);
+
+        producer.join();
+        consumer.join();
+    });
+}
+
+template<typename queue_t>
+void throughput(const char* name, queue_t& queue) {
+    double seconds = between_threads(
+        [&]() {
+            for(uint64_t i = 0; i < item_count; i++) {
+                while(!queue.try_push(i)) std::this_thread::yield();
+            }
+        },
+        [&]() {
+            uint64_t value, sum = 0;
+            for(size_t i = 0; i < item_count; i++) {
+                while(!queue.try_pop(value)) std::this_thread::yield();
+                sum += value;
+            }
+            bench::do_not_optimize(sum);
+        });
+
+    bench::report(name, seconds, item_count);
+}
+
+template<typename queue_t>
+void batch_throughput(const char* name, queue_t& queue) {
+    double seconds = between_threads(
+        [&]() {
+            uint64_t batch[batch_size];
+            for(uint64_t i = 0; i < item_count; i += batch_size) {
+                for(size_t j = 0; j < batch_size; j++)
+                    batch[j] = i + j;
+
+                size_t pushed = 0;
+                while((pushed += queue.try_push(batch + pushed, batch_size - pushed)) < batch_size) std::this_thread::yield();
+            }
+        },
+        [&]() {
+            uint64_t batch[batch_size], sum = 0;
+            for(size_t i = 0; i < item_count;) {
+                size_t popped = queue.try_pop(batch, batch_size);
+                for(size_t j = 0; j < popped; j++)
+                    sum += batch[j];
+
+                i += popped;
+                if(popped == 0)
+                    std::this_thread::yield();
+            }
+            bench::do_not_optimize(sum);
+        });
+
+    bench::report(name, seconds, item_count);
+}
+
+template<typename queue_t>
+void latency(const char* name, queue_t& ping, queue_t& pong) {
+    double seconds = between_threads(
+        [&]() {
+            uint64_t value;
+            for(uint64_t i = 0; i < round_trips; i++) {
+                while(!ping.try_push(i)) std::this_thread::yield();
+                while(!pong.try_pop(value)) std::this_thread::yield();
+            }
+        },
+        [&]() {
+            uint64_t value;
+            for(size_t i = 0; i < round_trips; i++) {
+                while(!ping.try_pop(value)) std::this_thread::yield();
+                while(!pong.try_push(value)) std::this_thread::yield();
+            }
+        });
+
+    bench::report(name, seconds, round_trips);
+}
+
+int main() {
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    {
+        locked_deque_t queue;
+        throughput("throughput, mutex + deque", queue);
+    }
+
+    {
+        ptm::spsc_ring_t<uint64_t> queue(capacity);
+        throughput("throughput, spsc_ring_t", queue);
+        batch_throughput("throughput, spsc_ring_t batch", queue);
+    }
+
+    {
+        ptm::spsc_ring_t<uint64_t> queue(capacity, nullptr, true);
+        batch_throughput("throughput, spsc_ring_t batch huge", queue);
+    }
+
+    {
+        ptm::mpmc_ring_t<uint64_t> queue(capacity);
+        throughput("throughput, mpmc_ring_t", queue);
+        batch_throughput("throughput, mpmc_ring_t batch", queue);
+    }
+
+    {
+        locked_deque_t ping, pong;
+        latency("round trip, mutex + deque", ping, pong);
+    }
+
+    {
+        ptm::spsc_ring_t<uint64_t> ping(capacity), pong(capacity);
+        latency("round trip, spsc_ring_t", ping, pong);
+    }
+
+    {
+        ptm::mpmc_ring_t<uint64_t> ping(capacity), pong(capacity);
+        latency("round trip, mpmc_ring_t", ping, pong);
+    }
+
+    return 0;
+}
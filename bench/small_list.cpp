@@ -0,0 +1,71 @@
+#include "bench.hpp"
+#include <random>
+
+// Builds short lived lists of mostly small sizes, the way a function collects a
+// handful of results, and then sums them. Nine in ten lists hold up to 16
+// elements and the rest up to 128. std::vector allocates for every list, even
+// when reserved up front, the small lists only allocate for the ones that spill
+
+constexpr size_t list_count      = 2000000;
+constexpr size_t inline_elements = 16;
+
+std::vector<uint32_t> list_sizes() {
+    std::mt19937 random(3);
+    std::vector<uint32_t> sizes(list_count);
+
+    for(uint32_t& size : sizes)
+        size = random() % 10 == 0 ? random() % 128 : random() % (inline_elements + 1);
+
+    return sizes;
+}
+
+template<typename list_t, typename make_t>
+void run(const char* name, const std::vector<uint32_t>& sizes, make_t&& make) {
+    uint64_t sum = 0;
+
+    double seconds = bench::time([&]() {
+        for(uint32_t size : sizes) {
+            list_t list = make();
+
+            for(uint32_t i = 0; i < size; i++)
+                list.push_back(i);
+
+            // an insert and an erase in the middle, as filtering code does
+            if(list.size() > 2) {
+                list.insert(list.begin() + 1, 7);
+                list.erase(list.begin() + 2);
+            }
+
+            for(uint64_t value : list)
+                sum += value;
+        }
+    });
+
+    bench::do_not_optimize(sum);
+    bench::report(name, seconds, sizes.size());
+}
+
+int main() {
+    std::vector<uint32_t> sizes = list_sizes();
+
+    run<std::vector<uint64_t>>("std::vector", sizes, []() {
+        return std::vector<uint64_t>();
+    });
+
+    run<std::vector<uint64_t>>("std::vector, reserved", sizes, []() {
+        std::vector<uint64_t> list;
+        list.reserve(inline_elements);
+        return list;
+    });
+
+    run<ptm::small_list_t<uint64_t, inline_elements>>("small_list_t", sizes, []() {
+        return ptm::small_list_t<uint64_t, inline_elements>();
+    });
+
+    ptm::memory_pool_t<uint64_t> pool(1024);
+    run<ptm::small_list_t<uint64_t, inline_elements>>("small_list_t, memory_pool_t", sizes, [&]() {
+        return ptm::small_list_t<uint64_t, inline_elements>(&pool);
+    });
+
+    return 0;
+}
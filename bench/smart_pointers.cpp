@@ -0,0 +1,87 @@
+#include "bench.hpp"
+#include <random>
+
+// Churn: a table of shared objects where each step replaces a random entry
+// with a new object and copies another entry over a third, so objects are
+// made, shared and freed in a random order
+
+struct widget_t : ptm::ref_counted_t<widget_t> {
+    widget_t(uint64_t id) : id(id) {}
+
+    uint64_t id;
+    uint64_t data[5];
+};
+
+// std::shared_ptr skips its atomics while a program has one thread, this never uses them
+struct local_widget_t : ptm::ref_counted_t<local_widget_t, false> {
+    local_widget_t(uint64_t id) : id(id) {}
+
+    uint64_t id;
+    uint64_t data[5];
+};
+
+constexpr size_t table_size = 4096;
+constexpr size_t steps      = 4000000;
+
+template<typename ptr_t, typename make_t>
+double churn(make_t&& make) {
+    std::vector<ptr_t> table;
+    for(size_t i = 0; i < table_size; i++)
+        table.push_back(make(i));
+
+    std::mt19937 random(5);
+
+    return bench::time([&]() {
+        for(size_t step = 0; step < steps; step++) {
+            size_t index = random() % table_size;
+
+            table[index] = make(step);
+            table[random() % table_size] = table[index];
+            bench::do_not_optimize(table[index]->id);
+        }
+
+        table.clear();
+    });
+}
+
+int main() {
+    {
+        double seconds = churn<std::shared_ptr<widget_t>>([](uint64_t id) {
+            return std::make_shared<widget_t>(id);
+        });
+
+        bench::report("std::make_shared", seconds, steps);
+    }
+
+    {
+        ptm::shared_ptr_pool_t<widget_t> pool(table_size);
+
+        double seconds = churn<std::shared_ptr<widget_t>>([&](uint64_t id) {
+            return ptm::allocate_shared_in(pool, id);
+        });
+
+        bench::report("allocate_shared_in", seconds, steps);
+    }
+
+    {
+        ptm::object_pool_t<widget_t> pool(table_size);
+
+        double seconds = churn<ptm::intrusive_ptr_t<widget_t>>([&](uint64_t id) {
+            return ptm::make_intrusive_in(pool, id);
+        });
+
+        bench::report("make_intrusive_in", seconds, steps);
+    }
+
+    {
+        ptm::object_pool_t<local_widget_t> pool(table_size);
+
+        double seconds = churn<ptm::intrusive_ptr_t<local_widget_t>>([&](uint64_t id) {
+            return ptm::make_intrusive_in(pool, id);
+        });
+
+        bench::report("make_intrusive_in, not thread safe", seconds, steps);
+    }
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include "heap.hpp"
+#include <sys/mman.h>
+#include <pthread.h>
+#include <errno.h>
+
+namespace ptm {
+    namespace pmalloc {
+        // initial-exec keeps the TLS access from calling back into malloc
+        static thread_local heap_t* tl_heap __attribute__((tls_model("initial-exec"))) = nullptr;
+
+        static std::atomic_flag heaps_lock      = ATOMIC_FLAG_INIT;
+        static heap_t*          abandoned_heaps = nullptr;
+        static pthread_key_t    heap_key;
+        static pthread_once_t   heap_key_once   = PTHREAD_ONCE_INIT;
+
+        static void lock_heaps() {
+            while(heaps_lock.test_and_set(std::memory_order_acquire));
+        }
+
+        static void unlock_heaps() {
+            heaps_lock.clear(std::memory_order_release);
+        }
+
+        // maps bytesize bytes starting at an address aligned to chunk_bytesize
+        static void* map_chunk_aligned(size_t bytesize) {
+            size_t   mapping_bytesize = bytesize + chunk_bytesize;
+            uint8_t* mapping = (uint8_t*)mmap(nullptr, mapping_bytesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if(mapping == MAP_FAILED)
+                return nullptr;
+
+            uint8_t* aligned = (uint8_t*)round_up((size_t)mapping, chunk_bytesize);
+            size_t   head    = aligned - mapping;
+            size_t   tail    = mapping_bytesize - head - bytesize;
+
+            if(head)
+                munmap(mapping, head);
+            if(tail)
+                munmap(aligned + bytesize, tail);
+
+            return aligned;
+        }
+
+        static void abandon_heap(void* heap) {
+            lock_heaps();
+            ((heap_t*)heap)->next_abandoned = abandoned_heaps;
+            abandoned_heaps = (heap_t*)heap;
+            unlock_heaps();
+
+            tl_heap = nullptr;
+        }
+
+        static void create_heap_key() {
+            pthread_key_create(&heap_key, abandon_heap);
+        }
+
+        heap_t* thread_heap_if_any() {
+            return tl_heap;
+        }
+
+        heap_t* thread_heap() {
+            if(tl_heap)
+                return tl_heap;
+
+            pthread_once(&heap_key_once, create_heap_key);
+
+            lock_heaps();
+            heap_t* heap = abandoned_heaps;
+            if(heap)
+                abandoned_heaps = heap->next_abandoned;
+            unlock_heaps();
+
+            if(!heap) {
+                // fresh mappings are zeroed, which is a valid empty heap
+                heap = (heap_t*)mmap(nullptr, round_up(sizeof(heap_t), page_size()), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if(heap == MAP_FAILED)
+                    return nullptr;
+            }
+
+            tl_heap = heap;
+            pthread_setspecific(heap_key, heap);
+
+            return heap;
+        }
+
+        static chunk_t* create_small_chunk(heap_t* heap, size_t size_class) {
+            chunk_t* chunk = (chunk_t*)map_chunk_aligned(chunk_bytesize);
+            if(!chunk)
+                return nullptr;
+
+            const size_t element_bytesize = size_class_bytesize(size_class);
+            const size_t pool_bytesize    = chunk_bytesize - chunk_header_bytesize;
+
+            // one flag bit per element on top of the element itself
+            size_t max_elements = pool_bytesize * 8 / (element_bytesize * 8 + 1);
+            while(_impl_continuous_memory_pool_t::required_bytesize(element_bytesize, max_elements) > pool_bytesize)
+                max_elements--;
+
+            chunk->magic      = chunk_magic;
+            chunk->kind       = chunk_kind_t::small;
+            chunk->size_class = size_class;
+            chunk->used       = 0;
+            chunk->heap       = heap;
+            new(&chunk->pool)_impl_continuous_memory_pool_t(inc_by_byte((void*)chunk, chunk_header_bytesize), element_bytesize, max_elements);
+
+            chunk->next = heap->chunks[size_class];
+            heap->chunks[size_class] = chunk;
+
+            return chunk;
+        }
+
+        static void* chunk_allocate(chunk_t* chunk) {
+            void* ptr = chunk->pool.allocate(1);
+
+            if(ptr)
+                chunk->used++;
+
+            return ptr;
+        }
+
+        void heap_reclaim_remote_frees(heap_t* heap) {
+            remote_free_t* node = heap->remote_frees.exchange(nullptr, std::memory_order_acquire);
+
+            while(node) {
+                remote_free_t* next  = node->next;
+                chunk_t*       chunk = chunk_of(node);
+
+                chunk->pool.deallocate((void*)node, 1);
+                chunk->used--;
+                node = next;
+            }
+        }
+
+        void* heap_allocate(heap_t* heap, size_t size_class) {
+            if(heap->remote_frees.load(std::memory_order_relaxed))
+                heap_reclaim_remote_frees(heap);
+
+            chunk_t* chunk = heap->current[size_class];
+            void*    ptr   = nullptr;
+
+            if(chunk && (ptr = chunk_allocate(chunk)))
+                return ptr;
+
+            for(chunk = heap->chunks[size_class]; chunk; chunk = chunk->next) {
+                if(chunk->used < chunk->pool.get_max_elements() && (ptr = chunk_allocate(chunk))) {
+                    heap->current[size_class] = chunk;
+                    return ptr;
+                }
+            }
+
+            chunk = create_small_chunk(heap, size_class);
+            if(!chunk)
+                return nullptr;
+
+            heap->current[size_class] = chunk;
+
+            return chunk_allocate(chunk);
+        }
+
+        void* large_allocate(size_t bytesize, size_t alignment) {
+            // the pointer handed out has to stay in the first chunk_bytesize
+            // bytes of the mapping so chunk_of finds the header
+            if(alignment > chunk_bytesize / 2)
+                return nullptr;
+
+            size_t offset = std::max(chunk_header_bytesize, alignment);
+            if(bytesize > SIZE_MAX - offset - chunk_bytesize - page_size())
+                return nullptr;
+
+            size_t   mapping_bytesize = round_up(offset + bytesize, page_size());
+            chunk_t* chunk = (chunk_t*)map_chunk_aligned(mapping_bytesize);
+            if(!chunk)
+                return nullptr;
+
+            chunk->magic = chunk_magic;
+            chunk->kind  = chunk_kind_t::large;
+            chunk->mapping_bytesize = mapping_bytesize;
+
+            return inc_by_byte((void*)chunk, offset);
+        }
+
+        void* allocate(size_t bytesize, size_t alignment) {
+            if(alignment < linear_class_step)
+                alignment = linear_class_step;
+
+            // a zero byte allocation padded up to the alignment would be exactly
+            // one element, which the rounding below can push into the next element
+            bytesize = std::max(bytesize, (size_t)1);
+
+            // elements start 16 byte aligned, so there must be
+            // room to move the pointer up to the alignment
+            size_t padded_bytesize = bytesize + (alignment - linear_class_step);
+
+            void* ptr = nullptr;
+            if(padded_bytesize >= bytesize && padded_bytesize <= max_small_bytesize) {
+                heap_t* heap = thread_heap();
+
+                if(heap)
+                    ptr = heap_allocate(heap, size_class_of(padded_bytesize));
+                if(ptr)
+                    ptr = (void*)round_up((size_t)ptr, alignment);
+            } else {
+                ptr = large_allocate(bytesize, alignment);
+            }
+
+            if(!ptr)
+                errno = ENOMEM;
+
+            return ptr;
+        }
+
+        void deallocate(void* ptr) {
+            if(!ptr)
+                return;
+
+            chunk_t* chunk = chunk_of(ptr);
+            assert(chunk->magic == chunk_magic);
+
+            if(chunk->kind == chunk_kind_t::large) {
+                munmap(chunk, chunk->mapping_bytesize);
+                return;
+            }
+
+            if(chunk->heap == thread_heap_if_any()) {
+                // the pool works out the element from a pointer anywhere inside it
+                chunk->pool.deallocate(ptr, 1);
+                chunk->used--;
+                return;
+            }
+
+            remote_free_t* node = (remote_free_t*)ptr;
+            heap_t*        heap = chunk->heap;
+
+            node->next = heap->remote_frees.load(std::memory_order_relaxed);
+            while(!heap->remote_frees.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        size_t usable_bytesize(void* ptr) {
+            if(!ptr)
+                return 0;
+
+            chunk_t* chunk = chunk_of(ptr);
+
+            if(chunk->kind == chunk_kind_t::large) {
+                return chunk->mapping_bytesize - ((uint8_t*)ptr - (uint8_t*)chunk);
+            }
+
+            size_t   element_bytesize = size_class_bytesize(chunk->size_class);
+            uint8_t* block   = (uint8_t*)chunk->pool.get_block();
+            uint8_t* element = block + ((uint8_t*)ptr - block) / element_bytesize * element_bytesize;
+
+            return element + element_bytesize - (uint8_t*)ptr;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "size_class.hpp"
+#include <ptm/memory_pool.hpp>
+#include <ptm/virtual_memory.hpp>
+#include <atomic>
+
+namespace ptm {
+    namespace pmalloc {
+        // every chunk is aligned to its size so the chunk of any pointer
+        // handed out can be found by masking off the low bits
+        constexpr size_t chunk_bytesize = (size_t)1 << 20;
+        constexpr size_t chunk_header_bytesize = 128;
+        constexpr uint32_t chunk_magic  = 0x7074'6d63; // "ptmc"
+
+        enum class chunk_kind_t : uint32_t {
+            small,
+            large
+        };
+
+        struct heap_t;
+
+        // sits at the start of every chunk
+        struct chunk_t {
+            uint32_t     magic;
+            chunk_kind_t kind;
+            size_t       mapping_bytesize; // large chunks only
+            size_t       size_class;
+            size_t       used;
+            heap_t*      heap;
+            chunk_t*     next;
+            _impl_continuous_memory_pool_t pool;
+        };
+
+        static_assert(sizeof(chunk_t) <= chunk_header_bytesize);
+
+        struct remote_free_t {
+            remote_free_t* next;
+        };
+
+        // Each thread allocates from its own heap. A heap is never destroyed, when its
+        // thread exits it is abandoned and handed to the next new thread along with
+        // all of its chunks
+        struct heap_t {
+            chunk_t*                    current[size_class_count];
+            chunk_t*                    chunks[size_class_count];
+            std::atomic<remote_free_t*> remote_frees;
+            heap_t*                     next_abandoned;
+        };
+
+        inline chunk_t* chunk_of(void* ptr) {
+            return (chunk_t*)((size_t)ptr & ~(chunk_bytesize - 1));
+        }
+
+        // returns the calling thread's heap, creating or adopting one if it has none
+        heap_t* thread_heap();
+
+        // returns nullptr if the calling thread has not allocated yet
+        heap_t* thread_heap_if_any();
+
+        void* heap_allocate(heap_t* heap, size_t size_class);
+        void  heap_reclaim_remote_frees(heap_t* heap);
+
+        // alignment must be a power of two no bigger than chunk_bytesize / 2
+        void* large_allocate(size_t bytesize, size_t alignment);
+
+        void* allocate(size_t bytesize, size_t alignment);
+        void  deallocate(void* ptr);
+        size_t usable_bytesize(void* ptr);
+    }
+}
@@ -0,0 +1,148 @@
+#include "heap.hpp"
+#include <errno.h>
+#include <new>
+
+// Replaces the C allocation functions and the global operator new/delete
+// so the library can be LD_PRELOADed under any dynamically linked program
+
+using namespace ptm::pmalloc;
+
+namespace {
+    constexpr size_t default_alignment = 16;
+
+    bool is_power_of_two(size_t value) {
+        return value && !(value & (value - 1));
+    }
+
+    void* new_impl(size_t bytesize, size_t alignment) {
+        void* ptr;
+
+        while(!(ptr = allocate(bytesize, alignment))) {
+            std::new_handler handler = std::get_new_handler();
+            if(!handler)
+                throw std::bad_alloc();
+
+            handler();
+        }
+
+        return ptr;
+    }
+}
+
+extern "C" {
+    void* malloc(size_t bytesize) {
+        return allocate(bytesize, default_alignment);
+    }
+
+    void free(void* ptr) {
+        deallocate(ptr);
+    }
+
+    void* calloc(size_t count, size_t bytesize) {
+        size_t total;
+        if(__builtin_mul_overflow(count, bytesize, &total)) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+
+        void* ptr = allocate(total, default_alignment);
+
+        // large allocations are fresh mappings which are already zeroed
+        if(ptr && chunk_of(ptr)->kind == chunk_kind_t::small)
+            memset(ptr, 0, total);
+
+        return ptr;
+    }
+
+    void* realloc(void* ptr, size_t bytesize) {
+        if(!ptr)
+            return allocate(bytesize, default_alignment);
+
+        if(bytesize == 0) {
+            deallocate(ptr);
+            return nullptr;
+        }
+
+        size_t usable = usable_bytesize(ptr);
+        if(bytesize <= usable)
+            return ptr;
+
+        void* new_ptr = allocate(bytesize, default_alignment);
+        if(!new_ptr)
+            return nullptr;
+
+        memcpy(new_ptr, ptr, usable);
+        deallocate(ptr);
+
+        return new_ptr;
+    }
+
+    void* reallocarray(void* ptr, size_t count, size_t bytesize) {
+        size_t total;
+        if(__builtin_mul_overflow(count, bytesize, &total)) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+
+        return realloc(ptr, total);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t bytesize) {
+        if(!is_power_of_two(alignment) || alignment % sizeof(void*) != 0)
+            return EINVAL;
+
+        void* ptr = allocate(bytesize, alignment);
+        if(!ptr)
+            return ENOMEM;
+
+        *result = ptr;
+        return 0;
+    }
+
+    void* aligned_alloc(size_t alignment, size_t bytesize) {
+        if(!is_power_of_two(alignment)) {
+            errno = EINVAL;
+            return nullptr;
+        }
+
+        return allocate(bytesize, alignment);
+    }
+
+    void* memalign(size_t alignment, size_t bytesize) {
+        return aligned_alloc(alignment, bytesize);
+    }
+
+    void* valloc(size_t bytesize) {
+        return allocate(bytesize, ptm::page_size());
+    }
+
+    void* pvalloc(size_t bytesize) {
+        return allocate(ptm::round_up(bytesize, ptm::page_size()), ptm::page_size());
+    }
+
+    size_t malloc_usable_size(void* ptr) {
+        return usable_bytesize(ptr);
+    }
+}
+
+void* operator new(size_t bytesize) { return new_impl(bytesize, default_alignment); }
+void* operator new[](size_t bytesize) { return new_impl(bytesize, default_alignment); }
+void* operator new(size_t bytesize, const std::nothrow_t&) noexcept { return allocate(bytesize, default_alignment); }
+void* operator new[](size_t bytesize, const std::nothrow_t&) noexcept { return allocate(bytesize, default_alignment); }
+void* operator new(size_t bytesize, std::align_val_t alignment) { return new_impl(bytesize, (size_t)alignment); }
+void* operator new[](size_t bytesize, std::align_val_t alignment) { return new_impl(bytesize, (size_t)alignment); }
+void* operator new(size_t bytesize, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(bytesize, (size_t)alignment); }
+void* operator new[](size_t bytesize, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(bytesize, (size_t)alignment); }
+
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(ptr); }
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <ptm/base.hpp>
+
+namespace ptm {
+    namespace pmalloc {
+        // Sizes up to 128 bytes go up in steps of 16, after that every
+        // power of two is split into 4 classes. Every class is a multiple of 16
+        constexpr size_t linear_class_count = 8;
+        constexpr size_t linear_class_step  = 16;
+        constexpr size_t classes_per_double = 4;
+        constexpr size_t max_small_bytesize = 16384;
+        constexpr size_t size_class_count   = 36;
+
+        inline size_t log2_floor(size_t value) {
+            return (sizeof(size_t) * 8 - 1) - __builtin_clzl(value);
+        }
+
+        inline size_t size_class_of(size_t bytesize) {
+            if(bytesize <= linear_class_count * linear_class_step) {
+                return bytesize == 0 ? 0 : (bytesize + linear_class_step - 1) / linear_class_step - 1;
+            }
+
+            size_t power = log2_floor(bytesize - 1);
+            size_t step  = (size_t)1 << (power - 2);
+            size_t part  = ((bytesize - ((size_t)1 << power)) + step - 1) / step;
+
+            return linear_class_count + (power - 7) * classes_per_double + part - 1;
+        }
+
+        inline size_t size_class_bytesize(size_t size_class) {
+            if(size_class < linear_class_count) {
+                return (size_class + 1) * linear_class_step;
+            }
+
+            size_t power = 7 + (size_class - linear_class_count) / classes_per_double;
+            size_t part  = (size_class - linear_class_count) % classes_per_double + 1;
+
+            return ((size_t)1 << power) + part * ((size_t)1 << (power - 2));
+        }
+    }
+}
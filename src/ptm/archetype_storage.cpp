@@ -0,0 +1,255 @@
+#include "archetype_storage.hpp"
+
+namespace ptm {
+    // the memory of one archetype chunk, with room to align it to a cache line
+    struct archetype_chunk_memory_t {
+        uint8_t bytes[archetype_t::chunk_bytesize + cache_line_bytesize];
+    };
+
+    archetype_t::archetype_t(rda_t& rda, std::vector<uint32_t> component_ids)
+        : rda(&rda), component_ids(std::move(component_ids)) {
+        size_t row_bytesize = sizeof(entity_t);
+
+        for(uint32_t id : this->component_ids) {
+            const rda_type_info_t& info = rda.get_type_info(id);
+            assert(info.alignment <= cache_line_bytesize);
+            assert(info.relocate && "archetype components must be move constructible");
+
+            infos.push_back(info);
+            row_bytesize += info.bytesize;
+        }
+
+        offsets.resize(infos.size());
+
+        // padding between the columns can push the first guess over
+        chunk_capacity = chunk_bytesize / row_bytesize;
+        while(chunk_capacity > 0 && layout(chunk_capacity) > chunk_bytesize)
+            chunk_capacity--;
+
+        if(chunk_capacity == 0) {
+            log("Components of %zu bytes do not fit in an archetype chunk of %zu bytes", row_bytesize, chunk_bytesize);
+            throw std::exception();
+        }
+    }
+
+    archetype_t::~archetype_t() {
+        for(chunk_t& chunk : chunks) {
+            rda->deallocate((archetype_chunk_memory_t*)chunk.memory, 1);
+        }
+    }
+
+    size_t archetype_t::layout(size_t capacity) {
+        size_t offset = sizeof(entity_t) * capacity;
+
+        for(size_t i = 0; i < infos.size(); i++) {
+            offset = round_up(offset, infos[i].alignment);
+            offsets[i] = offset;
+            offset += infos[i].bytesize * capacity;
+        }
+
+        return offset;
+    }
+
+    size_t archetype_t::find_column(uint32_t component_id) const {
+        auto found = std::lower_bound(component_ids.begin(), component_ids.end(), component_id);
+        if(found == component_ids.end() || *found != component_id)
+            return no_column;
+
+        return found - component_ids.begin();
+    }
+
+    bool archetype_t::has_all(const uint32_t* ids, size_t count) const {
+        return std::includes(component_ids.begin(), component_ids.end(), ids, ids + count);
+    }
+
+    uint32_t archetype_t::push_row(entity_t entity) {
+        if(count == chunks.size() * chunk_capacity) {
+            chunk_t chunk;
+            chunk.memory = rda->allocate<archetype_chunk_memory_t>(1);
+            chunk.data   = (uint8_t*)round_up((size_t)chunk.memory, cache_line_bytesize);
+
+            chunks.push_back(chunk);
+        }
+
+        uint32_t row = (uint32_t)count++;
+        entity_at(row) = entity;
+
+        return row;
+    }
+
+    entity_t archetype_t::swap_remove_row(uint32_t row) {
+        uint32_t last  = (uint32_t)count - 1;
+        entity_t moved = entity_t();
+
+        if(row != last) {
+            for(size_t column = 0; column < infos.size(); column++) {
+                relocate(column, get(row, column), get(last, column));
+            }
+
+            moved = entity_at(last);
+            entity_at(row) = moved;
+        }
+
+        count--;
+
+        // let go of the last chunk once it is empty
+        if(count == (chunks.size() - 1) * chunk_capacity) {
+            rda->deallocate((archetype_chunk_memory_t*)chunks.back().memory, 1);
+            chunks.pop_back();
+        }
+
+        return moved;
+    }
+
+    archetype_storage_t::archetype_storage_t(rda_t& rda, size_t initial_chunks)
+        : rda(&rda) {
+        rda.register_type<archetype_chunk_memory_t>(initial_chunks);
+
+        empty_archetype = find_or_create({});
+    }
+
+    archetype_storage_t::~archetype_storage_t() {
+        for(std::unique_ptr<archetype_t>& archetype : archetypes) {
+            for(size_t row = 0; row < archetype->size(); row++) {
+                for(size_t column = 0; column < archetype->infos.size(); column++) {
+                    archetype->destroy(column, archetype->get(row, column));
+                }
+            }
+        }
+    }
+
+    entity_t archetype_storage_t::create() {
+        entity_t entity;
+
+        if(free_records.empty()) {
+            entity.index = (uint32_t)records.size();
+            records.emplace_back();
+        } else {
+            entity.index = free_records.back();
+            free_records.pop_back();
+        }
+
+        record_t& record  = records[entity.index];
+        entity.generation = record.generation;
+        record.archetype  = empty_archetype;
+        record.row        = empty_archetype->push_row(entity);
+
+        return entity;
+    }
+
+    void archetype_storage_t::destroy(entity_t entity) {
+        assert(is_alive(entity));
+
+        record_t&    record    = records[entity.index];
+        archetype_t* archetype = record.archetype;
+
+        for(size_t column = 0; column < archetype->infos.size(); column++) {
+            archetype->destroy(column, archetype->get(record.row, column));
+        }
+
+        remove_row(archetype, record.row);
+
+        record.archetype = nullptr;
+        record.generation++;
+        free_records.push_back(entity.index);
+    }
+
+    bool archetype_storage_t::is_alive(entity_t entity) const {
+        return entity.index < records.size() && records[entity.index].generation == entity.generation &&
+               records[entity.index].archetype;
+    }
+
+    void* archetype_storage_t::add_component(entity_t entity, uint32_t component_id, bool& added) {
+        assert(is_alive(entity));
+
+        record_t&    record = records[entity.index];
+        archetype_t* source = record.archetype;
+
+        size_t column = source->find_column(component_id);
+        if(column != archetype_t::no_column) {
+            added = false;
+            return source->get(record.row, column);
+        }
+
+        archetype_t*& target = source->add_edges[component_id];
+        if(!target) {
+            std::vector<uint32_t> ids = source->component_ids;
+            ids.insert(std::upper_bound(ids.begin(), ids.end(), component_id), component_id);
+
+            target = find_or_create(std::move(ids));
+        }
+
+        move_entity(record, target);
+
+        added = true;
+        return target->get(record.row, target->find_column(component_id));
+    }
+
+    void archetype_storage_t::remove_component(entity_t entity, uint32_t component_id) {
+        assert(is_alive(entity));
+
+        record_t&    record = records[entity.index];
+        archetype_t* source = record.archetype;
+
+        if(source->find_column(component_id) == archetype_t::no_column)
+            return;
+
+        archetype_t*& target = source->remove_edges[component_id];
+        if(!target) {
+            std::vector<uint32_t> ids = source->component_ids;
+            ids.erase(std::find(ids.begin(), ids.end(), component_id));
+
+            target = find_or_create(std::move(ids));
+        }
+
+        move_entity(record, target);
+    }
+
+    void* archetype_storage_t::get_component(entity_t entity, uint32_t component_id) {
+        assert(is_alive(entity));
+
+        record_t& record = records[entity.index];
+        size_t    column = record.archetype->find_column(component_id);
+
+        return column == archetype_t::no_column ? nullptr : record.archetype->get(record.row, column);
+    }
+
+    archetype_t* archetype_storage_t::find_or_create(std::vector<uint32_t> component_ids) {
+        auto found = archetype_index.find(component_ids);
+        if(found != archetype_index.end())
+            return found->second;
+
+        archetypes.push_back(std::make_unique<archetype_t>(*rda, component_ids));
+        archetype_index[std::move(component_ids)] = archetypes.back().get();
+
+        return archetypes.back().get();
+    }
+
+    void archetype_storage_t::move_entity(record_t& record, archetype_t* target) {
+        archetype_t* source = record.archetype;
+        uint32_t     row    = target->push_row(source->entity_at(record.row));
+
+        for(size_t column = 0; column < source->infos.size(); column++) {
+            size_t target_column = target->find_column(source->component_ids[column]);
+            void*  component     = source->get(record.row, column);
+
+            if(target_column == archetype_t::no_column) {
+                source->destroy(column, component);
+            } else {
+                target->relocate(target_column, target->get(row, target_column), component);
+            }
+        }
+
+        remove_row(source, record.row);
+
+        record.archetype = target;
+        record.row       = row;
+    }
+
+    void archetype_storage_t::remove_row(archetype_t* archetype, uint32_t row) {
+        entity_t moved = archetype->swap_remove_row(row);
+
+        if(moved.index != blatent_u32)
+            records[moved.index].row = row;
+    }
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "runtime_dynamic_allocator.hpp"
+#include <algorithm>
+#include <array>
+#include <tuple>
+
+namespace ptm {
+    // An index into an archetype_storage_t's entity records and the generation of that
+    // record, so a handle to a destroyed entity is never mistaken for a new one
+    struct entity_t {
+        uint32_t index      = blatent_u32;
+        uint32_t generation = 0;
+
+        bool operator==(const entity_t& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const entity_t& other) const { return !(*this == other); }
+    };
+
+    // All the entities that have exactly the same set of components. Rows are kept in
+    // chunks with one array per component in every chunk, so walking a component of
+    // the archetype reads memory in order. Rows are kept dense by moving the last row
+    // into any hole, so a row index is only good until the next removal
+    class archetype_t {
+    public:
+        static constexpr size_t chunk_bytesize = 16 * 1024;
+        static constexpr size_t no_column      = SIZE_MAX;
+
+        // component_ids must be sorted
+        archetype_t(rda_t& rda, std::vector<uint32_t> component_ids);
+        ~archetype_t();
+
+        archetype_t(const archetype_t&) = delete;
+        archetype_t& operator=(const archetype_t&) = delete;
+
+        const std::vector<uint32_t>& get_component_ids() const { return component_ids; }
+
+        // the column holding component_id, or no_column
+        size_t find_column(uint32_t component_id) const;
+
+        // true if every one of the sorted ids is a component of the archetype
+        bool has_all(const uint32_t* ids, size_t count) const;
+
+        size_t size() const { return count; }
+        size_t get_chunk_capacity() const { return chunk_capacity; }
+        size_t get_chunk_count() const { return chunks.size(); }
+        size_t get_chunk_size(size_t chunk) const { return std::min(chunk_capacity, count - chunk * chunk_capacity); }
+
+        entity_t* get_entities(size_t chunk) { return (entity_t*)chunks[chunk].data; }
+        void* get_column(size_t chunk, size_t column) { return chunks[chunk].data + offsets[column]; }
+
+        entity_t& entity_at(size_t row) { return get_entities(row / chunk_capacity)[row % chunk_capacity]; }
+        void* get(size_t row, size_t column) {
+            return (uint8_t*)get_column(row / chunk_capacity, column) + (row % chunk_capacity) * infos[column].bytesize;
+        }
+
+        // Appends a row for entity and returns its index. The components of the
+        // new row are left uninitialized
+        uint32_t push_row(entity_t entity);
+
+        // Fills row with the last row, whose entity is returned, and drops the last row.
+        // The components of row must already have been destroyed or moved out. Returns
+        // an entity with no index if row was the last row
+        entity_t swap_remove_row(uint32_t row);
+
+        // move constructs dst from src and destroys src, for values of column
+        void relocate(size_t column, void* dst, void* src) {
+            if(infos[column].trivially_relocatable) {
+                memcpy(dst, src, infos[column].bytesize);
+            } else {
+                infos[column].relocate(dst, src);
+            }
+        }
+
+        void destroy(size_t column, void* value) {
+            if(!infos[column].trivially_relocatable)
+                infos[column].destroy(value);
+        }
+
+    private:
+        friend class archetype_storage_t;
+
+        struct chunk_t {
+            void*    memory;
+            uint8_t* data; // memory aligned up to a cache line
+        };
+
+        size_t layout(size_t capacity);
+
+    private:
+        rda_t*                       rda;
+        std::vector<uint32_t>        component_ids;
+        std::vector<rda_type_info_t> infos;
+        std::vector<size_t>          offsets; // of every column within a chunk
+        size_t                       chunk_capacity;
+        std::vector<chunk_t>         chunks;
+        size_t                       count = 0;
+
+        // where adding or removing a component takes an entity, filled in as they are used
+        std::map<uint32_t, archetype_t*> add_edges;
+        std::map<uint32_t, archetype_t*> remove_edges;
+    };
+
+    template<typename ... Ts>
+    class query_t;
+
+    // Stores the components of entities by archetype, the set of components an entity
+    // has. Component types are those registered with the rda_t given, which also
+    // provides the memory of the chunks. Adding or removing a component moves the
+    // entity's row to another archetype. Entities must not be created, destroyed or
+    // have components added or removed while a query is iterating
+    class archetype_storage_t {
+    public:
+        archetype_storage_t(rda_t& rda, size_t initial_chunks = 16);
+        ~archetype_storage_t();
+
+        archetype_storage_t(const archetype_storage_t&) = delete;
+        archetype_storage_t& operator=(const archetype_storage_t&) = delete;
+
+        // creates an entity without any components
+        entity_t create();
+        void destroy(entity_t entity);
+        bool is_alive(entity_t entity) const;
+
+        // Adds T to entity constructed from args, or assigns it if entity already has one.
+        // The returned pointer is good until the entity's components change
+        template<typename T, typename ... params>
+        T* add(entity_t entity, params&& ... args) {
+            static_assert(std::is_move_constructible_v<T>, "archetype components must be move constructible");
+
+            bool  added;
+            void* component = add_component(entity, rda->get_type_id<T>(), added);
+
+            if(!added) {
+                *(T*)component = T(std::forward<params>(args)...);
+                return (T*)component;
+            }
+
+            return new(component) T(std::forward<params>(args)...);
+        }
+
+        template<typename T>
+        void remove(entity_t entity) {
+            remove_component(entity, rda->get_type_id<T>());
+        }
+
+        // returns nullptr if entity does not have a T
+        template<typename T>
+        T* get(entity_t entity) {
+            return (T*)get_component(entity, rda->get_type_id<T>());
+        }
+
+        template<typename T>
+        bool has(entity_t entity) {
+            return get_component(entity, rda->get_type_id<T>()) != nullptr;
+        }
+
+        // Calls func(Ts&...) or func(entity_t, Ts&...) for every entity that has all of Ts.
+        // Keep a query_t around instead when running the same query often
+        template<typename ... Ts, typename func_t>
+        void each(func_t&& func) {
+            query_t<Ts...>(*this).each(std::forward<func_t>(func));
+        }
+
+        // Adds component_id to entity and returns where it is. If entity did not have it
+        // added is set and the component is left for the caller to construct
+        void* add_component(entity_t entity, uint32_t component_id, bool& added);
+        void remove_component(entity_t entity, uint32_t component_id);
+        void* get_component(entity_t entity, uint32_t component_id);
+
+        size_t size() const { return records.size() - free_records.size(); }
+
+        size_t get_archetype_count() const { return archetypes.size(); }
+        archetype_t* get_archetype(size_t index) { return archetypes[index].get(); }
+
+        rda_t& get_rda() { return *rda; }
+
+    private:
+        struct record_t {
+            archetype_t* archetype  = nullptr;
+            uint32_t     row        = 0;
+            uint32_t     generation = 0;
+        };
+
+        archetype_t* find_or_create(std::vector<uint32_t> component_ids);
+
+        // moves the components entity has in common with target, destroys the rest
+        void move_entity(record_t& record, archetype_t* target);
+
+        // takes row out of archetype, fixing the record of the entity moved into it
+        void remove_row(archetype_t* archetype, uint32_t row);
+
+    private:
+        rda_t*                                            rda;
+        std::vector<std::unique_ptr<archetype_t>>         archetypes;
+        std::map<std::vector<uint32_t>, archetype_t*>     archetype_index;
+        archetype_t*                                      empty_archetype;
+        std::vector<record_t>                             records;
+        std::vector<uint32_t>                             free_records;
+    };
+
+    // The entities of an archetype_storage_t that have all of Ts. Remembers which
+    // archetypes match, and only looks at archetypes created since the last each
+    template<typename ... Ts>
+    class query_t {
+    public:
+        query_t(archetype_storage_t& storage)
+            : storage(&storage) {
+            rda_t& rda = storage.get_rda();
+
+            ids = {rda.get_type_id<Ts>()...};
+            sorted_ids = ids;
+            std::sort(sorted_ids.begin(), sorted_ids.end());
+        }
+
+        // calls func(Ts&...) or func(entity_t, Ts&...) for every matching entity
+        template<typename func_t>
+        void each(func_t&& func) {
+            update();
+
+            for(match_t& match : matches) {
+                archetype_t* archetype = match.archetype;
+
+                for(size_t chunk = 0; chunk < archetype->get_chunk_count(); chunk++) {
+                    each_in_chunk(func, archetype, chunk, match.columns, std::index_sequence_for<Ts...>());
+                }
+            }
+        }
+
+        // the number of matching entities
+        size_t size() {
+            update();
+
+            size_t count = 0;
+            for(match_t& match : matches)
+                count += match.archetype->size();
+
+            return count;
+        }
+
+    private:
+        struct match_t {
+            archetype_t*                           archetype;
+            std::array<size_t, sizeof...(Ts)>      columns;
+        };
+
+        void update() {
+            for(; seen_archetypes < storage->get_archetype_count(); seen_archetypes++) {
+                archetype_t* archetype = storage->get_archetype(seen_archetypes);
+                if(!archetype->has_all(sorted_ids.data(), sorted_ids.size()))
+                    continue;
+
+                match_t match;
+                match.archetype = archetype;
+                for(size_t i = 0; i < ids.size(); i++)
+                    match.columns[i] = archetype->find_column(ids[i]);
+
+                matches.push_back(match);
+            }
+        }
+
+        template<typename func_t, size_t ... index>
+        static void each_in_chunk(func_t& func, archetype_t* archetype, size_t chunk,
+                                  const std::array<size_t, sizeof...(Ts)>& columns, std::index_sequence<index...>) {
+            size_t    rows     = archetype->get_chunk_size(chunk);
+            entity_t* entities = archetype->get_entities(chunk);
+
+            std::tuple<Ts*...> arrays = {(Ts*)archetype->get_column(chunk, columns[index])...};
+
+            for(size_t row = 0; row < rows; row++) {
+                if constexpr(std::is_invocable_v<func_t&, entity_t, Ts&...>) {
+                    func(entities[row], std::get<index>(arrays)[row]...);
+                } else {
+                    func(std::get<index>(arrays)[row]...);
+                }
+            }
+        }
+
+    private:
+        archetype_storage_t*               storage;
+        std::array<uint32_t, sizeof...(Ts)> ids;
+        std::array<uint32_t, sizeof...(Ts)> sorted_ids;
+        std::vector<match_t>               matches;
+        size_t                             seen_archetypes = 0;
+    };
+}
@@ -8,6 +8,7 @@
 #include <variant>
 #include <assert.h>
 #include <limits>
+#include <climits>
 #include <memory>
 #include <cstring>
 #include <cstdarg>
@@ -16,6 +17,7 @@
 
 namespace ptm {
     constexpr auto system_alignment = sizeof(void*);
+    constexpr size_t cache_line_bytesize = 64;
 
     typedef void(*log_func_t)(const char*, ...);
 
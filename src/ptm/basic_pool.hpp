@@ -0,0 +1,534 @@
+#pragma once
+
+#include "virtual_memory.hpp"
+#include "bitmap.hpp"
+#include <atomic>
+#include <bit>
+#include <mutex>
+
+// The policies a basic_pool_t is put together from. Each one names its category,
+// a pool takes at most one of each and falls back to the first listed default
+namespace ptm::pool_policy {
+    struct growth_category_t {};
+    struct fit_category_t {};
+    struct thread_category_t {};
+    struct backing_category_t {};
+    struct stats_category_t {};
+    struct alignment_category_t {};
+
+    // what a growth policy is told when the pool is full
+    struct growth_info_t {
+        size_t initial_capacity;
+        size_t last_capacity;
+        size_t chunk_count;
+        size_t live_elements;
+    };
+
+    // growth: how many elements the next chunk holds, 0 to stop growing
+
+    // every chunk is twice the size of the last (default)
+    struct doubling_growth_t {
+        using policy_category = growth_category_t;
+        size_t next_capacity(const growth_info_t& info) { return info.last_capacity * 2; }
+    };
+
+    // every chunk is the size of the first
+    struct linear_growth_t {
+        using policy_category = growth_category_t;
+        size_t next_capacity(const growth_info_t& info) { return info.initial_capacity; }
+    };
+
+    // the pool never grows, allocate returns nullptr once it is full
+    struct fixed_size_t {
+        using policy_category = growth_category_t;
+        size_t next_capacity(const growth_info_t& info) { return 0; }
+    };
+
+    // fit: where in the free elements an allocation goes
+
+    // the first free run from the start of the pool (default)
+    struct first_fit_t {
+        using policy_category = fit_category_t;
+    };
+
+    // the first free run after the last allocation, wrapping around
+    struct next_fit_t {
+        using policy_category = fit_category_t;
+    };
+
+    // the smallest free run that is big enough, scans the whole pool
+    struct best_fit_t {
+        using policy_category = fit_category_t;
+    };
+
+    // thread safety
+
+    // no locking at all (default)
+    struct single_threaded_t {
+        using policy_category = thread_category_t;
+    };
+
+    // every allocate and deallocate holds a mutex
+    struct mutex_locked_t {
+        using policy_category = thread_category_t;
+    };
+
+    // Elements are claimed with a compare and swap on the free bits, only growing
+    // takes a lock. Allocates one element at a time and does not support best_fit_t
+    struct lock_free_t {
+        using policy_category = thread_category_t;
+    };
+
+    // backing store: where chunks come from
+
+    // malloc and free (default)
+    struct malloc_backed_t {
+        using policy_category = backing_category_t;
+        static void* allocate(size_t bytesize) { return malloc(bytesize); }
+        static void deallocate(void* ptr, size_t bytesize) { free(ptr); }
+    };
+
+    // page aligned mappings of their own, given back to the OS when the pool is destroyed
+    struct virtual_memory_backed_t {
+        using policy_category = backing_category_t;
+        static void* allocate(size_t bytesize) { return map_virtual_memory(round_up(bytesize, page_size())); }
+        static void deallocate(void* ptr, size_t bytesize) { release_virtual_memory(ptr, round_up(bytesize, page_size())); }
+    };
+
+    // like virtual_memory_backed_t but on huge pages when the system has them
+    struct huge_page_backed_t {
+        using policy_category = backing_category_t;
+        static void* allocate(size_t bytesize) { return map_huge_virtual_memory(round_up(bytesize, huge_page_size())); }
+        static void deallocate(void* ptr, size_t bytesize) { release_virtual_memory(ptr, round_up(bytesize, huge_page_size())); }
+    };
+
+    // stats
+
+    // nothing is counted (default)
+    struct no_stats_t {
+        using policy_category = stats_category_t;
+    };
+
+    // counts allocations, frees and the peak number of live elements, see get_stats
+    struct counted_stats_t {
+        using policy_category = stats_category_t;
+    };
+
+    // Aligns every element to alignment bytes, which pads elements smaller than it.
+    // A padded pool allocates one element at a time (default is alignof(T))
+    template<size_t alignment>
+    struct aligned_t {
+        static_assert((alignment & (alignment - 1)) == 0, "alignment must be a power of two");
+
+        using policy_category = alignment_category_t;
+        static constexpr size_t value = alignment;
+    };
+
+    // the policy of category_t in policies, or default_t if there is none
+    template<typename category_t, typename default_t, typename ... policies>
+    struct select_t {
+        using type = default_t;
+    };
+
+    template<typename category_t, typename default_t, typename first_t, typename ... rest>
+    struct select_t<category_t, default_t, first_t, rest...> {
+        using type = std::conditional_t<std::is_same_v<typename first_t::policy_category, category_t>, first_t,
+                                        typename select_t<category_t, default_t, rest...>::type>;
+    };
+
+    template<typename category_t, typename default_t, typename ... policies>
+    using select = typename select_t<category_t, default_t, policies...>::type;
+}
+
+namespace ptm {
+    struct pool_stats_t {
+        size_t allocations        = 0;
+        size_t deallocations      = 0;
+        size_t live_elements      = 0;
+        size_t peak_live_elements = 0;
+        size_t chunks             = 0;
+        size_t capacity           = 0;
+    };
+
+    // A pool of T put together from compile time policies, see ptm::pool_policy.
+    // Every combination is its own class, so policies that are not used cost nothing:
+    //   basic_pool_t<T>                                        like object_pool_t
+    //   basic_pool_t<T, pool_policy::lock_free_t>              for many threads
+    //   basic_pool_t<T, pool_policy::fixed_size_t, pool_policy::virtual_memory_backed_t>
+    // Memory comes in chunks, each with a bit per element telling if it is in use,
+    // searched like the other pools' bits, see bitmap.hpp
+    template<typename T, typename ... policies>
+    class basic_pool_t {
+        using growth_t    = pool_policy::select<pool_policy::growth_category_t, pool_policy::doubling_growth_t, policies...>;
+        using fit_t       = pool_policy::select<pool_policy::fit_category_t, pool_policy::first_fit_t, policies...>;
+        using thread_t    = pool_policy::select<pool_policy::thread_category_t, pool_policy::single_threaded_t, policies...>;
+        using backing_t   = pool_policy::select<pool_policy::backing_category_t, pool_policy::malloc_backed_t, policies...>;
+        using stats_t     = pool_policy::select<pool_policy::stats_category_t, pool_policy::no_stats_t, policies...>;
+        using alignment_t = pool_policy::select<pool_policy::alignment_category_t, pool_policy::aligned_t<alignof(T)>, policies...>;
+
+        static constexpr bool is_lock_free = std::is_same_v<thread_t, pool_policy::lock_free_t>;
+        static constexpr bool is_locked    = std::is_same_v<thread_t, pool_policy::mutex_locked_t>;
+        static constexpr bool is_counted   = std::is_same_v<stats_t, pool_policy::counted_stats_t>;
+
+        static_assert(!(is_lock_free && std::is_same_v<fit_t, pool_policy::best_fit_t>), "a lock free pool can not best fit");
+        static_assert(alignment_t::value >= alignof(T), "elements can not be aligned less than their type");
+
+    public:
+        static constexpr size_t element_alignment = alignment_t::value;
+        static constexpr size_t element_stride    = round_up(sizeof(T), element_alignment);
+        static constexpr size_t max_chunks        = 64;
+
+        basic_pool_t(size_t initial_capacity = 100, growth_t growth = growth_t())
+            : initial_capacity(initial_capacity), growth(growth) {
+            add_chunk(initial_capacity);
+        }
+
+        ~basic_pool_t() {
+            for(size_t i = 0; i < chunk_count.load(std::memory_order_relaxed); i++) {
+                chunk_t* chunk = chunks[i].load(std::memory_order_relaxed);
+                backing_t::deallocate(chunk, chunk->bytesize);
+            }
+        }
+
+        basic_pool_t(const basic_pool_t&) = delete;
+        basic_pool_t& operator=(const basic_pool_t&) = delete;
+
+        // n elements in a row, nullptr if they can not be found and the pool can't grow
+        T* allocate(size_t n = 1) {
+            assert(n > 0);
+            assert((n == 1 || element_stride == sizeof(T)) && "padded elements are allocated one at a time");
+
+            if constexpr(is_lock_free) {
+                assert(n == 1 && "a lock free pool allocates one element at a time");
+                return allocate_lock_free();
+            } else if constexpr(is_locked) {
+                std::lock_guard<std::mutex> lock(mutex);
+                return allocate_locked(n);
+            } else {
+                return allocate_locked(n);
+            }
+        }
+
+        void deallocate(T* elements, size_t n = 1) {
+            if constexpr(is_locked) {
+                std::lock_guard<std::mutex> lock(mutex);
+                deallocate_locked(elements, n);
+            } else {
+                deallocate_locked(elements, n);
+            }
+        }
+
+        template<typename ... params>
+        T* create(params&& ... args) {
+            T* element = allocate(1);
+            return element ? new(element) T(std::forward<params>(args)...) : nullptr;
+        }
+
+        void destroy(T* element) {
+            element->~T();
+            deallocate(element, 1);
+        }
+
+        bool owns(const T* element) { return find_chunk(element) != nullptr; }
+
+        size_t get_chunk_count() { return chunk_count.load(std::memory_order_acquire); }
+
+        // the total number of elements of every chunk
+        size_t get_capacity() {
+            size_t capacity = 0;
+            for(size_t i = 0; i < get_chunk_count(); i++)
+                capacity += chunks[i].load(std::memory_order_relaxed)->capacity;
+
+            return capacity;
+        }
+
+        pool_stats_t get_stats() requires is_counted {
+            pool_stats_t stats;
+            stats.allocations        = load(counters.allocations);
+            stats.deallocations      = load(counters.deallocations);
+            stats.live_elements      = load(counters.live_elements);
+            stats.peak_live_elements = load(counters.peak_live_elements);
+            stats.chunks             = get_chunk_count();
+            stats.capacity           = get_capacity();
+
+            return stats;
+        }
+
+        growth_t& get_growth() { return growth; }
+
+    private:
+        static constexpr size_t bits_per_word = 64;
+        static constexpr size_t not_found     = SIZE_MAX;
+
+        // the chunk header is followed by the bits and then the elements
+        struct chunk_t {
+            size_t                 capacity;
+            size_t                 word_count;
+            size_t                 bytesize;
+            uint8_t*               elements;
+            std::atomic<uint64_t>* words;
+        };
+
+        using counter_t = std::conditional_t<is_lock_free, std::atomic<size_t>, size_t>;
+
+        struct counters_t {
+            counter_t allocations        = 0;
+            counter_t deallocations      = 0;
+            counter_t live_elements      = 0;
+            counter_t peak_live_elements = 0;
+        };
+
+        struct empty_t {};
+
+        static size_t load(const counter_t& counter) {
+            if constexpr(is_lock_free) {
+                return counter.load(std::memory_order_relaxed);
+            } else {
+                return counter;
+            }
+        }
+
+        // free runs are found by the bits, a set bit is an element in use
+        static uint64_t load_word(chunk_t* chunk, size_t word) {
+            return chunk->words[word].load(std::memory_order_relaxed);
+        }
+
+        chunk_t* add_chunk(size_t capacity) {
+            size_t index = chunk_count.load(std::memory_order_relaxed);
+            if(index == max_chunks) {
+                log("basic_pool_t has reached its limit of %zu chunks\n", max_chunks);
+                return nullptr;
+            }
+
+            size_t word_count     = (capacity + bits_per_word - 1) / bits_per_word;
+            size_t words_offset   = round_up(sizeof(chunk_t), alignof(std::atomic<uint64_t>));
+            size_t elements_start = words_offset + word_count * sizeof(uint64_t);
+            size_t bytesize       = elements_start + element_alignment + capacity * element_stride;
+
+            chunk_t* chunk = (chunk_t*)backing_t::allocate(bytesize);
+            if(!chunk) {
+                log("basic_pool_t could not allocate a chunk of %zu bytes\n", bytesize);
+                return nullptr;
+            }
+
+            chunk->capacity   = capacity;
+            chunk->word_count = word_count;
+            chunk->bytesize   = bytesize;
+            chunk->words      = (std::atomic<uint64_t>*)((uint8_t*)chunk + words_offset);
+            chunk->elements   = (uint8_t*)round_up((size_t)chunk + elements_start, element_alignment);
+
+            for(size_t i = 0; i < word_count; i++)
+                new(&chunk->words[i]) std::atomic<uint64_t>(0);
+
+            // the bits past the last element look used, so no run goes past it
+            if(capacity % bits_per_word)
+                chunk->words[word_count - 1].store(~0ull << (capacity % bits_per_word), std::memory_order_relaxed);
+
+            chunks[index].store(chunk, std::memory_order_relaxed);
+            chunk_count.store(index + 1, std::memory_order_release);
+
+            return chunk;
+        }
+
+        // asks the growth policy for a chunk with room for at least n elements
+        chunk_t* grow(size_t n) {
+            size_t   count = chunk_count.load(std::memory_order_relaxed);
+            chunk_t* last  = chunks[count - 1].load(std::memory_order_relaxed);
+
+            pool_policy::growth_info_t info;
+            info.initial_capacity = initial_capacity;
+            info.last_capacity    = last->capacity;
+            info.chunk_count      = count;
+            info.live_elements    = 0;
+
+            if constexpr(is_counted)
+                info.live_elements = load(counters.live_elements);
+
+            size_t capacity = growth.next_capacity(info);
+            if(capacity == 0)
+                return nullptr;
+
+            return add_chunk(std::max(capacity, n));
+        }
+
+        chunk_t* find_chunk(const void* element) {
+            for(size_t i = 0; i < get_chunk_count(); i++) {
+                chunk_t* chunk = chunks[i].load(std::memory_order_relaxed);
+                if(chunk->elements <= (uint8_t*)element && (uint8_t*)element < chunk->elements + chunk->capacity * element_stride)
+                    return chunk;
+            }
+
+            return nullptr;
+        }
+
+        // Calls visit(start, length) with every free run in the chunk from bit begin on,
+        // until visit returns true. Returns whether it did
+        template<typename visit_t>
+        static bool for_each_free_run(chunk_t* chunk, size_t begin, visit_t&& visit) {
+            return for_each_free_bits([chunk](size_t word) { return load_word(chunk, word); }, begin, chunk->capacity, visit);
+        }
+
+        // the first run of n free elements in the chunk at or after begin
+        static size_t find_first(chunk_t* chunk, size_t begin, size_t n) {
+            return find_free_bits([chunk](size_t word) { return load_word(chunk, word); }, begin, chunk->capacity, chunk->capacity, n);
+        }
+
+        void set_bits(chunk_t* chunk, size_t index, size_t n, bool in_use) {
+            while(n > 0) {
+                size_t   bit   = index % bits_per_word;
+                size_t   count = std::min(n, bits_per_word - bit);
+                uint64_t mask  = (count == bits_per_word ? ~0ull : ((1ull << count) - 1)) << bit;
+
+                std::atomic<uint64_t>& word = chunk->words[index / bits_per_word];
+                if constexpr(is_lock_free) {
+                    in_use ? word.fetch_or(mask, std::memory_order_acquire) : word.fetch_and(~mask, std::memory_order_release);
+                } else {
+                    word.store(in_use ? (load_word(chunk, index / bits_per_word) | mask)
+                                      : (load_word(chunk, index / bits_per_word) & ~mask), std::memory_order_relaxed);
+                }
+
+                index += count;
+                n     -= count;
+            }
+        }
+
+        T* claim(size_t chunk_index, size_t index, size_t n) {
+            chunk_t* chunk = chunks[chunk_index].load(std::memory_order_relaxed);
+
+            set_bits(chunk, index, n, true);
+            count_allocation(n);
+
+            if constexpr(std::is_same_v<fit_t, pool_policy::next_fit_t>)
+                cursor = {chunk_index, index + n};
+
+            return (T*)(chunk->elements + index * element_stride);
+        }
+
+        T* allocate_locked(size_t n) {
+            size_t count = chunk_count.load(std::memory_order_relaxed);
+
+            if constexpr(std::is_same_v<fit_t, pool_policy::best_fit_t>) {
+                size_t best_chunk = not_found, best_index = not_found, best_length = SIZE_MAX;
+
+                for(size_t i = 0; i < count && best_length != n; i++) {
+                    for_each_free_run(chunks[i].load(std::memory_order_relaxed), 0, [&](size_t start, size_t length) {
+                        if(length >= n && length < best_length) {
+                            best_chunk  = i;
+                            best_index  = start;
+                            best_length = length;
+                        }
+
+                        // nothing beats an exact fit
+                        return best_length == n;
+                    });
+                }
+
+                if(best_chunk != not_found)
+                    return claim(best_chunk, best_index, n);
+            } else if constexpr(std::is_same_v<fit_t, pool_policy::next_fit_t>) {
+                // from the cursor to the end, then from the start back round to the cursor
+                for(size_t i = 0; i <= count; i++) {
+                    size_t   chunk_index = (cursor.chunk + i) % count;
+                    chunk_t* chunk       = chunks[chunk_index].load(std::memory_order_relaxed);
+                    size_t   begin       = i == 0 ? cursor.index : 0;
+
+                    size_t found = find_first(chunk, begin, n);
+                    if(found != not_found)
+                        return claim(chunk_index, found, n);
+                }
+            } else {
+                for(size_t i = 0; i < count; i++) {
+                    size_t found = find_first(chunks[i].load(std::memory_order_relaxed), 0, n);
+                    if(found != not_found)
+                        return claim(i, found, n);
+                }
+            }
+
+            if(!grow(n))
+                return nullptr;
+
+            return claim(chunk_count.load(std::memory_order_relaxed) - 1, 0, n);
+        }
+
+        T* allocate_lock_free() {
+            while(true) {
+                size_t count = chunk_count.load(std::memory_order_acquire);
+                size_t start = 0;
+
+                if constexpr(std::is_same_v<fit_t, pool_policy::next_fit_t>)
+                    start = shared_cursor.load(std::memory_order_relaxed) % count;
+
+                for(size_t i = 0; i < count; i++) {
+                    size_t   chunk_index = (start + i) % count;
+                    chunk_t* chunk       = chunks[chunk_index].load(std::memory_order_relaxed);
+
+                    for(size_t word = 0; word < chunk->word_count; word++) {
+                        uint64_t used = load_word(chunk, word);
+
+                        while(used != ~0ull) {
+                            uint64_t bit = 1ull << std::countr_zero(~used);
+
+                            if(chunk->words[word].compare_exchange_weak(used, used | bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                                if constexpr(std::is_same_v<fit_t, pool_policy::next_fit_t>)
+                                    shared_cursor.store(chunk_index, std::memory_order_relaxed);
+
+                                count_allocation(1);
+                                return (T*)(chunk->elements + (word * bits_per_word + std::countr_zero(bit)) * element_stride);
+                            }
+                        }
+                    }
+                }
+
+                // only one thread grows, the others look again once it is done
+                std::lock_guard<std::mutex> lock(mutex);
+                if(chunk_count.load(std::memory_order_acquire) == count && !grow(1))
+                    return nullptr;
+            }
+        }
+
+        void deallocate_locked(T* elements, size_t n) {
+            chunk_t* chunk = find_chunk(elements);
+            assert(chunk && "the elements are not from this pool");
+
+            set_bits(chunk, ((uint8_t*)elements - chunk->elements) / element_stride, n, false);
+
+            if constexpr(is_counted) {
+                counters.deallocations += n;
+                counters.live_elements -= n;
+            }
+        }
+
+        void count_allocation(size_t n) {
+            if constexpr(is_counted) {
+                counters.allocations += n;
+                size_t live = (counters.live_elements += n);
+
+                if constexpr(is_lock_free) {
+                    size_t peak = counters.peak_live_elements.load(std::memory_order_relaxed);
+                    while(live > peak && !counters.peak_live_elements.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+                } else {
+                    counters.peak_live_elements = std::max(counters.peak_live_elements, live);
+                }
+            }
+        }
+
+    private:
+        struct cursor_t {
+            size_t chunk = 0;
+            size_t index = 0;
+        };
+
+        size_t                            initial_capacity;
+        [[no_unique_address]] growth_t    growth;
+        std::atomic<chunk_t*>             chunks[max_chunks] = {};
+        std::atomic<size_t>               chunk_count = 0;
+
+        // next_fit_t carries on from here
+        [[no_unique_address]] std::conditional_t<std::is_same_v<fit_t, pool_policy::next_fit_t> && !is_lock_free, cursor_t, empty_t> cursor;
+        [[no_unique_address]] std::conditional_t<std::is_same_v<fit_t, pool_policy::next_fit_t> && is_lock_free, std::atomic<size_t>, empty_t> shared_cursor;
+
+        // mutex_locked_t holds it for everything, lock_free_t only to grow
+        [[no_unique_address]] std::conditional_t<is_locked || is_lock_free, std::mutex, empty_t> mutex;
+        [[no_unique_address]] std::conditional_t<is_counted, counters_t, empty_t> counters;
+    };
+}
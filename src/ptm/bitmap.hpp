@@ -0,0 +1,163 @@
+#pragma once
+
+#include "base.hpp"
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+
+// The search for free elements shared by the pools that keep a bit per element,
+// a set bit being an element in use. The bits are read a word at a time through
+// load(i), which returns the i'th word, so pools can keep them in bytes or in
+// atomic words. Bit i is bit i % bits of word i / bits
+namespace ptm {
+    // The first run of n free bits that starts in [begin, end), SIZE_MAX if there is
+    // none. A run that starts before end may finish past it, up to max_bits, so the
+    // bits of the last word past max_bits can be anything. Each word is loaded once,
+    // the free and used runs in it are found with countr_zero
+    template<typename load_t>
+    size_t find_free_bits(load_t&& load, size_t begin, size_t end, size_t max_bits, size_t n) {
+        using word_t = std::decay_t<decltype(load(0))>;
+        constexpr size_t word_bits = sizeof(word_t) * 8;
+
+        size_t index  = SIZE_MAX;
+        size_t bit    = begin;
+        bool   in_run = false;
+
+        while(bit < max_bits && (in_run || bit < end)) {
+            word_t word = load(bit / word_bits);
+
+            if(!in_run) {
+                // on to the next free bit, or the next word if there is none in this one
+                word_t unused = (word_t)((word_t)~word >> (bit % word_bits));
+                if(!unused) {
+                    bit += word_bits - bit % word_bits;
+                    continue;
+                }
+
+                bit += std::countr_zero(unused);
+                if(bit >= end || bit >= max_bits) {
+                    break;
+                }
+
+                index = bit;
+                if(n == 1) {
+                    return index;
+                }
+            }
+
+            // the free bits from here to the next used one or the end of the word
+            word_t used = (word_t)(word >> (bit % word_bits));
+            size_t free = used ? (size_t)std::countr_zero(used) : word_bits - bit % word_bits;
+
+            bit = std::min(bit + free, max_bits);
+            if(bit - index >= n) {
+                return index;
+            }
+
+            // a run that reaches the end of the word goes on in the next one
+            in_run = !used;
+        }
+
+        return SIZE_MAX;
+    }
+
+    // Calls visit(start, length) with every run of free bits in [begin, max_bits) in
+    // order, until visit returns true. Returns whether it did
+    template<typename load_t, typename visit_t>
+    bool for_each_free_bits(load_t&& load, size_t begin, size_t max_bits, visit_t&& visit) {
+        using word_t = std::decay_t<decltype(load(0))>;
+        constexpr size_t word_bits = sizeof(word_t) * 8;
+
+        size_t index = begin;
+
+        while(index < max_bits) {
+            word_t used = (word_t)(load(index / word_bits) >> (index % word_bits));
+
+            // skip to the end of the used run, shifting in zeros keeps ~used non zero
+            if(used & 1) {
+                index += std::countr_zero((word_t)~used);
+                continue;
+            }
+
+            size_t start = index;
+            while(index < max_bits) {
+                used = (word_t)(load(index / word_bits) >> (index % word_bits));
+                if(used) {
+                    index += std::countr_zero(used);
+                    break;
+                }
+
+                index += word_bits - index % word_bits;
+            }
+
+            index = std::min(index, max_bits);
+            if(visit(start, index - start)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // next fit, the first run of n free bits at or after start, wrapping round to the
+    // beginning. SIZE_MAX if there is none
+    template<typename load_t>
+    size_t find_free_bits_from(load_t&& load, size_t start, size_t max_bits, size_t n) {
+        size_t index = find_free_bits(load, start, max_bits, max_bits, n);
+        if(index == SIZE_MAX) {
+            index = find_free_bits(load, 0, start, max_bits, n);
+        }
+
+        return index;
+    }
+
+    // where the free bits at the end of the first max_bits begin, max_bits if the
+    // last one is in use
+    template<typename load_t>
+    size_t free_tail_of_bits(load_t&& load, size_t max_bits) {
+        using word_t = std::decay_t<decltype(load(0))>;
+        constexpr size_t word_bits = sizeof(word_t) * 8;
+
+        size_t tail = max_bits;
+        while(tail > 0) {
+            // whole free words at once
+            if(tail % word_bits == 0 && load(tail / word_bits - 1) == 0) {
+                tail -= word_bits;
+                continue;
+            }
+
+            if(load((tail - 1) / word_bits) & ((word_t)1 << ((tail - 1) % word_bits))) {
+                break;
+            }
+
+            tail--;
+        }
+
+        return tail;
+    }
+
+    // Next fit for pools that can grow up to reserved_max_bits. When no run fits in
+    // max_bits the pool is grown to twice its size, or only as much as the run needs
+    // if that is more than the reservation, by grow(new_max_bits) which returns false
+    // when it fails. The run then starts at the free tail so it uses what is already
+    // there. SIZE_MAX if the pool could not grow
+    template<typename load_t, typename grow_t>
+    size_t find_free_bits_or_grow(load_t&& load, size_t start, size_t max_bits, size_t reserved_max_bits, size_t n, grow_t&& grow) {
+        size_t index = find_free_bits_from(load, start, max_bits, n);
+        if(index != SIZE_MAX) {
+            return index;
+        }
+
+        size_t tail         = free_tail_of_bits(load, max_bits);
+        size_t new_max_bits = std::max(max_bits * 2, tail + n);
+        if(new_max_bits > reserved_max_bits) {
+            new_max_bits = tail + n;
+        }
+
+        if(!grow(new_max_bits)) {
+            return SIZE_MAX;
+        }
+
+        return tail;
+    }
+}
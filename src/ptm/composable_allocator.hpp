@@ -0,0 +1,163 @@
+#pragma once
+
+#include "memory_pool.hpp"
+#include "stack_allocator.hpp"
+#include <array>
+
+// Allocators that are put together at compile time. Every one of them has
+//   void* allocate(size_t bytesize)
+//   void  deallocate(void* ptr, size_t bytesize)
+//   bool  owns(const void* ptr)
+// and nothing is virtual, so a composed allocator inlines down to the same
+// branches a hand written one would have
+namespace ptm {
+    // malloc and free, owns everything so it goes last in a fallback_t
+    struct malloc_allocator_t {
+        void* allocate(size_t bytesize) { return malloc(bytesize); }
+        void deallocate(void* ptr, size_t bytesize) { free(ptr); }
+        bool owns(const void* ptr) { return true; }
+    };
+
+    // A stack_allocator_t over a buffer inside itself. Only the newest allocation can
+    // be given back, anything else stays in use until reset
+    template<size_t capacity, size_t arena_alignment = stack_allocator_t::default_alignment>
+    class stack_arena_t : public stack_allocator_t {
+    public:
+        stack_arena_t()
+            : stack_allocator_t(buffer, capacity, arena_alignment) {}
+
+    private:
+        alignas(arena_alignment) uint8_t buffer[capacity];
+    };
+
+    // A sparse memory pool of element_bytesize blocks, returns nullptr for anything bigger
+    class pool_allocator_t {
+    public:
+        pool_allocator_t(size_t element_bytesize, size_t initial_max_elements = 100)
+            : element_bytesize(element_bytesize), pool(element_bytesize, initial_max_elements) {}
+
+        void* allocate(size_t bytesize) {
+            return bytesize <= element_bytesize ? pool.allocate(1) : nullptr;
+        }
+
+        void deallocate(void* ptr, size_t bytesize) { pool.deallocate(ptr, 1); }
+        bool owns(const void* ptr) { return pool.owns(ptr); }
+
+    private:
+        size_t                     element_bytesize;
+        _impl_sparse_memory_pool_t pool;
+    };
+
+    // A pool_allocator_t with its sizes fixed at compile time, so segregator_t and
+    // fallback_t can default construct it
+    template<size_t element_bytesize, size_t initial_max_elements = 100>
+    struct sized_pool_allocator_t : pool_allocator_t {
+        sized_pool_allocator_t()
+            : pool_allocator_t(element_bytesize, initial_max_elements) {}
+    };
+
+    // Sends requests of up to threshold bytes to small_t and the rest to large_t.
+    // The size given to deallocate picks the side, owns is not needed
+    template<size_t threshold, typename small_t, typename large_t>
+    class segregator_t {
+    public:
+        void* allocate(size_t bytesize) {
+            return bytesize <= threshold ? small.allocate(bytesize) : large.allocate(bytesize);
+        }
+
+        void deallocate(void* ptr, size_t bytesize) {
+            if(bytesize <= threshold) {
+                small.deallocate(ptr, bytesize);
+            } else {
+                large.deallocate(ptr, bytesize);
+            }
+        }
+
+        bool owns(const void* ptr) { return small.owns(ptr) || large.owns(ptr); }
+
+        small_t& get_small() { return small; }
+        large_t& get_large() { return large; }
+
+    private:
+        small_t small;
+        large_t large;
+    };
+
+    // Tries primary_t first and secondary_t when it fails. Frees go to
+    // whichever one owns the pointer
+    template<typename primary_t, typename secondary_t>
+    class fallback_t {
+    public:
+        void* allocate(size_t bytesize) {
+            void* ptr = primary.allocate(bytesize);
+            return ptr ? ptr : secondary.allocate(bytesize);
+        }
+
+        void deallocate(void* ptr, size_t bytesize) {
+            if(primary.owns(ptr)) {
+                primary.deallocate(ptr, bytesize);
+            } else {
+                secondary.deallocate(ptr, bytesize);
+            }
+        }
+
+        bool owns(const void* ptr) { return primary.owns(ptr) || secondary.owns(ptr); }
+
+        primary_t& get_primary() { return primary; }
+        secondary_t& get_secondary() { return secondary; }
+
+    private:
+        primary_t   primary;
+        secondary_t secondary;
+    };
+
+    // One alloc_t for every step bytes in (min, max], each made with the biggest size it
+    // serves, and a request goes to the smallest bucket it fits in. The buckets are an
+    // array so picking one is arithmetic, not a branch. Sizes outside the range are
+    // not served, put a bucketizer_t in a segregator_t to handle them
+    template<typename alloc_t, size_t min, size_t max, size_t step>
+    class bucketizer_t {
+        static_assert(min < max && (max - min) % step == 0, "the range must be a whole number of steps");
+
+    public:
+        static constexpr size_t bucket_count = (max - min) / step;
+
+        bucketizer_t()
+            : buckets(make_buckets(std::make_index_sequence<bucket_count>())) {}
+
+        void* allocate(size_t bytesize) {
+            if(bytesize <= min || bytesize > max)
+                return nullptr;
+
+            return buckets[bucket_of(bytesize)].allocate(bytesize);
+        }
+
+        void deallocate(void* ptr, size_t bytesize) {
+            assert(bytesize > min && bytesize <= max && "the size was not served by this bucketizer");
+            if(bytesize <= min || bytesize > max)
+                return;
+
+            buckets[bucket_of(bytesize)].deallocate(ptr, bytesize);
+        }
+
+        bool owns(const void* ptr) {
+            for(alloc_t& bucket : buckets) {
+                if(bucket.owns(ptr))
+                    return true;
+            }
+
+            return false;
+        }
+
+    private:
+        template<size_t ... index>
+        static std::array<alloc_t, bucket_count> make_buckets(std::index_sequence<index...>) {
+            return {alloc_t(min + (index + 1) * step)...};
+        }
+
+        static size_t bucket_of(size_t bytesize) { return (bytesize - min - 1) / step; }
+
+    private:
+        std::array<alloc_t, bucket_count> buckets;
+    };
+}
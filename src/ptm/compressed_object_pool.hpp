@@ -0,0 +1,60 @@
+#pragma once
+
+#include "reserved_memory_pool.hpp"
+#include "pointer.hpp"
+
+namespace ptm {
+    // An object pool whose objects are referred to by 32 bit pool_ptr_t instead of
+    // 8 byte pointers. It is backed by a reserved pool capped at 4 GiB so every object
+    // has a 32 bit offset from the same base that never moves. The base is static,
+    // only one pool per T and tag_t may exist at a time; use tag_t to have more
+    template<typename T, typename tag_t = T>
+    class compressed_object_pool_t {
+    public:
+        using pointer_t = pool_ptr_t<T, compressed_object_pool_t<T, tag_t>>;
+
+        // the base sits below the first element so no object is ever at offset 0
+        static constexpr size_t base_bias = alignof(T) > 16 ? alignof(T) : 16;
+        static constexpr size_t max_reserved_elements = (UINT32_MAX - base_bias) / sizeof(T);
+
+        compressed_object_pool_t(size_t initial_max_elements = 100, size_t reserved_max_elements = max_reserved_elements)
+            : pool(sizeof(T), initial_max_elements, std::min(reserved_max_elements, max_reserved_elements)) {
+            assert(pool_base == nullptr);
+
+            pool_base = (uint8_t*)pool.get_block() - base_bias;
+        }
+
+        ~compressed_object_pool_t() {
+            pool_base = nullptr;
+        }
+
+        compressed_object_pool_t(const compressed_object_pool_t&) = delete;
+        compressed_object_pool_t& operator=(const compressed_object_pool_t&) = delete;
+
+        static uint8_t* base() {
+            return pool_base;
+        }
+
+        template<typename ... params>
+        pointer_t create(params&& ... args) {
+            T* object = (T*)pool.allocate(1);
+
+            if(object)
+                new(object)T(std::forward<params>(args)...);
+
+            return pointer_t(object);
+        }
+
+        void destroy(pointer_t ptr) {
+            T* object = ptr.get();
+
+            object->~T();
+            pool.deallocate((void*)object, 1);
+        }
+
+    private:
+        static inline uint8_t* pool_base = nullptr;
+
+        _impl_reserved_memory_pool_t pool;
+    };
+}
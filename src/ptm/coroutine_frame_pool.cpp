@@ -0,0 +1,61 @@
+#include "coroutine_frame_pool.hpp"
+
+namespace ptm {
+    void* coroutine_frame_pool_t::allocate(size_t bytesize) {
+        size_t total_bytesize = bytesize + sizeof(frame_header_t);
+        size_t index          = (total_bytesize - 1) / bucket_step;
+
+        frame_header_t* header;
+
+        if(index >= bucket_count) {
+            header = (frame_header_t*)::operator new(total_bytesize);
+            header->pool = nullptr;
+
+            return header + 1;
+        }
+
+        bucket_t& bucket = buckets[index];
+
+        if(bucket.cache) {
+            header = (frame_header_t*)bucket.cache;
+            bucket.cache = bucket.cache->next;
+            bucket.cache_size--;
+        } else {
+            if(!bucket.pool)
+                bucket.pool = std::make_unique<_impl_owned_memory_pool_t>((index + 1) * bucket_step, initial_frames_per_bucket);
+
+            header = (frame_header_t*)bucket.pool->allocate(1);
+            if(!header)
+                throw std::bad_alloc();
+        }
+
+        header->pool   = this;
+        header->bucket = index;
+
+        return header + 1;
+    }
+
+    void coroutine_frame_pool_t::deallocate(void* frame) {
+        frame_header_t* header = (frame_header_t*)frame - 1;
+
+        if(!header->pool) {
+            ::operator delete(header);
+            return;
+        }
+
+        bucket_t& bucket = header->pool->buckets[header->bucket];
+
+        // only the owning thread may touch the cache, everyone
+        // else goes through the remote frees of the owned pool
+        if(header->pool == &thread_pool() && bucket.cache_size < cache_limit) {
+            cached_frame_t* cached = (cached_frame_t*)header;
+
+            cached->next = bucket.cache;
+            bucket.cache = cached;
+            bucket.cache_size++;
+            return;
+        }
+
+        bucket.pool->deallocate(header, 1);
+    }
+}
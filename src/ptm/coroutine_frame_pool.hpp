@@ -0,0 +1,63 @@
+#pragma once
+
+#include "owned_memory_pool.hpp"
+
+namespace ptm {
+    // Hands out coroutine frames from a set of pools bucketed by frame size.
+    // Each thread allocates from its own pool and keeps a small cache of frames it
+    // freed itself. Frames may be destroyed from any thread but must be destroyed
+    // before the thread that allocated them exits
+    class coroutine_frame_pool_t {
+    public:
+        static constexpr size_t bucket_step  = 64;
+        static constexpr size_t bucket_count = 16; // frames bigger than this go to ::operator new
+        static constexpr size_t cache_limit  = 256; // cached frames per bucket
+
+        coroutine_frame_pool_t(size_t initial_frames_per_bucket = 64)
+            : initial_frames_per_bucket(initial_frames_per_bucket) {}
+
+        void* allocate(size_t bytesize);
+        static void deallocate(void* frame);
+
+        // the pool of the calling thread
+        static coroutine_frame_pool_t& thread_pool() {
+            static thread_local coroutine_frame_pool_t pool;
+
+            return pool;
+        }
+
+    private:
+        // put in front of every frame so it can find its way back to its pool,
+        // 16 bytes so the frame keeps the alignment of operator new
+        struct alignas(16) frame_header_t {
+            coroutine_frame_pool_t* pool;
+            size_t                  bucket;
+        };
+
+        // written over a cached frame
+        struct cached_frame_t {
+            cached_frame_t* next;
+        };
+
+        struct bucket_t {
+            std::unique_ptr<_impl_owned_memory_pool_t> pool;
+            cached_frame_t* cache      = nullptr;
+            size_t          cache_size = 0;
+        };
+
+        size_t   initial_frames_per_bucket;
+        bucket_t buckets[bucket_count];
+    };
+
+    // Inherit from this in a coroutine's promise type to allocate its frames
+    // from the thread's coroutine_frame_pool_t instead of the global heap
+    struct pooled_coroutine_frame_t {
+        static void* operator new(size_t bytesize) {
+            return coroutine_frame_pool_t::thread_pool().allocate(bytesize);
+        }
+
+        static void operator delete(void* frame) {
+            coroutine_frame_pool_t::deallocate(frame);
+        }
+    };
+}
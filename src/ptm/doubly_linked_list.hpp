@@ -3,12 +3,12 @@
 #include "base.hpp"
 
 namespace ptm {
+    // T must derive from this. See intrusive_list_t for a list with iterators,
+    // splicing and objects that are in more than one list
     struct doubly_linked_list_element_t {
         doubly_linked_list_element_t()
             : prev(nullptr), next(nullptr) {}
 
-        virtual ~doubly_linked_list_element_t() = default;
-
         doubly_linked_list_element_t* prev;
         doubly_linked_list_element_t* next;
     };
@@ -43,7 +43,7 @@ namespace ptm {
 
     template<typename T>
     void doubly_linked_list_header_t<T>::push_front(T* element) {
-        doubly_linked_list_element_t* list_element = dynamic_cast<doubly_linked_list_element_t*>(element);  
+        doubly_linked_list_element_t* list_element = static_cast<doubly_linked_list_element_t*>(element);  
 
         if(is_empty()) {
             assign_first(list_element);
@@ -56,7 +56,7 @@ namespace ptm {
 
     template<typename T>
     void doubly_linked_list_header_t<T>::push_back(T* element) {
-        doubly_linked_list_element_t* list_element = dynamic_cast<doubly_linked_list_element_t*>(element);  
+        doubly_linked_list_element_t* list_element = static_cast<doubly_linked_list_element_t*>(element);  
 
         if(is_empty()) {
             assign_first(list_element);
@@ -69,7 +69,7 @@ namespace ptm {
 
     template<typename T>
     void doubly_linked_list_header_t<T>::remove_element(T* element) {
-        doubly_linked_list_element_t* list_element = dynamic_cast<doubly_linked_list_element_t*>(element);  
+        doubly_linked_list_element_t* list_element = static_cast<doubly_linked_list_element_t*>(element);  
 
         if(list_element == first) {
             first = list_element->next;
@@ -94,21 +94,16 @@ namespace ptm {
         if(is_empty()) {
             return;
         } else {
-            first = first->next;
-
-            first->prev = nullptr;
-            first->next = nullptr;
+            remove_element(static_cast<T*>(first));
         }
     }
+
     template<typename T>
     void doubly_linked_list_header_t<T>::pop_back() {
         if(is_empty()) {
             return;
         } else {
-            last = last->prev;
-
-            last->prev = nullptr;
-            last->next = nullptr;
+            remove_element(static_cast<T*>(last));
         }
     }
 }
\ No newline at end of file
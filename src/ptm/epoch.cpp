@@ -0,0 +1,160 @@
+#include "epoch.hpp"
+
+namespace ptm {
+    epoch_t::epoch_t(size_t max_participants)
+        : max_participants(max_participants), slots(new slot_t[max_participants]) {}
+
+    epoch_t::~epoch_t() {
+        // nobody can be reading anymore, everything is safe to free
+        for(size_t i = 0; i < max_participants; i++) {
+            for(limbo_t& limbo : slots[i].limbo)
+                free_limbo(limbo);
+        }
+
+        for(limbo_t& limbo : orphans)
+            free_limbo(limbo);
+    }
+
+    size_t epoch_t::free_limbo(limbo_t& limbo) {
+        size_t freed = limbo.count;
+
+        for(retired_batch_t& batch : limbo.batches) {
+            for(void* object : batch.objects)
+                batch.destroy(batch.context, object);
+        }
+
+        limbo.batches.clear();
+        limbo.count = 0;
+
+        return freed;
+    }
+
+    bool epoch_t::try_advance() {
+        // pairs with the fence in pin, the caller's unlinks have to be visible before the
+        // slots are read, or a reader that already loaded an unlinked object can be missed
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+
+        // every pinned participant has to have seen the current epoch
+        for(size_t i = 0; i < max_participants; i++) {
+            if(!slots[i].in_use.load(std::memory_order_acquire))
+                continue;
+
+            uint64_t state = slots[i].state.load(std::memory_order_acquire);
+            if((state & 1) && (state >> 1) != epoch)
+                return false;
+        }
+
+        return global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+    }
+
+    epoch_t::local_t::local_t(epoch_t& epoch)
+        : epoch(epoch) {
+        for(slot = 0; slot < epoch.max_participants; slot++) {
+            bool in_use = false;
+
+            if(epoch.slots[slot].in_use.compare_exchange_strong(in_use, true, std::memory_order_acq_rel))
+                return;
+        }
+
+        log("epoch_t has no room for another participant\n");
+        throw std::exception();
+    }
+
+    epoch_t::local_t::~local_t() {
+        collect();
+
+        slot_t& own = epoch.slots[slot];
+
+        {
+            std::lock_guard<std::mutex> lock(epoch.orphans_mutex);
+
+            for(limbo_t& limbo : own.limbo) {
+                if(limbo.count)
+                    epoch.orphans.emplace_back(std::move(limbo));
+
+                limbo = limbo_t();
+            }
+        }
+
+        own.state.store(0, std::memory_order_release);
+        own.in_use.store(false, std::memory_order_release);
+    }
+
+    epoch_t::guard_t epoch_t::local_t::pin() {
+        if(pin_depth++ == 0) {
+            uint64_t current = epoch.global_epoch.load(std::memory_order_relaxed);
+
+            epoch.slots[slot].state.store((current << 1) | 1, std::memory_order_relaxed);
+            // the announcement has to be visible before any pointer is read
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        return guard_t(this);
+    }
+
+    void epoch_t::local_t::unpin() {
+        assert(pin_depth > 0);
+
+        if(--pin_depth == 0)
+            epoch.slots[slot].state.store(0, std::memory_order_release);
+    }
+
+    void epoch_t::local_t::retire(void* object, void* context, void(*destroy)(void*, void*)) {
+        uint64_t current = epoch.global_epoch.load(std::memory_order_acquire);
+        limbo_t& limbo   = epoch.slots[slot].limbo[current % 3];
+
+        // the same bucket was last used at least 3 epochs ago, it is safe to free
+        if(limbo.count && limbo.epoch != current)
+            retired_count -= free_limbo(limbo);
+
+        limbo.epoch = current;
+
+        // objects of the same pool are kept together so they are freed together
+        retired_batch_t* batch = nullptr;
+        for(retired_batch_t& existing : limbo.batches) {
+            if(existing.context == context && existing.destroy == destroy) {
+                batch = &existing;
+                break;
+            }
+        }
+
+        if(!batch) {
+            limbo.batches.push_back({context, destroy, {}});
+            batch = &limbo.batches.back();
+        }
+
+        batch->objects.push_back(object);
+        limbo.count++;
+        retired_count++;
+
+        if(++retires_since_collect >= collect_threshold)
+            collect();
+    }
+
+    void epoch_t::local_t::collect() {
+        retires_since_collect = 0;
+
+        epoch.try_advance();
+        uint64_t current = epoch.global_epoch.load(std::memory_order_acquire);
+
+        for(limbo_t& limbo : epoch.slots[slot].limbo) {
+            if(limbo.count && limbo.epoch + 2 <= current)
+                retired_count -= free_limbo(limbo);
+        }
+
+        std::unique_lock<std::mutex> lock(epoch.orphans_mutex, std::try_to_lock);
+        if(!lock.owns_lock())
+            return;
+
+        for(size_t i = 0; i < epoch.orphans.size();) {
+            if(epoch.orphans[i].epoch + 2 <= current) {
+                free_limbo(epoch.orphans[i]);
+                epoch.orphans.erase(epoch.orphans.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+}
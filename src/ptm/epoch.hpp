@@ -0,0 +1,126 @@
+#pragma once
+
+#include "base.hpp"
+#include <atomic>
+#include <mutex>
+
+namespace ptm {
+    // Epoch based reclamation for objects read by lock free structures. Readers pin
+    // the epoch while they hold pointers, writers retire objects after unlinking them.
+    // A retired object is only given back to its pool once every reader that could
+    // have seen it has unpinned, which is two epochs after it was retired.
+    //
+    // Each thread joins with its own epoch_t::local_t:
+    //
+    //     ptm::epoch_t::local_t local(epoch);
+    //     {
+    //         auto guard = local.pin();
+    //         ... read ...
+    //     }
+    //     local.retire(pool, unlinked_node);
+    //
+    // All local_t must be destroyed before their epoch_t
+    class epoch_t {
+    public:
+        static constexpr size_t default_max_participants = 128;
+        static constexpr size_t collect_threshold        = 64; // retires between collections
+
+        class local_t;
+
+        // unpins when it goes out of scope
+        class guard_t {
+        public:
+            guard_t(local_t* local)
+                : local(local) {}
+
+            guard_t(guard_t&& other)
+                : local(other.local) { other.local = nullptr; }
+
+            guard_t(const guard_t&) = delete;
+            guard_t& operator=(const guard_t&) = delete;
+
+            ~guard_t() {
+                if(local)
+                    local->unpin();
+            }
+
+        private:
+            local_t* local;
+        };
+
+        class local_t {
+        public:
+            local_t(epoch_t& epoch);
+            ~local_t();
+
+            local_t(const local_t&) = delete;
+            local_t& operator=(const local_t&) = delete;
+
+            // pins may nest
+            guard_t pin();
+            void unpin();
+
+            // calls pool.destroy(object, 1) once no reader can see object
+            template<typename pool_t, typename T>
+            void retire(pool_t& pool, T* object) {
+                retire((void*)object, &pool, [](void* pool, void* object) {
+                    ((pool_t*)pool)->destroy((T*)object, 1);
+                });
+            }
+
+            // calls destroy(context, object) once no reader can see object
+            void retire(void* object, void* context, void(*destroy)(void*, void*));
+
+            // tries to move the epoch forward and frees everything that became safe to free
+            void collect();
+
+            size_t get_retired_count() { return retired_count; }
+
+        private:
+            friend class epoch_t;
+
+            epoch_t& epoch;
+            size_t   slot;
+            uint32_t pin_depth = 0;
+            size_t   retired_count = 0;
+            size_t   retires_since_collect = 0;
+        };
+
+        epoch_t(size_t max_participants = default_max_participants);
+        ~epoch_t();
+
+        uint64_t get_epoch() { return global_epoch.load(std::memory_order_relaxed); }
+
+    private:
+        // retired objects of one pool, freed together
+        struct retired_batch_t {
+            void*              context;
+            void             (*destroy)(void*, void*);
+            std::vector<void*> objects;
+        };
+
+        // everything retired during one epoch
+        struct limbo_t {
+            uint64_t                     epoch = 0;
+            size_t                       count = 0;
+            std::vector<retired_batch_t> batches;
+        };
+
+        struct alignas(64) slot_t {
+            std::atomic<bool>     in_use{false};
+            std::atomic<uint64_t> state{0}; // (epoch << 1) | 1 while pinned, 0 otherwise
+            limbo_t               limbo[3];
+        };
+
+        static size_t free_limbo(limbo_t& limbo);
+        bool try_advance();
+
+        std::atomic<uint64_t>     global_epoch{2};
+        size_t                    max_participants;
+        std::unique_ptr<slot_t[]> slots;
+
+        // limbo left behind by locals that were destroyed before it was safe to free
+        std::mutex           orphans_mutex;
+        std::vector<limbo_t> orphans;
+    };
+}
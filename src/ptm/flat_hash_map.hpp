@@ -0,0 +1,379 @@
+#pragma once
+
+#include "memory_pool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PTM_FLAT_HASH_MAP_SSE2 1
+#endif
+
+namespace ptm {
+    // control bytes of a flat_hash_map_t, full slots store the low 7 bits of their hash
+    namespace ctrl {
+        constexpr int8_t empty   = -128;
+        constexpr int8_t deleted = -2;
+        constexpr size_t group_width = 16;
+    }
+
+    // A bit for every slot in a group of control bytes that matched
+    class ctrl_mask_t {
+    public:
+        ctrl_mask_t(uint32_t bits)
+            : bits(bits) {}
+
+        explicit operator bool() const { return bits != 0; }
+
+        uint32_t lowest() const { return __builtin_ctz(bits); }
+        uint32_t highest() const { return 31 - __builtin_clz(bits); }
+
+        // index of the lowest match, then drops it
+        uint32_t next() {
+            uint32_t index = __builtin_ctz(bits);
+            bits &= bits - 1;
+            return index;
+        }
+
+    private:
+        uint32_t bits;
+    };
+
+    // 16 control bytes looked at together
+    struct ctrl_group_t {
+#ifdef PTM_FLAT_HASH_MAP_SSE2
+        __m128i ctrl;
+
+        ctrl_group_t(const int8_t* pos)
+            : ctrl(_mm_loadu_si128((const __m128i*)pos)) {}
+
+        ctrl_mask_t match(int8_t h2) const {
+            return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+        }
+
+        ctrl_mask_t match_empty() const {
+            return match(ctrl::empty);
+        }
+
+        // empty and deleted are the only negative control bytes
+        ctrl_mask_t match_empty_or_deleted() const {
+            return (uint32_t)_mm_movemask_epi8(ctrl);
+        }
+#else
+        const int8_t* ctrl;
+
+        ctrl_group_t(const int8_t* pos)
+            : ctrl(pos) {}
+
+        ctrl_mask_t match(int8_t h2) const {
+            uint32_t bits = 0;
+            for(uint32_t i = 0; i < ctrl::group_width; i++)
+                bits |= (uint32_t)(ctrl[i] == h2) << i;
+            return bits;
+        }
+
+        ctrl_mask_t match_empty() const {
+            return match(ctrl::empty);
+        }
+
+        ctrl_mask_t match_empty_or_deleted() const {
+            uint32_t bits = 0;
+            for(uint32_t i = 0; i < ctrl::group_width; i++)
+                bits |= (uint32_t)(ctrl[i] < 0) << i;
+            return bits;
+        }
+#endif
+    };
+
+    // An open addressing hash map in the style of SwissTable. A control byte per slot
+    // holds 7 bits of the hash and 16 of them are compared at once while probing.
+    // The control bytes and slots are one allocation from a Portem allocator.
+    // With stable_nodes the entries live in an object_pool_t and the table only holds
+    // pointers to them, so pointers to entries survive rehashing
+    template<typename K, typename V, bool stable_nodes = false, typename hash_t = std::hash<K>, typename equal_t = std::equal_to<K>>
+    class flat_hash_map_t {
+    public:
+        using value_type = std::pair<K, V>;
+
+        flat_hash_map_t(allocator_t<uint8_t>* allocator = nullptr)
+            : allocator(allocator ? allocator : &default_allocator) {}
+
+        ~flat_hash_map_t() {
+            clear();
+            release();
+        }
+
+        flat_hash_map_t(const flat_hash_map_t&) = delete;
+        flat_hash_map_t& operator=(const flat_hash_map_t&) = delete;
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        size_t get_capacity() const { return capacity; }
+
+        V* find(const K& key) {
+            size_t index = find_index(key);
+            return index == SIZE_MAX ? nullptr : &entry(index).second;
+        }
+
+        bool contains(const K& key) {
+            return find_index(key) != SIZE_MAX;
+        }
+
+        // Constructs V from args if key is not in the map yet. Returns the value
+        // and whether it was inserted
+        template<typename ... params>
+        std::pair<V*, bool> emplace(const K& key, params&& ... args) {
+            size_t hash  = hash_of(key);
+            size_t index = find_index(key, hash);
+
+            if(index != SIZE_MAX)
+                return {&entry(index).second, false};
+
+            if(count + tombstones + 1 > max_load(capacity))
+                rehash_for(count + 1);
+
+            index = find_insert_slot(hash);
+            if(ctrl_bytes[index] == ctrl::deleted)
+                tombstones--;
+
+            construct_entry(index, key, std::forward<params>(args)...);
+            set_ctrl(index, h2(hash));
+            count++;
+
+            return {&entry(index).second, true};
+        }
+
+        bool insert(const K& key, const V& value) {
+            return emplace(key, value).second;
+        }
+
+        V& operator[](const K& key) {
+            return *emplace(key).first;
+        }
+
+        bool erase(const K& key) {
+            size_t index = find_index(key);
+            if(index == SIZE_MAX)
+                return false;
+
+            destroy_entry(index);
+            count--;
+
+            // if no 16 slots in a row around this one were ever all in use, no
+            // probe went past it and it can go straight back to empty
+            size_t before = (index - ctrl::group_width) & mask;
+            ctrl_mask_t empty_after  = ctrl_group_t(ctrl_bytes + index).match_empty();
+            ctrl_mask_t empty_before = ctrl_group_t(ctrl_bytes + before).match_empty();
+
+            if(empty_after && empty_before &&
+               (ctrl::group_width - 1 - empty_before.highest()) + empty_after.lowest() < ctrl::group_width) {
+                set_ctrl(index, ctrl::empty);
+            } else {
+                set_ctrl(index, ctrl::deleted);
+                tombstones++;
+            }
+
+            return true;
+        }
+
+        void clear() {
+            for(size_t i = 0; i < capacity; i++) {
+                if(ctrl_bytes[i] >= 0)
+                    destroy_entry(i);
+            }
+
+            if(capacity)
+                memset(ctrl_bytes, ctrl::empty, capacity + ctrl::group_width);
+
+            count      = 0;
+            tombstones = 0;
+        }
+
+        void reserve(size_t n) {
+            if(n > max_load(capacity))
+                rehash_for(n);
+        }
+
+        // calls func(const K&, V&) on every entry
+        template<typename func_t>
+        void for_each(func_t&& func) {
+            for(size_t i = 0; i < capacity; i++) {
+                if(ctrl_bytes[i] >= 0)
+                    func((const K&)entry(i).first, entry(i).second);
+            }
+        }
+
+    private:
+        using slot_t = std::conditional_t<stable_nodes, value_type*, value_type>;
+
+        static constexpr size_t min_capacity = ctrl::group_width;
+
+        static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+
+        static size_t hash_of(const K& key) {
+            // std::hash of integers is often the identity, mix it so both halves are usable
+            uint64_t hash = (uint64_t)hash_t{}(key) * 0x9e3779b97f4a7c15ull;
+            return (size_t)(hash ^ (hash >> 32));
+        }
+
+        static size_t h1(size_t hash) { return hash >> 7; }
+        static int8_t h2(size_t hash) { return (int8_t)(hash & 0x7f); }
+
+        static value_type& entry_of(slot_t& slot) {
+            if constexpr(stable_nodes)
+                return *slot;
+            else
+                return slot;
+        }
+
+        value_type& entry(size_t index) {
+            return entry_of(slots[index]);
+        }
+
+        template<typename ... params>
+        void construct_entry(size_t index, const K& key, params&& ... args) {
+            if constexpr(stable_nodes)
+                slots[index] = nodes.create(1, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<params>(args)...));
+            else
+                new(&slots[index])value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<params>(args)...));
+        }
+
+        void destroy_entry(size_t index) {
+            if constexpr(stable_nodes)
+                nodes.destroy(slots[index], 1);
+            else
+                slots[index].~value_type();
+        }
+
+        // the first group_width bytes are mirrored after the end so a group
+        // can be loaded from any slot without wrapping around
+        void set_ctrl(size_t index, int8_t value) {
+            ctrl_bytes[index] = value;
+
+            if(index < ctrl::group_width)
+                ctrl_bytes[capacity + index] = value;
+        }
+
+        size_t find_index(const K& key) {
+            return find_index(key, hash_of(key));
+        }
+
+        size_t find_index(const K& key, size_t hash) {
+            if(capacity == 0)
+                return SIZE_MAX;
+
+            size_t pos    = h1(hash) & mask;
+            size_t stride = 0;
+
+            while(true) {
+                ctrl_group_t group(ctrl_bytes + pos);
+
+                for(ctrl_mask_t match = group.match(h2(hash)); match;) {
+                    size_t index = (pos + match.next()) & mask;
+
+                    if(equal_t{}(entry(index).first, key))
+                        return index;
+                }
+
+                if(group.match_empty())
+                    return SIZE_MAX;
+
+                stride += ctrl::group_width;
+                pos = (pos + stride) & mask;
+            }
+        }
+
+        size_t find_insert_slot(size_t hash) {
+            size_t pos    = h1(hash) & mask;
+            size_t stride = 0;
+
+            while(true) {
+                ctrl_mask_t free = ctrl_group_t(ctrl_bytes + pos).match_empty_or_deleted();
+
+                if(free)
+                    return (pos + free.next()) & mask;
+
+                stride += ctrl::group_width;
+                pos = (pos + stride) & mask;
+            }
+        }
+
+        void rehash_for(size_t n) {
+            size_t new_capacity = std::max(capacity, min_capacity);
+
+            // grow unless the table is mostly tombstones, then rehashing in place is enough
+            while(max_load(new_capacity) < n || (new_capacity == capacity && count >= max_load(capacity) / 2))
+                new_capacity *= 2;
+
+            int8_t* old_ctrl     = ctrl_bytes;
+            slot_t* old_slots    = slots;
+            uint8_t* old_memory  = memory;
+            size_t  old_capacity = capacity;
+            size_t  old_bytesize = memory_bytesize;
+
+            allocate_table(new_capacity);
+
+            for(size_t i = 0; i < old_capacity; i++) {
+                if(old_ctrl[i] < 0)
+                    continue;
+
+                size_t hash  = hash_of(entry_of(old_slots[i]).first);
+                size_t index = find_insert_slot(hash);
+
+                if constexpr(stable_nodes) {
+                    slots[index] = old_slots[i];
+                } else {
+                    new(&slots[index])value_type(std::move(old_slots[i]));
+                    old_slots[i].~value_type();
+                }
+
+                set_ctrl(index, h2(hash));
+            }
+
+            tombstones = 0;
+
+            if(old_memory)
+                allocator->deallocate(old_memory, old_bytesize);
+        }
+
+        void allocate_table(size_t new_capacity) {
+            size_t ctrl_bytesize = round_up(new_capacity + ctrl::group_width, alignof(slot_t));
+
+            // the allocator only promises byte alignment, so leave room to align the slots
+            memory_bytesize = ctrl_bytesize + new_capacity * sizeof(slot_t) + alignof(slot_t);
+            memory = allocator->allocate(memory_bytesize);
+            if(!memory) {
+                log("flat_hash_map_t failed to allocate\n");
+                throw std::bad_alloc();
+            }
+
+            ctrl_bytes = (int8_t*)memory;
+            slots      = (slot_t*)round_up((size_t)memory + ctrl_bytesize, alignof(slot_t));
+            capacity   = new_capacity;
+            mask       = new_capacity - 1;
+
+            memset(ctrl_bytes, ctrl::empty, new_capacity + ctrl::group_width);
+        }
+
+        void release() {
+            if(memory)
+                allocator->deallocate(memory, memory_bytesize);
+
+            memory   = nullptr;
+            capacity = 0;
+        }
+
+        static inline allocator_t<uint8_t> default_allocator;
+
+        allocator_t<uint8_t>* allocator;
+        uint8_t* memory          = nullptr;
+        size_t   memory_bytesize = 0;
+        int8_t*  ctrl_bytes      = nullptr;
+        slot_t*  slots           = nullptr;
+        size_t   capacity        = 0;
+        size_t   mask            = 0;
+        size_t   count           = 0;
+        size_t   tombstones      = 0;
+
+        struct empty_t {};
+        [[no_unique_address]] std::conditional_t<stable_nodes, object_pool_t<value_type>, empty_t> nodes;
+    };
+}
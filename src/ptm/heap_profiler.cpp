@@ -0,0 +1,300 @@
+#include "heap_profiler.hpp"
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define PTM_HAS_BACKTRACE
+#endif
+
+namespace ptm {
+    constexpr int max_stack_depth = 32;
+
+    struct stack_record_t {
+        void* frames[max_stack_depth];
+        int   depth = 0;
+
+        size_t live_count = 0;
+        size_t live_bytesize = 0;
+        size_t allocated_count = 0;
+        size_t allocated_bytesize = 0;
+
+        // allocated since the last allocation profile
+        size_t window_count = 0;
+        size_t window_bytesize = 0;
+    };
+
+    struct live_sample_t {
+        size_t stack;
+        size_t bytesize;
+    };
+
+    struct heap_profiler_t {
+        std::mutex          mutex;
+        std::atomic<size_t> sampling_period = default_heap_sampling_period;
+
+        std::vector<stack_record_t>          stacks;
+        std::map<std::vector<void*>, size_t> stack_index;
+        std::map<const void*, live_sample_t> live;
+
+        std::chrono::steady_clock::time_point window_start;
+    };
+
+    // never destroyed, pools may still free sampled memory during static destruction.
+    // Published before _impl_heap_profiling is set, so a thread that sees the flag sees it
+    static std::atomic<heap_profiler_t*> profiler = nullptr;
+    static std::mutex                    profiler_mutex;
+
+    // set while a thread is inside the profiler, which allocates itself
+    static thread_local bool in_profiler = false;
+
+    // whether this thread has drawn its first gap yet
+    static thread_local bool seeded = false;
+
+    static double next_random() {
+        static thread_local uint64_t state = 0;
+        if(state == 0)
+            state = ((uint64_t)(uintptr_t)&state ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()) | 1;
+
+        // xorshift64*
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        uint64_t value = state * 0x2545f4914f6cdd1dull;
+
+        // (0, 1], so the log below is finite
+        return ((value >> 11) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+    // the gap to the next sample, exponentially distributed around the period
+    static int64_t next_sample_gap(size_t sampling_period) {
+        return (int64_t)(-std::log(next_random()) * (double)sampling_period) + 1;
+    }
+
+    void start_heap_profiler(size_t sampling_period) {
+        std::lock_guard<std::mutex> lock(profiler_mutex);
+
+        heap_profiler_t* current = profiler.load(std::memory_order_relaxed);
+        if(!current) {
+            current = new heap_profiler_t();
+            profiler.store(current, std::memory_order_release);
+        }
+
+        std::lock_guard<std::mutex> profile_lock(current->mutex);
+        current->sampling_period.store(sampling_period, std::memory_order_relaxed);
+        current->window_start = std::chrono::steady_clock::now();
+
+        _impl_heap_profiling.store(true, std::memory_order_release);
+    }
+
+    void stop_heap_profiler() {
+        std::lock_guard<std::mutex> lock(profiler_mutex);
+
+        heap_profiler_t* current = profiler.load(std::memory_order_relaxed);
+        if(!current)
+            return;
+
+        _impl_heap_profiling.store(false, std::memory_order_release);
+
+        in_profiler = true;
+        {
+            std::lock_guard<std::mutex> profile_lock(current->mutex);
+
+            current->stacks.clear();
+            current->stack_index.clear();
+            current->live.clear();
+        }
+        in_profiler = false;
+    }
+
+    bool _impl_sample_allocation(void* ptr, size_t bytesize) {
+        heap_profiler_t* profiler = ptm::profiler.load(std::memory_order_acquire);
+        if(in_profiler || !profiler)
+            return false;
+
+        size_t sampling_period   = profiler->sampling_period.load(std::memory_order_relaxed);
+        _impl_bytes_until_sample = next_sample_gap(sampling_period);
+
+        // a thread's first allocation only starts its countdown, always sampling
+        // it would count the first allocations of every thread too often
+        if(!seeded) {
+            seeded = true;
+            return false;
+        }
+
+        in_profiler = true;
+
+        std::vector<void*> frames(max_stack_depth + 1);
+#ifdef PTM_HAS_BACKTRACE
+        // the first frame is this function
+        int depth = backtrace(frames.data(), max_stack_depth + 1);
+        frames.erase(frames.begin());
+        frames.resize(depth > 0 ? depth - 1 : 0);
+#else
+        frames.clear();
+#endif
+
+        {
+            std::lock_guard<std::mutex> lock(profiler->mutex);
+
+            auto [found, inserted] = profiler->stack_index.try_emplace(frames, profiler->stacks.size());
+            if(inserted) {
+                stack_record_t record;
+                record.depth = (int)frames.size();
+                std::copy(frames.begin(), frames.end(), record.frames);
+
+                profiler->stacks.push_back(record);
+            }
+
+            stack_record_t& record = profiler->stacks[found->second];
+            record.live_count++;
+            record.live_bytesize += bytesize;
+            record.allocated_count++;
+            record.allocated_bytesize += bytesize;
+            record.window_count++;
+            record.window_bytesize += bytesize;
+
+            // memory that was freed without telling the profiler may be handed out again
+            auto [sample, new_sample] = profiler->live.try_emplace(ptr, live_sample_t{found->second, bytesize});
+            if(!new_sample) {
+                stack_record_t& old = profiler->stacks[sample->second.stack];
+                old.live_count--;
+                old.live_bytesize -= sample->second.bytesize;
+                sample->second = live_sample_t{found->second, bytesize};
+            }
+        }
+
+        in_profiler = false;
+
+        return true;
+    }
+
+    void _impl_forget_allocation(const void* ptr) {
+        heap_profiler_t* profiler = ptm::profiler.load(std::memory_order_acquire);
+        if(in_profiler || !profiler)
+            return;
+
+        in_profiler = true;
+        {
+            std::lock_guard<std::mutex> lock(profiler->mutex);
+
+            auto found = profiler->live.find(ptr);
+            if(found != profiler->live.end()) {
+                stack_record_t& record = profiler->stacks[found->second.stack];
+                record.live_count--;
+                record.live_bytesize -= found->second.bytesize;
+
+                profiler->live.erase(found);
+            }
+        }
+        in_profiler = false;
+    }
+
+    size_t get_live_sample_count() {
+        heap_profiler_t* profiler = ptm::profiler.load(std::memory_order_acquire);
+        if(!profiler)
+            return 0;
+
+        size_t count;
+
+        in_profiler = true;
+        {
+            std::lock_guard<std::mutex> lock(profiler->mutex);
+            count = profiler->live.size();
+        }
+        in_profiler = false;
+
+        return count;
+    }
+
+    // which of a stack's figures a profile is made of
+    enum class profile_kind_t {
+        heap,
+        allocation
+    };
+
+    static bool write_profile(const char* path, profile_kind_t kind, double* window_seconds) {
+        heap_profiler_t* profiler = ptm::profiler.load(std::memory_order_acquire);
+        if(!profiler)
+            return false;
+
+        FILE* file = fopen(path, "w");
+        if(!file)
+            return false;
+
+        in_profiler = true;
+        {
+            std::lock_guard<std::mutex> lock(profiler->mutex);
+
+            // the first pair is what pprof shows by default, in use space for a heap
+            // profile and space allocated in the window for an allocation profile
+            auto first  = [&](const stack_record_t& record) {
+                return kind == profile_kind_t::heap ? std::make_pair(record.live_count, record.live_bytesize)
+                                                    : std::make_pair(record.window_count, record.window_bytesize);
+            };
+            auto second = [&](const stack_record_t& record) {
+                return kind == profile_kind_t::heap ? std::make_pair(record.allocated_count, record.allocated_bytesize)
+                                                    : std::make_pair(record.window_count, record.window_bytesize);
+            };
+
+            size_t totals[4] = {};
+            for(const stack_record_t& record : profiler->stacks) {
+                totals[0] += first(record).first;
+                totals[1] += first(record).second;
+                totals[2] += second(record).first;
+                totals[3] += second(record).second;
+            }
+
+            fprintf(file, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",
+                    totals[0], totals[1], totals[2], totals[3], profiler->sampling_period.load(std::memory_order_relaxed));
+
+            for(stack_record_t& record : profiler->stacks) {
+                if(second(record).first == 0)
+                    continue;
+
+                fprintf(file, "%zu: %zu [%zu: %zu] @", first(record).first, first(record).second,
+                        second(record).first, second(record).second);
+                for(int i = 0; i < record.depth; i++)
+                    fprintf(file, " %p", record.frames[i]);
+                fprintf(file, "\n");
+            }
+
+            // lets pprof match the addresses to the binaries they are in
+            FILE* maps = fopen("/proc/self/maps", "r");
+            if(maps) {
+                fprintf(file, "\nMAPPED_LIBRARIES:\n");
+
+                char   buffer[4096];
+                size_t read;
+                while((read = fread(buffer, 1, sizeof(buffer), maps)) > 0)
+                    fwrite(buffer, 1, read, file);
+
+                fclose(maps);
+            }
+
+            if(kind == profile_kind_t::allocation) {
+                auto now = std::chrono::steady_clock::now();
+                if(window_seconds)
+                    *window_seconds = std::chrono::duration<double>(now - profiler->window_start).count();
+
+                profiler->window_start = now;
+                for(stack_record_t& record : profiler->stacks) {
+                    record.window_count    = 0;
+                    record.window_bytesize = 0;
+                }
+            }
+        }
+        in_profiler = false;
+
+        return fclose(file) == 0;
+    }
+
+    bool write_heap_profile(const char* path) {
+        return write_profile(path, profile_kind_t::heap, nullptr);
+    }
+
+    bool write_allocation_profile(const char* path, double* window_seconds) {
+        return write_profile(path, profile_kind_t::allocation, window_seconds);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "base.hpp"
+#include <atomic>
+
+// A sampling heap profiler for finding which call sites make pools grow. Once
+// started, the sparse memory pool (and so memory_pool_t, object_pool_t and rda_t)
+// and stack_allocator_t report every allocation to it. Roughly one allocation is
+// sampled every sampling_period bytes, the gaps between samples are drawn from an
+// exponential distribution so periodic allocation patterns can not hide from it,
+// and the stack of a sampled allocation is recorded. Allocators tag the allocations
+// that were sampled, so frees of the others never reach the profiler. Profiles are
+// written in the legacy gperftools heap format that pprof reads, which it scales
+// back up to estimates of the real counts and sizes
+namespace ptm {
+    constexpr size_t default_heap_sampling_period = 2 * 1024 * 1024;
+
+    // sampling_period is the average number of bytes between samples
+    void start_heap_profiler(size_t sampling_period = default_heap_sampling_period);
+
+    // stops sampling and forgets everything sampled so far
+    void stop_heap_profiler();
+
+    // Writes the sampled allocations that are still live, as well as every allocation
+    // sampled since start_heap_profiler. Returns false if the file can't be written
+    bool write_heap_profile(const char* path);
+
+    // Writes the allocations sampled since the last call, or since start_heap_profiler,
+    // and sets window_seconds to how long that was so the profile can be read as a rate
+    bool write_allocation_profile(const char* path, double* window_seconds = nullptr);
+
+    // the number of sampled allocations that are still live
+    size_t get_live_sample_count();
+
+    inline std::atomic<bool> _impl_heap_profiling = false;
+
+    // bytes left until this thread's next sample, a thread starts at 0 and has
+    // its first gap drawn when it first comes to sample
+    inline thread_local int64_t _impl_bytes_until_sample = 0;
+
+    bool _impl_sample_allocation(void* ptr, size_t bytesize);
+    void _impl_forget_allocation(const void* ptr);
+
+    inline bool heap_profiler_is_running() {
+        return _impl_heap_profiling.load(std::memory_order_acquire);
+    }
+
+    // Called by the allocators on every allocation, costs one load while not profiling.
+    // Returns true if the allocation was sampled, the allocator remembers that with the
+    // allocation and calls heap_profiler_on_deallocate when it is freed
+    inline bool heap_profiler_on_allocate(void* ptr, size_t bytesize) {
+        if(!heap_profiler_is_running())
+            return false;
+
+        _impl_bytes_until_sample -= (int64_t)bytesize;
+        if(_impl_bytes_until_sample < 0 && ptr)
+            return _impl_sample_allocation(ptr, bytesize);
+
+        return false;
+    }
+
+    // called by the allocators when a sampled allocation is freed
+    inline void heap_profiler_on_deallocate(const void* ptr) {
+        _impl_forget_allocation(ptr);
+    }
+}
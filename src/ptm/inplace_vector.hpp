@@ -0,0 +1,307 @@
+#pragma once
+
+#include "base.hpp"
+#include <initializer_list>
+#include <iterator>
+
+namespace ptm {
+    // the smallest unsigned integer type that can hold n
+    template<size_t n>
+    using smallest_size_t = std::conditional_t<n <= UINT8_MAX, uint8_t,
+                            std::conditional_t<n <= UINT16_MAX, uint16_t,
+                            std::conditional_t<n <= UINT32_MAX, uint32_t, uint64_t>>>;
+
+    // Storage for N elements that are not constructed up front. Types without a
+    // constructor or destructor are kept in a plain array, which is allowed to stay
+    // uninitialized in constant expressions. Anything else goes in a union
+    template<typename T, size_t N, bool trivial = std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>>
+    struct _impl_inplace_storage_t {
+        T elements[N];
+    };
+
+    template<typename T, size_t N>
+    struct _impl_inplace_storage_t<T, N, false> {
+        constexpr _impl_inplace_storage_t() {}
+        constexpr ~_impl_inplace_storage_t() requires std::is_trivially_destructible_v<T> = default;
+        constexpr ~_impl_inplace_storage_t() {}
+
+        union {
+            T elements[N];
+        };
+    };
+
+    // A vector of at most N elements that lives entirely inside itself, so it never
+    // allocates and can be put in pooled objects. Elements are only constructed when
+    // added and the count is the smallest type that holds N. Trivially copyable types
+    // are copied and moved as a whole and shifted with memmove. Everything is constexpr
+    // and types without a constructor or destructor can be used in constant expressions.
+    // Adding to a full vector is a bug, try_push_back and try_emplace_back return
+    // nullptr instead
+    template<typename T, size_t N>
+    class inplace_vector_t {
+        static_assert(N > 0, "an inplace vector needs room for at least one element");
+
+        static constexpr bool trivially_relocatable = std::is_trivially_copyable_v<T>;
+
+    public:
+        using value_type             = T;
+        using size_type              = smallest_size_t<N>;
+        using difference_type        = ptrdiff_t;
+        using reference              = T&;
+        using const_reference        = const T&;
+        using pointer                = T*;
+        using const_pointer          = const T*;
+        using iterator               = T*;
+        using const_iterator         = const T*;
+        using reverse_iterator       = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        constexpr inplace_vector_t() {}
+
+        constexpr inplace_vector_t(size_t n, const T& value) {
+            insert(end(), n, value);
+        }
+
+        constexpr inplace_vector_t(std::initializer_list<T> values) {
+            insert(end(), values.begin(), values.end());
+        }
+
+        // trivially copyable types are copied as a whole, unused slots and all
+        constexpr inplace_vector_t(const inplace_vector_t&) requires trivially_relocatable = default;
+        constexpr inplace_vector_t(inplace_vector_t&&) requires trivially_relocatable = default;
+        constexpr inplace_vector_t& operator=(const inplace_vector_t&) requires trivially_relocatable = default;
+        constexpr inplace_vector_t& operator=(inplace_vector_t&&) requires trivially_relocatable = default;
+
+        constexpr inplace_vector_t(const inplace_vector_t& other) {
+            insert(end(), other.begin(), other.end());
+        }
+
+        constexpr inplace_vector_t(inplace_vector_t&& other) {
+            for(size_t i = 0; i < other.count; i++)
+                std::construct_at(&storage.elements[i], std::move(other.storage.elements[i]));
+
+            count = other.count;
+            other.clear();
+        }
+
+        constexpr inplace_vector_t& operator=(const inplace_vector_t& other) {
+            if(this != &other) {
+                clear();
+                insert(end(), other.begin(), other.end());
+            }
+
+            return *this;
+        }
+
+        constexpr inplace_vector_t& operator=(inplace_vector_t&& other) {
+            if(this != &other) {
+                clear();
+
+                for(size_t i = 0; i < other.count; i++)
+                    std::construct_at(&storage.elements[i], std::move(other.storage.elements[i]));
+
+                count = other.count;
+                other.clear();
+            }
+
+            return *this;
+        }
+
+        constexpr ~inplace_vector_t() requires std::is_trivially_destructible_v<T> = default;
+
+        constexpr ~inplace_vector_t() {
+            clear();
+        }
+
+        constexpr iterator begin() { return storage.elements; }
+        constexpr iterator end() { return storage.elements + count; }
+        constexpr const_iterator begin() const { return storage.elements; }
+        constexpr const_iterator end() const { return storage.elements + count; }
+        constexpr const_iterator cbegin() const { return begin(); }
+        constexpr const_iterator cend() const { return end(); }
+        constexpr reverse_iterator rbegin() { return reverse_iterator(end()); }
+        constexpr reverse_iterator rend() { return reverse_iterator(begin()); }
+        constexpr const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        constexpr const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        constexpr T* data() { return storage.elements; }
+        constexpr const T* data() const { return storage.elements; }
+
+        constexpr size_t size() const { return count; }
+        static constexpr size_t capacity() { return N; }
+        static constexpr size_t max_size() { return N; }
+        constexpr bool empty() const { return count == 0; }
+        constexpr bool full() const { return count == N; }
+
+        constexpr T& operator[](size_t i) {
+            assert(i < count);
+            return storage.elements[i];
+        }
+
+        constexpr const T& operator[](size_t i) const {
+            assert(i < count);
+            return storage.elements[i];
+        }
+
+        constexpr T& front() { return (*this)[0]; }
+        constexpr T& back() { return (*this)[count - 1]; }
+        constexpr const T& front() const { return (*this)[0]; }
+        constexpr const T& back() const { return (*this)[count - 1]; }
+
+        template<typename ... params>
+        constexpr T& emplace_back(params&& ... args) {
+            assert(count < N);
+
+            std::construct_at(&storage.elements[count], std::forward<params>(args)...);
+            return storage.elements[count++];
+        }
+
+        constexpr void push_back(const T& value) { emplace_back(value); }
+        constexpr void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        // returns nullptr if the vector is full
+        template<typename ... params>
+        constexpr T* try_emplace_back(params&& ... args) {
+            return full() ? nullptr : &emplace_back(std::forward<params>(args)...);
+        }
+
+        constexpr T* try_push_back(const T& value) { return try_emplace_back(value); }
+        constexpr T* try_push_back(T&& value) { return try_emplace_back(std::move(value)); }
+
+        constexpr void pop_back() {
+            assert(count > 0);
+            std::destroy_at(&storage.elements[--count]);
+        }
+
+        // inserts an element constructed from args before position
+        template<typename ... params>
+        constexpr iterator emplace(const_iterator position, params&& ... args) {
+            size_t index = position - begin();
+
+            if(index == count) {
+                emplace_back(std::forward<params>(args)...);
+            } else {
+                // args may refer to an element that is about to move
+                T value(std::forward<params>(args)...);
+
+                open_gap(index, 1);
+                std::construct_at(&storage.elements[index], std::move(value));
+            }
+
+            return begin() + index;
+        }
+
+        constexpr iterator insert(const_iterator position, const T& value) { return emplace(position, value); }
+        constexpr iterator insert(const_iterator position, T&& value) { return emplace(position, std::move(value)); }
+
+        constexpr iterator insert(const_iterator position, size_t n, const T& value) {
+            size_t index = position - begin();
+            T      copy(value);
+
+            open_gap(index, n);
+            for(size_t i = index; i < index + n; i++)
+                std::construct_at(&storage.elements[i], copy);
+
+            return begin() + index;
+        }
+
+        // the range must not be part of this vector
+        template<typename iterator_t, typename = typename std::iterator_traits<iterator_t>::iterator_category>
+        constexpr iterator insert(const_iterator position, iterator_t first, iterator_t last) {
+            size_t index = position - begin();
+
+            open_gap(index, std::distance(first, last));
+            for(size_t i = index; first != last; i++, first++)
+                std::construct_at(&storage.elements[i], *first);
+
+            return begin() + index;
+        }
+
+        constexpr iterator insert(const_iterator position, std::initializer_list<T> values) {
+            return insert(position, values.begin(), values.end());
+        }
+
+        constexpr iterator erase(const_iterator position) {
+            return erase(position, position + 1);
+        }
+
+        constexpr iterator erase(const_iterator first, const_iterator last) {
+            size_t index = first - begin();
+            size_t n     = last - first;
+
+            std::destroy(begin() + index, begin() + index + n);
+            relocate(index, index + n, count - index - n);
+            count -= (size_type)n;
+
+            return begin() + index;
+        }
+
+        constexpr void clear() {
+            std::destroy(begin(), end());
+            count = 0;
+        }
+
+        constexpr void resize(size_t n) {
+            resize_with(n, [](T* element) { std::construct_at(element); });
+        }
+
+        constexpr void resize(size_t n, const T& value) {
+            T copy(value);
+            resize_with(n, [&](T* element) { std::construct_at(element, copy); });
+        }
+
+        constexpr bool operator==(const inplace_vector_t& other) const {
+            return count == other.count && std::equal(begin(), end(), other.begin());
+        }
+
+        constexpr bool operator!=(const inplace_vector_t& other) const { return !(*this == other); }
+
+    private:
+        // moves n elements from src to dst, the slots at src end up unconstructed.
+        // Works for overlapping ranges
+        constexpr void relocate(size_t dst, size_t src, size_t n) {
+            T* elements = storage.elements;
+
+            if(trivially_relocatable && !std::is_constant_evaluated()) {
+                if(n)
+                    memmove((void*)(elements + dst), (void*)(elements + src), n * sizeof(T));
+            } else if(dst < src) {
+                for(size_t i = 0; i < n; i++) {
+                    std::construct_at(&elements[dst + i], std::move(elements[src + i]));
+                    std::destroy_at(&elements[src + i]);
+                }
+            } else {
+                for(size_t i = n; i > 0; i--) {
+                    std::construct_at(&elements[dst + i - 1], std::move(elements[src + i - 1]));
+                    std::destroy_at(&elements[src + i - 1]);
+                }
+            }
+        }
+
+        // leaves [index, index + n) unconstructed, moving the elements after it back
+        constexpr void open_gap(size_t index, size_t n) {
+            assert(count + n <= N);
+
+            relocate(index + n, index, count - index);
+            count += (size_type)n;
+        }
+
+        template<typename construct_t>
+        constexpr void resize_with(size_t n, construct_t&& construct) {
+            assert(n <= N);
+
+            if(n < count) {
+                std::destroy(begin() + n, end());
+            } else {
+                for(size_t i = count; i < n; i++)
+                    construct(&storage.elements[i]);
+            }
+
+            count = (size_type)n;
+        }
+
+    private:
+        _impl_inplace_storage_t<T, N> storage;
+        size_type                     count = 0;
+    };
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "base.hpp"
+
+namespace ptm {
+    // The links an object needs to be in an intrusive_list_t. Has no virtual
+    // functions, so it adds exactly two pointers to the object holding it
+    struct list_hook_t {
+        list_hook_t* prev = nullptr;
+        list_hook_t* next = nullptr;
+
+        bool is_linked() const { return next != nullptr; }
+
+        // takes the hook out of whatever list it is in
+        void unlink() {
+            prev->next = next;
+            next->prev = prev;
+            prev = nullptr;
+            next = nullptr;
+        }
+    };
+
+    // Derive from one of these per list an object can be in, tag_t tells them apart
+    template<typename tag_t = void>
+    struct list_base_hook_t : list_hook_t {};
+
+    // Finds the hook of T that derives from list_base_hook_t<tag_t>
+    template<typename T, typename tag_t = void>
+    struct base_hook_t {
+        static list_hook_t* to_hook(T* object) {
+            return static_cast<list_base_hook_t<tag_t>*>(object);
+        }
+
+        static T* from_hook(list_hook_t* hook) {
+            return static_cast<T*>(static_cast<list_base_hook_t<tag_t>*>(hook));
+        }
+    };
+
+    // Finds the hook of T that is the member hook
+    template<typename T, list_hook_t T::* hook>
+    struct member_hook_t {
+        static list_hook_t* to_hook(T* object) {
+            return &(object->*hook);
+        }
+
+        static T* from_hook(list_hook_t* member) {
+            return (T*)((uint8_t*)member - offset());
+        }
+
+    private:
+        static size_t offset() {
+            // any address works, as long as it is not null
+            constexpr size_t fake = alignof(T) * 64;
+            return (size_t)&(((T*)fake)->*hook) - fake;
+        }
+    };
+
+    // A circular doubly linked list of objects that carry their own links, so
+    // inserting and removing never allocates. hook_t says where the links are,
+    // an object can be in as many lists at once as it has hooks. The list does
+    // not own its objects, they must be removed before they are destroyed
+    template<typename T, typename hook_t = base_hook_t<T>>
+    class intrusive_list_t {
+    public:
+        template<bool is_const>
+        class iterator_base_t {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type        = T;
+            using difference_type   = ptrdiff_t;
+            using pointer           = std::conditional_t<is_const, const T*, T*>;
+            using reference         = std::conditional_t<is_const, const T&, T&>;
+
+            iterator_base_t() {}
+            explicit iterator_base_t(list_hook_t* hook) : hook(hook) {}
+
+            // iterators convert to const_iterators
+            operator iterator_base_t<true>() const { return iterator_base_t<true>(hook); }
+
+            reference operator*() const { return *hook_t::from_hook(hook); }
+            pointer operator->() const { return hook_t::from_hook(hook); }
+
+            iterator_base_t& operator++() { hook = hook->next; return *this; }
+            iterator_base_t& operator--() { hook = hook->prev; return *this; }
+            iterator_base_t operator++(int) { iterator_base_t old = *this; hook = hook->next; return old; }
+            iterator_base_t operator--(int) { iterator_base_t old = *this; hook = hook->prev; return old; }
+
+            bool operator==(const iterator_base_t& other) const { return hook == other.hook; }
+            bool operator!=(const iterator_base_t& other) const { return hook != other.hook; }
+
+        private:
+            friend class intrusive_list_t;
+
+            list_hook_t* hook = nullptr;
+        };
+
+        using iterator       = iterator_base_t<false>;
+        using const_iterator = iterator_base_t<true>;
+
+        intrusive_list_t() {
+            root.prev = &root;
+            root.next = &root;
+        }
+
+        intrusive_list_t(intrusive_list_t&& other)
+            : intrusive_list_t() {
+            splice(end(), other);
+        }
+
+        intrusive_list_t& operator=(intrusive_list_t&& other) {
+            clear();
+            splice(end(), other);
+            return *this;
+        }
+
+        intrusive_list_t(const intrusive_list_t&) = delete;
+        intrusive_list_t& operator=(const intrusive_list_t&) = delete;
+
+        ~intrusive_list_t() {
+            clear();
+        }
+
+        bool empty() const { return root.next == &root; }
+
+        // counts the elements, O(n)
+        size_t size() const {
+            size_t count = 0;
+            for(const list_hook_t* hook = root.next; hook != &root; hook = hook->next)
+                count++;
+
+            return count;
+        }
+
+        T* front() { return hook_t::from_hook(root.next); }
+        T* back() { return hook_t::from_hook(root.prev); }
+
+        iterator begin() { return iterator(root.next); }
+        iterator end() { return iterator(&root); }
+        const_iterator begin() const { return const_iterator(root.next); }
+        const_iterator end() const { return const_iterator((list_hook_t*)&root); }
+
+        void push_front(T* object) { link_before(root.next, hook_t::to_hook(object)); }
+        void push_back(T* object) { link_before(&root, hook_t::to_hook(object)); }
+
+        // both return nullptr if the list is empty
+        T* pop_front() { return empty() ? nullptr : unlink(root.next); }
+        T* pop_back() { return empty() ? nullptr : unlink(root.prev); }
+
+        // inserts object before position and returns an iterator to it
+        iterator insert(const_iterator position, T* object) {
+            list_hook_t* hook = hook_t::to_hook(object);
+
+            link_before(position.hook, hook);
+            return iterator(hook);
+        }
+
+        // removes the element at position and returns an iterator to the one after it
+        iterator erase(const_iterator position) {
+            list_hook_t* next = position.hook->next;
+
+            position.hook->unlink();
+            return iterator(next);
+        }
+
+        // removes object from this list, O(1) as the object knows its neighbours
+        void remove(T* object) {
+            hook_t::to_hook(object)->unlink();
+        }
+
+        static bool is_linked(T* object) { return hook_t::to_hook(object)->is_linked(); }
+
+        // the iterator to object, which must be in this list
+        iterator iterator_to(T* object) { return iterator(hook_t::to_hook(object)); }
+
+        // moves every element of other in front of position
+        void splice(const_iterator position, intrusive_list_t& other) {
+            splice(position, other, other.begin(), other.end());
+        }
+
+        // moves [first, last) of other in front of position, O(1)
+        void splice(const_iterator position, intrusive_list_t& other, const_iterator first, const_iterator last) {
+            if(first == last)
+                return;
+
+            list_hook_t* first_hook = first.hook;
+            list_hook_t* last_hook  = last.hook->prev;
+
+            // cut the range out of other
+            first_hook->prev->next = last.hook;
+            last.hook->prev = first_hook->prev;
+
+            // and stitch it in before position
+            list_hook_t* after = position.hook;
+            first_hook->prev = after->prev;
+            last_hook->next  = after;
+            after->prev->next = first_hook;
+            after->prev = last_hook;
+        }
+
+        // unlinks every element, the elements themselves are left alone
+        void clear() {
+            while(!empty())
+                unlink(root.next);
+        }
+
+    private:
+        void link_before(list_hook_t* position, list_hook_t* hook) {
+            assert(!hook->is_linked());
+
+            hook->prev = position->prev;
+            hook->next = position;
+            position->prev->next = hook;
+            position->prev = hook;
+        }
+
+        T* unlink(list_hook_t* hook) {
+            hook->unlink();
+            return hook_t::from_hook(hook);
+        }
+
+    private:
+        list_hook_t root;
+    };
+}
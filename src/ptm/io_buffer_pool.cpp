@@ -0,0 +1,145 @@
+#include "io_buffer_pool.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PTM_HAS_IO_URING
+#endif
+
+namespace ptm {
+    _impl_io_buffer_ref_t::_impl_io_buffer_ref_t(io_buffer_pool_t* pool, uint32_t index)
+        : pool(pool), index(index) {
+        pool->infos[index].references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    _impl_io_buffer_ref_t::_impl_io_buffer_ref_t(const _impl_io_buffer_ref_t& other)
+        : pool(other.pool), index(other.index) {
+        if(pool)
+            pool->infos[index].references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    _impl_io_buffer_ref_t::_impl_io_buffer_ref_t(_impl_io_buffer_ref_t&& other)
+        : pool(other.pool), index(other.index) {
+        other.pool = nullptr;
+    }
+
+    _impl_io_buffer_ref_t& _impl_io_buffer_ref_t::operator=(_impl_io_buffer_ref_t other) {
+        std::swap(pool, other.pool);
+        std::swap(index, other.index);
+        return *this;
+    }
+
+    _impl_io_buffer_ref_t::~_impl_io_buffer_ref_t() {
+        release();
+    }
+
+    void _impl_io_buffer_ref_t::release() {
+        // acq_rel so whoever gets the buffer next sees every write to it
+        if(pool && pool->infos[index].references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            pool->give_back(index);
+
+        pool = nullptr;
+    }
+
+    io_slice_t io_slice_t::slice(size_t offset, size_t length) const {
+        assert(offset + length <= bytesize);
+
+        return io_slice_t(*this, bytes + offset, length);
+    }
+
+    uint8_t* io_buffer_t::data() const { return pool->buffer_data(index); }
+    size_t io_buffer_t::capacity() const { return pool->buffer_bytesize; }
+    size_t io_buffer_t::size() const { return pool->infos[index].size; }
+
+    void io_buffer_t::resize(size_t bytesize) {
+        assert(bytesize <= capacity());
+
+        pool->infos[index].size = bytesize;
+    }
+
+    io_slice_t io_buffer_t::slice(size_t offset, size_t length) const {
+        assert(offset + length <= capacity());
+
+        return io_slice_t(*this, data() + offset, length);
+    }
+
+    io_buffer_pool_t::io_buffer_pool_t(size_t buffer_bytesize, size_t buffer_count, bool huge_pages)
+        : buffer_bytesize(round_up(buffer_bytesize, page_size())), buffer_count(buffer_count) {
+        mapped_bytesize = round_up(this->buffer_bytesize * buffer_count, huge_pages ? huge_page_size() : page_size());
+        memory = (uint8_t*)(huge_pages ? map_huge_virtual_memory(mapped_bytesize) : map_virtual_memory(mapped_bytesize));
+
+        if(!memory) {
+            log("Failed to map %zu bytes of I/O buffers", mapped_bytesize);
+            throw std::exception();
+        }
+
+        infos = new buffer_info_t[buffer_count];
+#ifndef _WIN32
+        iovecs = new struct iovec[buffer_count];
+#endif
+
+        // handed out from the back, so buffer 0 goes first
+        free_indices.reserve(buffer_count);
+        for(size_t i = buffer_count; i > 0; i--) {
+            free_indices.push_back((uint32_t)(i - 1));
+        }
+
+#ifndef _WIN32
+        for(size_t i = 0; i < buffer_count; i++) {
+            iovecs[i].iov_base = buffer_data((uint32_t)i);
+            iovecs[i].iov_len  = this->buffer_bytesize;
+        }
+#endif
+    }
+
+    io_buffer_pool_t::~io_buffer_pool_t() {
+        assert(free_indices.size() == buffer_count);
+
+        release_virtual_memory(memory, mapped_bytesize);
+        delete[] infos;
+#ifndef _WIN32
+        delete[] iovecs;
+#endif
+    }
+
+    io_buffer_t io_buffer_pool_t::acquire() {
+        uint32_t index;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(free_indices.empty())
+                return io_buffer_t();
+
+            index = free_indices.back();
+            free_indices.pop_back();
+        }
+
+        infos[index].size = 0;
+        return io_buffer_t(this, index);
+    }
+
+    size_t io_buffer_pool_t::get_free_count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return free_indices.size();
+    }
+
+    void io_buffer_pool_t::give_back(uint32_t index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_indices.push_back(index);
+    }
+
+    bool io_buffer_pool_t::register_with_io_uring(int ring_fd) {
+#ifdef PTM_HAS_IO_URING
+        return syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, iovecs, (unsigned)buffer_count) == 0;
+#else
+        return false;
+#endif
+    }
+
+    void io_buffer_pool_t::unregister_from_io_uring(int ring_fd) {
+#ifdef PTM_HAS_IO_URING
+        syscall(__NR_io_uring_register, ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+#endif
+    }
+}
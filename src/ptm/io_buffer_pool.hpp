@@ -0,0 +1,132 @@
+#pragma once
+
+#include "virtual_memory.hpp"
+#include <atomic>
+#include <mutex>
+#include <string_view>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+namespace ptm {
+    class io_buffer_pool_t;
+
+    // A counted reference to one buffer of an io_buffer_pool_t. The buffer goes back
+    // to the pool when the last io_buffer_t or io_slice_t referring to it is gone
+    class _impl_io_buffer_ref_t {
+    public:
+        _impl_io_buffer_ref_t() {}
+        _impl_io_buffer_ref_t(io_buffer_pool_t* pool, uint32_t index);
+        _impl_io_buffer_ref_t(const _impl_io_buffer_ref_t& other);
+        _impl_io_buffer_ref_t(_impl_io_buffer_ref_t&& other);
+        _impl_io_buffer_ref_t& operator=(_impl_io_buffer_ref_t other);
+        ~_impl_io_buffer_ref_t();
+
+        explicit operator bool() const { return pool != nullptr; }
+
+        // the index the buffer was registered with, for IORING_OP_READ_FIXED and friends
+        uint32_t get_index() const { return index; }
+
+    protected:
+        void release();
+
+    protected:
+        io_buffer_pool_t* pool  = nullptr;
+        uint32_t          index = 0;
+    };
+
+    // A view of part of a buffer, keeps the whole buffer alive
+    class io_slice_t : public _impl_io_buffer_ref_t {
+    public:
+        io_slice_t() {}
+        io_slice_t(const _impl_io_buffer_ref_t& buffer, const uint8_t* data, size_t size)
+            : _impl_io_buffer_ref_t(buffer), bytes(data), bytesize(size) {}
+
+        const uint8_t* data() const { return bytes; }
+        size_t size() const { return bytesize; }
+        std::string_view view() const { return std::string_view((const char*)bytes, bytesize); }
+
+        // a smaller view of the same buffer
+        io_slice_t slice(size_t offset, size_t length) const;
+
+    private:
+        const uint8_t* bytes    = nullptr;
+        size_t         bytesize = 0;
+    };
+
+    // A whole buffer. size is how much of it holds data, set it after reading into it
+    class io_buffer_t : public _impl_io_buffer_ref_t {
+    public:
+        io_buffer_t() {}
+        io_buffer_t(io_buffer_pool_t* pool, uint32_t index)
+            : _impl_io_buffer_ref_t(pool, index) {}
+
+        uint8_t* data() const;
+        size_t capacity() const;
+        size_t size() const;
+        void resize(size_t bytesize);
+
+        io_slice_t slice(size_t offset, size_t length) const;
+
+        // all of the data as a slice
+        io_slice_t slice() const { return slice(0, size()); }
+    };
+
+    // A fixed number of page aligned buffers in one mapping, optionally on huge pages.
+    // Buffers are handed out and given back without copying or touching malloc.
+    // As the buffers never move they can be registered with io_uring as fixed buffers,
+    // either through register_with_io_uring or by giving get_iovecs() to liburing's
+    // io_uring_register_buffers. The pool must outlive every buffer and slice of it
+    class io_buffer_pool_t {
+    public:
+        io_buffer_pool_t(size_t buffer_bytesize, size_t buffer_count, bool huge_pages = false);
+        ~io_buffer_pool_t();
+
+        io_buffer_pool_t(const io_buffer_pool_t&) = delete;
+        io_buffer_pool_t& operator=(const io_buffer_pool_t&) = delete;
+
+        // returns an empty io_buffer_t when every buffer is in use
+        io_buffer_t acquire();
+
+        size_t get_buffer_bytesize() { return buffer_bytesize; }
+        size_t get_buffer_count() { return buffer_count; }
+        size_t get_free_count();
+
+#ifndef _WIN32
+        // one iovec per buffer, in index order
+        const struct iovec* get_iovecs() { return iovecs; }
+#endif
+
+        // Registers every buffer with the io_uring instance ring_fd. Returns false if
+        // io_uring is not available or the kernel refused, e.g. over RLIMIT_MEMLOCK
+        bool register_with_io_uring(int ring_fd);
+        void unregister_from_io_uring(int ring_fd);
+
+    private:
+        friend class _impl_io_buffer_ref_t;
+        friend class io_buffer_t;
+
+        struct buffer_info_t {
+            std::atomic<uint32_t> references = 0;
+            size_t                size = 0;
+        };
+
+        uint8_t* buffer_data(uint32_t index) { return memory + index * buffer_bytesize; }
+        void give_back(uint32_t index);
+
+    private:
+        size_t buffer_bytesize;
+        size_t buffer_count;
+        size_t mapped_bytesize;
+
+        uint8_t*       memory;
+        buffer_info_t* infos;
+#ifndef _WIN32
+        struct iovec*  iovecs;
+#endif
+
+        std::mutex            mutex; // guards free_indices
+        std::vector<uint32_t> free_indices;
+    };
+}
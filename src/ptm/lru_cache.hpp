@@ -0,0 +1,196 @@
+#pragma once
+
+#include "flat_hash_map.hpp"
+#include "intrusive_list.hpp"
+#include "recycling_object_pool.hpp"
+#include <mutex>
+#include <optional>
+
+namespace ptm {
+    // What an entry costs against an lru_cache_t's budget: the key and value
+    // themselves plus what the value holds on to, see retained_bytesize_of_t
+    template<typename K, typename V>
+    struct entry_bytesize_of_t {
+        size_t operator()(const K& key, const V& value) const {
+            return sizeof(K) + sizeof(V) + retained_bytesize_of_t<V>()(value);
+        }
+    };
+
+    // A cache that evicts the least recently used entries once the entries cost more
+    // than max_bytesize. Entries live in an object_pool_t, a flat hash index finds them
+    // and an intrusive list keeps them in order of use, so a hit never allocates
+    template<typename K, typename V, typename hash_t = std::hash<K>, typename equal_t = std::equal_to<K>,
+             typename bytesize_of_t = entry_bytesize_of_t<K, V>>
+    class lru_cache_t {
+    public:
+        lru_cache_t(size_t max_bytesize, size_t initial_entries = 100)
+            : max_bytesize(max_bytesize), entries(initial_entries) {
+            index.reserve(initial_entries);
+        }
+
+        ~lru_cache_t() {
+            clear();
+        }
+
+        lru_cache_t(const lru_cache_t&) = delete;
+        lru_cache_t& operator=(const lru_cache_t&) = delete;
+
+        // returns nullptr on a miss, a hit becomes the most recently used entry
+        V* get(const K& key) {
+            entry_t** found = index.find(key);
+            if(!found)
+                return nullptr;
+
+            touch(*found);
+            return &(*found)->value;
+        }
+
+        // returns nullptr on a miss, does not change the order of use
+        V* peek(const K& key) {
+            entry_t** found = index.find(key);
+            return found ? &(*found)->value : nullptr;
+        }
+
+        // Inserts or replaces the value of key and makes it the most recently used.
+        // Evicts until the cache is within budget again, the new entry always stays
+        template<typename U>
+        V* put(const K& key, U&& value) {
+            entry_t** found = index.find(key);
+            entry_t*  entry;
+
+            if(found) {
+                entry = *found;
+                used_bytesize -= entry->bytesize;
+                entry->value = std::forward<U>(value);
+                touch(entry);
+            } else {
+                entry = entries.create(1, key, std::forward<U>(value));
+                index.insert(key, entry);
+                recency.push_front(entry);
+            }
+
+            entry->bytesize = bytesize_of_t()(entry->key, entry->value);
+            used_bytesize  += entry->bytesize;
+
+            while(used_bytesize > max_bytesize && recency.back() != entry) {
+                evict(recency.back());
+            }
+
+            return &entry->value;
+        }
+
+        bool erase(const K& key) {
+            entry_t** found = index.find(key);
+            if(!found)
+                return false;
+
+            evict(*found);
+            return true;
+        }
+
+        void clear() {
+            while(!recency.empty()) {
+                evict(recency.back());
+            }
+        }
+
+        size_t size() { return index.size(); }
+        size_t get_used_bytesize() { return used_bytesize; }
+        size_t get_max_bytesize() { return max_bytesize; }
+
+    private:
+        struct entry_t : list_base_hook_t<> {
+            template<typename U>
+            entry_t(const K& key, U&& value)
+                : key(key), value(std::forward<U>(value)) {}
+
+            K      key;
+            V      value;
+            size_t bytesize = 0;
+        };
+
+        void touch(entry_t* entry) {
+            recency.remove(entry);
+            recency.push_front(entry);
+        }
+
+        void evict(entry_t* entry) {
+            used_bytesize -= entry->bytesize;
+            recency.remove(entry);
+            index.erase(entry->key);
+            entries.destroy(entry, 1);
+        }
+
+    private:
+        size_t                                               max_bytesize;
+        size_t                                               used_bytesize = 0;
+        object_pool_t<entry_t>                               entries;
+        flat_hash_map_t<K, entry_t*, false, hash_t, equal_t> index;
+        intrusive_list_t<entry_t>                            recency; // most recently used first
+    };
+
+    // An lru_cache_t split into shards with a lock each, so threads using different
+    // keys rarely wait on each other. Every shard gets an equal part of max_bytesize
+    // and evicts on its own. Values are copied out, as a pointer into a shard
+    // would not be safe once its lock is let go
+    template<typename K, typename V, size_t shard_count = 16, typename hash_t = std::hash<K>, typename equal_t = std::equal_to<K>,
+             typename bytesize_of_t = entry_bytesize_of_t<K, V>>
+    class sharded_lru_cache_t {
+        static_assert(shard_count > 0 && (shard_count & (shard_count - 1)) == 0, "shard_count must be a power of two");
+
+    public:
+        sharded_lru_cache_t(size_t max_bytesize, size_t initial_entries = 100) {
+            for(shard_t& shard : shards) {
+                shard.cache.emplace(max_bytesize / shard_count, initial_entries / shard_count + 1);
+            }
+        }
+
+        std::optional<V> get(const K& key) {
+            shard_t& shard = shard_of(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            V* value = shard.cache->get(key);
+            return value ? std::optional<V>(*value) : std::nullopt;
+        }
+
+        template<typename U>
+        void put(const K& key, U&& value) {
+            shard_t& shard = shard_of(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            shard.cache->put(key, std::forward<U>(value));
+        }
+
+        bool erase(const K& key) {
+            shard_t& shard = shard_of(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            return shard.cache->erase(key);
+        }
+
+        size_t size() {
+            size_t count = 0;
+            for(shard_t& shard : shards) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                count += shard.cache->size();
+            }
+
+            return count;
+        }
+
+    private:
+        struct alignas(cache_line_bytesize) shard_t {
+            std::mutex                                                        mutex;
+            std::optional<lru_cache_t<K, V, hash_t, equal_t, bytesize_of_t>> cache;
+        };
+
+        shard_t& shard_of(const K& key) {
+            // std::hash of integers is often the identity, mix it and take bits from the top half
+            uint64_t hash = (uint64_t)hash_t{}(key) * 0x9e3779b97f4a7c15ull;
+            return shards[(hash >> 32) & (shard_count - 1)];
+        }
+
+    private:
+        shard_t shards[shard_count];
+    };
+}
@@ -5,24 +5,49 @@ namespace ptm {
         reset(element_bytesize, max_elements);
     }
 
-    bool _impl_continuous_memory_pool_t::reset(size_t bytesize_of_element, size_t max_elements) {
-        const size_t alignment = 16;
-        
-        cache.last_free = 0;
+    _impl_continuous_memory_pool_t::_impl_continuous_memory_pool_t(void* memory, size_t element_bytesize, size_t max_elements) {
+        assert((size_t)memory % alignment == 0);
 
-        this->bytesize_of_element = bytesize_of_element, 
-        this->max_elements = max_elements; 
-        
-        flags_bytesize = max_elements / bits_per_byte;
+        set_layout(element_bytesize, max_elements);
+
+        this->memory = memory;
+        owns_memory  = false;
+
+        memset(memory, 0, flags_bytesize);
+    }
+
+    size_t _impl_continuous_memory_pool_t::flags_bytesize_of(size_t max_elements) {
+        size_t flags_bytesize = max_elements / bits_per_byte;
 
         // this insures that _elements() returns an aligned address
         flags_bytesize += alignment - (flags_bytesize % alignment);
 
+        return flags_bytesize;
+    }
+
+    size_t _impl_continuous_memory_pool_t::required_bytesize(size_t element_bytesize, size_t max_elements) {
+        return flags_bytesize_of(max_elements) + max_elements * element_bytesize;
+    }
+
+    void _impl_continuous_memory_pool_t::set_layout(size_t bytesize_of_element, size_t max_elements) {
+        cache.last_free = 0;
+        used_elements   = 0;
+
+        this->bytesize_of_element = bytesize_of_element, 
+        this->max_elements = max_elements; 
+        
+        flags_bytesize    = flags_bytesize_of(max_elements);
         elements_bytesize = max_elements * bytesize_of_element;
+    }
+
+    bool _impl_continuous_memory_pool_t::reset(size_t bytesize_of_element, size_t max_elements) {
+        set_layout(bytesize_of_element, max_elements);
+        sampled.reset();
 
-        if(memory)
+        if(memory && owns_memory)
             free(memory);
         
+        owns_memory = true;
         memory = malloc(elements_bytesize + flags_bytesize);
         if(!memory) {
             log("Malloc failed to allocate");
@@ -34,32 +59,8 @@ namespace ptm {
         return memory != nullptr;
     }
 
-    bool _impl_continuous_memory_pool_t::_attempt_realloc(size_t new_max_elements) {
-        uint8_t* flags    = _flags();
-        uint8_t* elements = _elements();
-
-        size_t new_flags_bytesize   = new_max_elements + (new_max_elements % bits_per_byte);
-        size_t new_elements_bytesize = new_max_elements * bytesize_of_element;
-
-        uint8_t* new_memory = (uint8_t*)realloc(memory, new_flags_bytesize + new_elements_bytesize);
-        if(new_memory == nullptr)
-            return false;
-
-        assert(new_memory == (uint8_t*)memory);
-
-        // copy over the old flags
-        memcpy(new_memory + new_elements_bytesize, _flags(), flags_bytesize);
-        // any bytes that weren't covered by the memcpy set to zero
-        memset(new_memory + new_elements_bytesize + flags_bytesize, 0, new_flags_bytesize - flags_bytesize);
-
-        flags_bytesize = new_flags_bytesize;
-        elements_bytesize = new_elements_bytesize;
-
-        return true;      
-    }
-
     _impl_continuous_memory_pool_t::~_impl_continuous_memory_pool_t() {
-        if(memory)
+        if(memory && owns_memory)
             free(memory);
     }
 
@@ -67,87 +68,218 @@ namespace ptm {
         cache = other.cache;
         bytesize_of_element = other.bytesize_of_element;
         max_elements        = other.max_elements;
+        used_elements       = other.used_elements;
         flags_bytesize      = other.flags_bytesize;
         elements_bytesize   = other.elements_bytesize;
         memory              = other.memory;
+        owns_memory         = other.owns_memory;
+        sampled             = std::move(other.sampled);
 
         other.memory = nullptr; 
     }
 
-    size_t _impl_continuous_memory_pool_t::try_allocate_in_range(size_t begin, size_t end, size_t n) {
-        size_t elements_index = SIZE_MAX;
-        
-        size_t i = begin;
-        for(; i < end;) {
-            size_t bit = i;
-
-            for(; bit < max_elements; bit++) {
-                if(!is_free(bit)) {
-                    elements_index = SIZE_MAX;
-                    break;
-                } else {
-                    if(elements_index == SIZE_MAX) {
-                        elements_index = bit;
-                    }
-
-                    if((bit - elements_index) + 1 >= n) {
-                        goto success;
-                    }
-                }
+    void* _impl_continuous_memory_pool_t::allocate(size_t n) {
+        // a full pool is skipped without scanning the flags
+        if(used_elements + n > max_elements) {
+            return (void*)nullptr;
+        }
+
+        // the element freed last is usually still free, and still in cache
+        if(n == 1 && cache.last_free < max_elements && is_free(cache.last_free)) {
+            return claim(cache.last_free++, 1);
+        }
+
+        size_t elements_index = find_free_bits_from([&](size_t byte) { return _flags()[byte]; }, cache.last_free, max_elements, n);
+        if(elements_index == SIZE_MAX) {
+            return (void*)nullptr;
+        }
+
+        // next fit, the elements after this range are the most likely to be free
+        cache.last_free = elements_index + n;
+
+        return claim(elements_index, n);
+    }
+
+    void* _impl_continuous_memory_pool_t::claim(size_t elements_index, size_t n) {
+        used_elements += n;
+        set_flags(elements_index, n, true);
+
+        return (void*)inc_by_byte(_elements(), elements_index * bytesize_of_element);
+    }
+
+    size_t _impl_continuous_memory_pool_t::find_nearest_free(size_t hint_index, size_t begin, size_t end, size_t n) {
+        auto range_is_free = [&](size_t index) {
+            for(size_t i = index; i < index + n; i++) {
+                if(!is_free(i))
+                    return false;
             }
 
-            i = bit + 1;
+            return true;
+        };
+
+        // walk outwards from the hint, alternating between after and before it
+        for(size_t distance = 0; hint_index + distance < end || hint_index >= begin + distance; distance++) {
+            size_t after = hint_index + distance;
+            if(after + n <= end && range_is_free(after))
+                return after;
+
+            if(distance > 0 && hint_index >= begin + distance) {
+                size_t before = hint_index - distance;
+                if(before + n <= end && range_is_free(before))
+                    return before;
+            }
         }
 
         return SIZE_MAX;
-    success:
-        return elements_index;
     }
 
-    void* _impl_continuous_memory_pool_t::allocate(size_t n) {
-        size_t elements_index = try_allocate_in_range(cache.last_free, max_elements, n);
+    void* _impl_continuous_memory_pool_t::allocate_near(size_t n, const void* hint) {
+        if(!elements_in_pool((void*)hint) || used_elements + n > max_elements) {
+            return (void*)nullptr;
+        }
 
-        if(elements_index == SIZE_MAX) {
-            elements_index = try_allocate_in_range(0, cache.last_free, n);
+        size_t elements    = (size_t)_elements();
+        size_t hint_index  = ((size_t)hint - elements) / bytesize_of_element;
+        const size_t windows[] = { cache_line_bytesize, page_size() };
 
-            if(elements_index == SIZE_MAX) {
-                return (void*)nullptr;
-            }
-        } 
+        for(size_t window : windows) {
+            size_t window_begin = (size_t)hint & ~(window - 1);
+            size_t window_end   = window_begin + window;
 
-        cache.last_free = 0;
+            // every element that overlaps the window
+            size_t begin = window_begin <= elements ? 0 : (window_begin - elements) / bytesize_of_element;
+            size_t end   = std::min(max_elements, (window_end - elements + bytesize_of_element - 1) / bytesize_of_element);
 
-        for(size_t i = elements_index; i < elements_index + n; i++) {
-            flip_bit(i);
+            size_t elements_index = find_nearest_free(hint_index, begin, end, n);
+            if(elements_index != SIZE_MAX) {
+                return claim(elements_index, n);
+            }
         }
 
-        return (void*)inc_by_byte(_elements(), elements_index * bytesize_of_element);
+        return (void*)nullptr;
     }
 
     void  _impl_continuous_memory_pool_t::deallocate(void* elements, size_t n) {
         size_t elements_index = ((uint8_t*)elements - _elements()) / bytesize_of_element;
 
         cache.last_free = elements_index;
+        used_elements -= n;
 
         for(size_t i = elements_index; i < elements_index + n; i++) {
             assert(!is_free(i));
+        }
 
-            flip_bit(i);
+        set_flags(elements_index, n, false);
+    }
+
+    void _impl_continuous_memory_pool_t::tag_sampled(void* elements) {
+        if(!sampled) {
+            sampled = std::make_unique<uint8_t[]>(flags_bytesize);
+        }
+
+        size_t index = ((uint8_t*)elements - _elements()) / bytesize_of_element;
+        sampled[index / bits_per_byte] |= 1 << (index % bits_per_byte);
+    }
+
+    void _impl_continuous_memory_pool_t::set_flags(size_t index, size_t n, bool in_use) {
+        if(n == 1) {
+            set_flag(index, in_use);
+            return;
+        }
+
+        size_t end = index + n;
+
+        // bits up to the first whole byte, whole bytes, then the bits after
+        for(; index < end && index % bits_per_byte != 0; index++) {
+            set_flag(index, in_use);
+        }
+
+        size_t whole_bytes = (end - index) / bits_per_byte;
+        memset(&_flags()[index / bits_per_byte], in_use ? UINT8_MAX : 0, whole_bytes);
+        index += whole_bytes * bits_per_byte;
+
+        for(; index < end; index++) {
+            set_flag(index, in_use);
         }
     }
 
     _impl_sparse_memory_pool_t::_impl_sparse_memory_pool_t(_impl_sparse_memory_pool_t&& other) {
+        cache = other.cache;
         bytesize_of_element = other.bytesize_of_element;
+        large_threshold_bytesize = other.large_threshold_bytesize;
+        largest_max_elements = other.largest_max_elements;
         pools = std::move(other.pools);
+        large_allocations = std::move(other.large_allocations);
+        sizing = std::move(other.sizing);
+
+        other.large_allocations.clear();
     }
 
     _impl_sparse_memory_pool_t& _impl_sparse_memory_pool_t::operator=(_impl_sparse_memory_pool_t&& other) {
         if(this == &other)
             return *this;
         
+        release_large();
+
+        cache = other.cache;
         bytesize_of_element = other.bytesize_of_element;
+        large_threshold_bytesize = other.large_threshold_bytesize;
+        largest_max_elements = other.largest_max_elements;
         pools = std::move(other.pools);
+        large_allocations = std::move(other.large_allocations);
+        sizing = std::move(other.sizing);
+
+        other.large_allocations.clear();
         
         return *this;
     }
+
+    _impl_sparse_memory_pool_t::~_impl_sparse_memory_pool_t() {
+        release_large();
+    }
+
+    void _impl_sparse_memory_pool_t::tag_sampled(void* elements) {
+        // large allocations are looked up by the profiler when they are freed instead
+        for(auto& pool : pools) {
+            if(pool.elements_in_pool(elements)) {
+                pool.tag_sampled(elements);
+                return;
+            }
+        }
+    }
+
+    void* _impl_sparse_memory_pool_t::allocate_large(size_t n) {
+        size_t bytesize = round_up(n * bytesize_of_element, page_size());
+        void*  elements = map_virtual_memory(bytesize);
+
+        if(elements) {
+            large_allocations[elements] = bytesize;
+        }
+
+        return elements;
+    }
+
+    bool _impl_sparse_memory_pool_t::deallocate_large(void* ptr) {
+        auto large = large_allocations.find(ptr);
+        if(large == large_allocations.end())
+            return false;
+
+        // large allocations are rare enough for the profiler to look each one up
+        if(heap_profiler_is_running()) {
+            heap_profiler_on_deallocate(ptr);
+        }
+
+        release_virtual_memory(large->first, large->second);
+        large_allocations.erase(large);
+
+        return true;
+    }
+
+    void _impl_sparse_memory_pool_t::release_large() {
+        for(auto& large : large_allocations) {
+            release_virtual_memory(large.first, large.second);
+        }
+
+        large_allocations.clear();
+    }
 }
\ No newline at end of file
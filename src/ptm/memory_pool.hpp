@@ -3,6 +3,13 @@
 #include "base.hpp"
 #include "allocator.hpp"
 #include "doubly_linked_list.hpp"
+#include "virtual_memory.hpp"
+#include "heap_profiler.hpp"
+#include "pool_sizing.hpp"
+#include "bitmap.hpp"
+#include <algorithm>
+#include <thread>
+#include <exception>
 
 namespace ptm {
     template<typename T>
@@ -11,11 +18,15 @@ namespace ptm {
     }
 
     // underlying implementation of a memory pool that is not reliant on
-    // templates. Memory here is continuous, better for the cache but cannot resize
+    // templates. Memory here is continuous, better for the cache but cannot resize.
+    // See _impl_reserved_memory_pool_t for a continuous pool that can grow in place
     class _impl_continuous_memory_pool_t {
     public:
         _impl_continuous_memory_pool_t() {}
         _impl_continuous_memory_pool_t(size_t element_bytesize, size_t max_elements);
+        // Uses memory owned by the caller instead of allocating it. The memory must be
+        // 16 byte aligned and at least required_bytesize(element_bytesize, max_elements) big
+        _impl_continuous_memory_pool_t(void* memory, size_t element_bytesize, size_t max_elements);
         _impl_continuous_memory_pool_t(_impl_continuous_memory_pool_t&& other);
         ~_impl_continuous_memory_pool_t();
 
@@ -23,27 +34,61 @@ namespace ptm {
         // All elements MUST be deallocated. Returns true if reset was successful
         bool reset(size_t element_bytesize, size_t max_elements);
 
+        // the amount of bytes a pool with max_elements needs for its flags and elements
+        static size_t required_bytesize(size_t element_bytesize, size_t max_elements);
+
         bool valid() { return (uint8_t*)memory; }
         void* allocate(size_t n);
         void deallocate(void* elements, size_t n);
 
+        // Allocates the free elements closest to hint, first looking in hint's cache
+        // line and then in its page. Returns nullptr if hint is not in this pool or
+        // there is no room near it
+        void* allocate_near(size_t n, const void* hint);
+
         void* get_block() { return (void*)_elements(); } 
-        bool elements_in_pool(void* ptr) { return _elements() <= (uint8_t*)ptr && (uint8_t*)ptr <= inc_by_byte(_elements(), elements_bytesize); }
+        bool elements_in_pool(void* ptr) { return _elements() <= (uint8_t*)ptr && (uint8_t*)ptr < inc_by_byte(_elements(), elements_bytesize); }
 
         size_t get_max_elements() { return max_elements; }
+        size_t get_used_elements() { return used_elements; }
+
+        // marks elements as sampled by the heap profiler, so freeing them tells it
+        void tag_sampled(void* elements);
+
+        // true if elements were tagged as sampled, clearing the tag. The tags are
+        // only allocated once something is sampled, until then this is one branch
+        bool take_sampled(void* elements) {
+            if(!sampled) {
+                return false;
+            }
+
+            size_t  index = ((uint8_t*)elements - _elements()) / bytesize_of_element;
+            uint8_t bit   = 1 << (index % bits_per_byte);
+            if(!(sampled[index / bits_per_byte] & bit)) {
+                return false;
+            }
+
+            sampled[index / bits_per_byte] &= ~bit;
+            return true;
+        }
 
     private:
         static constexpr size_t bits_per_byte = 8;
+        static constexpr size_t alignment     = 16;
 
-        // should not use  
-        bool _attempt_realloc(size_t new_max_elements);
-        
-        size_t try_allocate_in_range(size_t begin, size_t end, size_t n);
+        static size_t flags_bytesize_of(size_t max_elements);
+        void set_layout(size_t bytesize_of_element, size_t max_elements);
+        size_t find_nearest_free(size_t hint_index, size_t begin, size_t end, size_t n);
+        void* claim(size_t elements_index, size_t n);
+        void set_flags(size_t index, size_t n, bool in_use);
         uint8_t* _flags() { return (uint8_t*)memory; }
         uint8_t* _elements() { return inc_by_byte((uint8_t*)memory, flags_bytesize); }
 
         bool is_free(size_t index) { return !(_flags()[index / bits_per_byte] & (1 << (index % bits_per_byte))); }
-        bool flip_bit(size_t index) { return _flags()[index / bits_per_byte] ^= (1 << (index % bits_per_byte)); }        
+        void set_flag(size_t index, bool in_use) {
+            uint8_t bit = 1 << (index % bits_per_byte);
+            _flags()[index / bits_per_byte] = in_use ? (_flags()[index / bits_per_byte] | bit) : (_flags()[index / bits_per_byte] & ~bit);
+        }
 
     private:
         struct {
@@ -52,60 +97,191 @@ namespace ptm {
 
         size_t bytesize_of_element = 0;
         size_t max_elements   = 0;
+        size_t used_elements  = 0;
         size_t flags_bytesize = 0;
         size_t elements_bytesize = 0;
         void*  memory         = nullptr;
+        bool   owns_memory    = true;
+        std::unique_ptr<uint8_t[]> sampled; // a bit per element sampled by the heap profiler
     };
 
+    // A memory pool made of continuous sub pools, a new sub pool twice the size of
+    // the last is added whenever the others are full. A pool with a sizing name
+    // sizes its sub pools from its usage instead, see pool_sizing.hpp. Requests of at least
+    // large_threshold_bytesize, or too big for the newest sub pool, skip the sub pools
+    // and get their own page aligned mapping that is given back to the OS on deallocate
     class _impl_sparse_memory_pool_t {
     public:
+        static constexpr size_t default_large_threshold_bytesize = 256 * 1024;
+
         _impl_sparse_memory_pool_t() {
             bytesize_of_element = SIZE_MAX;
         }
 
         _impl_sparse_memory_pool_t(_impl_sparse_memory_pool_t&& other);
         _impl_sparse_memory_pool_t& operator=(_impl_sparse_memory_pool_t&& other);
+        ~_impl_sparse_memory_pool_t();
 
-        _impl_sparse_memory_pool_t(size_t bytesize_of_element, size_t initial_max_elements = 100) {
+        _impl_sparse_memory_pool_t(size_t bytesize_of_element, size_t initial_max_elements = 100, const char* sizing_name = nullptr) {
             this->bytesize_of_element = bytesize_of_element;
+
+            if(sizing_name) {
+                sizing = std::make_unique<_impl_pool_sizing_t>(sizing_name);
+                initial_max_elements = sizing->get_initial_max_elements(initial_max_elements);
+            }
+
             pools.emplace_back(bytesize_of_element, initial_max_elements);
+            largest_max_elements = initial_max_elements;
         }
 
         void* allocate(size_t n, const void* hint = 0) {
-           void* elements = nullptr;
-            
+            void* elements = allocate_unprofiled(n, hint);
+
+            if(heap_profiler_on_allocate(elements, n * bytesize_of_element)) {
+                tag_sampled(elements);
+            }
+
+            return elements;
+        }
+
+        void deallocate(void* ptr, size_t n) {
+            if(!large_allocations.empty() && deallocate_large(ptr)) {
+                return;
+            }
+
+            if(sizing) {
+                sizing->on_deallocate(n);
+            }
+
+            for(size_t i = 0; i < pools.size(); i++) {
+                if(pools[i].elements_in_pool(ptr)) {
+                    if(pools[i].take_sampled(ptr)) {
+                        heap_profiler_on_deallocate(ptr);
+                    }
+
+                    pools[i].deallocate(ptr, n);
+                    cache.last_pool = i;
+                    return;
+                }
+            }
+        }
+
+        // allocate without reporting to the heap profiler
+        void* allocate_unprofiled(size_t n, const void* hint) {
+            if(is_large(n)) {
+                return allocate_large(n);
+            }
+
+            void* elements = allocate_small(n, hint);
+            if(sizing && elements) {
+                sizing->on_allocate(n);
+            }
+
+            return elements;
+        }
+
+        // tries to place the elements in the cache line or page of hint
+        void* allocate_near(size_t n, const void* hint) {
             for(auto& pool : pools) {
-                elements = pool.allocate(n);
+                if(pool.elements_in_pool((void*)hint)) {
+                    return pool.allocate_near(n, hint);
+                }
+            }
+
+            return nullptr;
+        }
+
+        // true if ptr was allocated from this pool
+        bool owns(const void* ptr) {
+            for(auto& pool : pools) {
+                if(pool.elements_in_pool((void*)ptr)) {
+                    return true;
+                }
+            }
+
+            return large_allocations.count((void*)ptr) != 0;
+        }
+
+        size_t get_bytesize_of_element() { return bytesize_of_element; }
+        void set_large_threshold(size_t bytesize) { large_threshold_bytesize = bytesize; }
+        size_t get_large_allocation_count() { return large_allocations.size(); }
+        size_t get_sub_pool_count() { return pools.size(); }
+
+        // the number of elements all sub pools have room for
+        size_t get_max_elements() {
+            size_t max_elements = 0;
+            for(auto& pool : pools) {
+                max_elements += pool.get_max_elements();
+            }
+
+            return max_elements;
+        }
+
+    private:
+        bool is_large(size_t n) {
+            return n * bytesize_of_element >= large_threshold_bytesize || n > largest_max_elements;
+        }
+
+        // allocates from the sub pools, adding one if they are all full
+        void* allocate_small(size_t n, const void* hint) {
+            void* elements = nullptr;
+
+            if(hint) {
+                elements = allocate_near(n, hint);
+                if(elements) {
+                    return elements;
+                }
+            }
+
+            // the sub pool that last had room is the most likely to have it again
+            elements = pools[cache.last_pool].allocate(n);
+            if(elements) {
+                return elements;
+            }
+            
+            for(size_t i = 0; i < pools.size(); i++) {
+                elements = pools[i].allocate(n);
 
                 if(elements) {
+                    cache.last_pool = i;
                     return elements;
                 }
             }
 
-            size_t prev_max_elements = pools.back().get_max_elements();
-            pools.emplace_back(bytesize_of_element, prev_max_elements * 2);
+            size_t next_max_elements = sizing ? sizing->next_max_elements(get_max_elements(), largest_max_elements, n) : pools.back().get_max_elements() * 2;
+            pools.emplace_back(bytesize_of_element, next_max_elements);
+            largest_max_elements = std::max(largest_max_elements, next_max_elements);
             elements = pools.back().allocate(n);
+            cache.last_pool = pools.size() - 1;
 
             return elements;
         }
 
-        void deallocate(void* ptr, size_t n) {
-            for(auto& pool : pools) {
-                if(pool.elements_in_pool(ptr))
-                    pool.deallocate(ptr, n);
-            }
-        }
+        void tag_sampled(void* elements);
+        void* allocate_large(size_t n);
+        // returns false if ptr is not a large allocation
+        bool deallocate_large(void* ptr);
+        void release_large();
 
     private:    
+        struct {
+            size_t last_pool = 0;
+        } cache;
+
         size_t bytesize_of_element = 0;
+        size_t large_threshold_bytesize = default_large_threshold_bytesize;
+        size_t largest_max_elements = 0; // of any sub pool, smaller requests fit in it
         std::vector<_impl_continuous_memory_pool_t> pools;
+        std::map<void*, size_t> large_allocations; // address to mapped bytesize
+        std::unique_ptr<_impl_pool_sizing_t> sizing; // only for pools with a sizing name
     };
 
     template<typename T>
     class memory_pool_t : public allocator_t<T> {
     public:
-        memory_pool_t(size_t initial_max_elements = 100) {
-            pool = _impl_sparse_memory_pool_t(sizeof(T), initial_max_elements);
+        // a pool with a sizing_name learns its size, see pool_sizing.hpp
+        memory_pool_t(size_t initial_max_elements = 100, const char* sizing_name = nullptr) {
+            pool = _impl_sparse_memory_pool_t(sizeof(T), initial_max_elements, sizing_name);
         }
 
         T* allocate(size_t n, const void* hint = 0) override {
@@ -120,33 +296,189 @@ namespace ptm {
         _impl_sparse_memory_pool_t pool;
     };
 
+    // above this many bytes create_parallel splits construction over threads
+    constexpr size_t parallel_construct_bytesize = 4 * 1024 * 1024;
+
     template<typename T>
     class object_pool_t {
     public:
-        object_pool_t(size_t max_size = 100)
-            : pool(max_size) {}
+        // a pool with a sizing_name learns its size, see pool_sizing.hpp
+        object_pool_t(size_t max_size = 100, const char* sizing_name = nullptr)
+            : pool(max_size, sizing_name) {}
 
         template<typename ... params>
         T* create(size_t size, params&& ... args) {
             T* elements = pool.allocate(size);
         
-            for(size_t i = 0; i < size && elements; i++) {
-                pool.construct(&elements[i], args...);
+            if(elements) {
+                construct_elements(elements, size, std::forward<params>(args)...);
             }
 
             return elements;
         }
 
-        void destroy(T* ptr, size_t size) {
-            for(size_t i = 0; i < size; i++) {
-                pool.destroy(ptr + i);
+        // like create, but places the elements as close to hint as possible
+        // so objects that are used together share cache lines and pages
+        template<typename ... params>
+        T* create_near(const void* hint, size_t size, params&& ... args) {
+            T* elements = pool.allocate(size, hint);
+        
+            if(elements) {
+                construct_elements(elements, size, std::forward<params>(args)...);
+            }
+
+            return elements;
+        }
+
+        // Like create, but arrays of at least threshold_bytesize whose type cannot be
+        // broadcast are constructed by several threads at once. If a constructor throws,
+        // every element that was constructed is destroyed, the memory is given back and
+        // the first exception is rethrown once all threads are done
+        template<typename ... params>
+        T* create_parallel(size_t size, const params& ... args) {
+            size_t threads = parallel_threads ? parallel_threads : std::thread::hardware_concurrency();
+            if(size * sizeof(T) < parallel_threshold_bytesize || threads <= 1 || is_broadcast<const params&...>()) {
+                return create(size, args...);
+            }
+
+            T* elements = pool.allocate(size);
+            if(!elements) {
+                return elements;
+            }
+
+            size_t per_thread = (size + threads - 1) / threads;
+            size_t ranges     = (size + per_thread - 1) / per_thread;
+
+            std::vector<std::exception_ptr> errors(ranges);
+            auto construct_range = [&](size_t range) {
+                size_t begin = range * per_thread;
+                try {
+                    construct_elements_safely(elements + begin, std::min(per_thread, size - begin), args...);
+                } catch(...) {
+                    errors[range] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for(size_t range = 1; range < ranges; range++) {
+                workers.emplace_back(construct_range, range);
+            }
+
+            construct_range(0);
+
+            for(auto& worker : workers) {
+                worker.join();
+            }
+
+            for(std::exception_ptr& error : errors) {
+                if(!error) {
+                    continue;
+                }
+
+                // the ranges that failed cleaned up after themselves
+                for(size_t range = 0; range < ranges; range++) {
+                    size_t begin = range * per_thread;
+                    if(!errors[range]) {
+                        destroy_elements(elements + begin, std::min(per_thread, size - begin));
+                    }
+                }
+
+                pool.deallocate(elements, size);
+                std::rethrow_exception(error);
             }
 
+            return elements;
+        }
+
+        // arrays of at least threshold_bytesize are constructed by threads threads, all
+        // of the hardware's when it is 0
+        void set_parallel_construction(size_t threshold_bytesize, size_t threads = 0) {
+            parallel_threshold_bytesize = threshold_bytesize;
+            parallel_threads            = threads;
+        }
+
+        void destroy(T* ptr, size_t size) {
+            destroy_elements(ptr, size);
             pool.deallocate(ptr, size);
         }
+
+    private:
+        // true when construction from args is a plain byte copy
+        template<typename ... params>
+        static constexpr bool is_broadcast() {
+            if constexpr(sizeof...(params) == 0) {
+                // value initialization of a trivial type is all zeros
+                return std::is_trivial_v<T>;
+            } else if constexpr(sizeof...(params) == 1) {
+                return std::is_trivially_copyable_v<T> && 
+                       (std::is_same_v<std::remove_cvref_t<params>, T> && ...);
+            } else {
+                return false;
+            }
+        }
+
+        template<typename ... params>
+        static void construct_elements(T* elements, size_t size, params&& ... args) {
+            if constexpr(is_broadcast<params...>() && sizeof...(params) == 0) {
+                memset((void*)elements, 0, size * sizeof(T));
+            } else if constexpr(is_broadcast<params...>()) {
+                broadcast(elements, size, args...);
+            } else if(size == 1) {
+                new(elements)T(std::forward<params>(args)...);
+            } else {
+                // args are used more than once, so they cannot be moved from
+                for(size_t i = 0; i < size; i++) {
+                    new(&elements[i])T(args...);
+                }
+            }
+        }
+
+        static void destroy_elements(T* elements, size_t size) {
+            if constexpr(!std::is_trivially_destructible_v<T>) {
+                for(size_t i = 0; i < size; i++) {
+                    elements[i].~T();
+                }
+            }
+        }
+
+        // constructs one element at a time, destroying them again if one throws
+        template<typename ... params>
+        static void construct_elements_safely(T* elements, size_t size, const params& ... args) {
+            size_t constructed = 0;
+
+            try {
+                for(; constructed < size; constructed++) {
+                    new(&elements[constructed])T(args...);
+                }
+            } catch(...) {
+                destroy_elements(elements, constructed);
+                throw;
+            }
+        }
+
+        // copies value into every element, doubling the copied range each step
+        static void broadcast(T* elements, size_t size, const T& value) {
+            // a value made of one repeated byte, zero being the common one, is a memset
+            const uint8_t* bytes = (const uint8_t*)&value;
+            if(std::all_of(bytes, bytes + sizeof(T), [&](uint8_t byte){ return byte == bytes[0]; })) {
+                memset((void*)elements, bytes[0], size * sizeof(T));
+                return;
+            }
+
+            if(size == 0) {
+                return;
+            }
+
+            memcpy((void*)elements, &value, sizeof(T));
+            for(size_t copied = 1; copied < size; copied *= 2) {
+                memcpy((void*)(elements + copied), elements, std::min(copied, size - copied) * sizeof(T));
+            }
+        }
     
     private:
         memory_pool_t<T> pool;
+        size_t           parallel_threshold_bytesize = parallel_construct_bytesize;
+        size_t           parallel_threads            = 0;
     };
 
     template<typename T>
@@ -0,0 +1,44 @@
+#include "owned_memory_pool.hpp"
+
+namespace ptm {
+    _impl_owned_memory_pool_t::_impl_owned_memory_pool_t(size_t bytesize_of_element, size_t initial_max_elements)
+        : owner(std::this_thread::get_id()), remote_frees(nullptr), pool(bytesize_of_element, initial_max_elements) {
+        assert(bytesize_of_element >= sizeof(_impl_remote_free_t));
+    }
+
+    void* _impl_owned_memory_pool_t::allocate(size_t n, const void* hint) {
+        assert(is_owner());
+
+        if(remote_frees.load(std::memory_order_relaxed))
+            reclaim_remote_frees();
+
+        return pool.allocate(n, hint);
+    }
+
+    void _impl_owned_memory_pool_t::deallocate(void* ptr, size_t n) {
+        if(is_owner()) {
+            pool.deallocate(ptr, n);
+            return;
+        }
+
+        _impl_remote_free_t* node = (_impl_remote_free_t*)ptr;
+        node->n    = n;
+        node->next = remote_frees.load(std::memory_order_relaxed);
+
+        // the owner only ever takes the whole list so there is no ABA to worry about
+        while(!remote_frees.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void _impl_owned_memory_pool_t::reclaim_remote_frees() {
+        assert(is_owner());
+
+        _impl_remote_free_t* node = remote_frees.exchange(nullptr, std::memory_order_acquire);
+
+        while(node) {
+            _impl_remote_free_t* next = node->next;
+
+            pool.deallocate((void*)node, node->n);
+            node = next;
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "memory_pool.hpp"
+#include <atomic>
+#include <thread>
+
+namespace ptm {
+    // written into a block that was freed by a thread which does not own the pool
+    struct _impl_remote_free_t {
+        _impl_remote_free_t* next;
+        size_t               n;
+    };
+
+    // A sparse memory pool that belongs to the thread that created it. Only the owner
+    // may allocate. The owner deallocates directly, any other thread pushes the block
+    // onto a lock free list which the owner takes back in one batch on its next allocation
+    class _impl_owned_memory_pool_t {
+    public:
+        _impl_owned_memory_pool_t(size_t bytesize_of_element, size_t initial_max_elements = 100);
+
+        void* allocate(size_t n, const void* hint = 0);
+        void deallocate(void* ptr, size_t n);
+
+        // deallocates every block freed by other threads, only call from the owner
+        void reclaim_remote_frees();
+
+        bool is_owner() { return std::this_thread::get_id() == owner; }
+        void set_owner(std::thread::id new_owner) { owner = new_owner; }
+
+    private:
+        std::thread::id                   owner;
+        std::atomic<_impl_remote_free_t*> remote_frees;
+        _impl_sparse_memory_pool_t        pool;
+    };
+
+    template<typename T>
+    class owned_memory_pool_t : public allocator_t<T> {
+        static_assert(sizeof(T) >= sizeof(_impl_remote_free_t), "T is too small to hold a remote free");
+
+    public:
+        owned_memory_pool_t(size_t initial_max_elements = 100)
+            : pool(sizeof(T), initial_max_elements) {}
+
+        T* allocate(size_t n, const void* hint = 0) override {
+            return (T*)pool.allocate(n, hint);
+        }
+
+        // safe to call from any thread
+        void deallocate(T* ptr, size_t n) override {
+            pool.deallocate((void*)ptr, n);
+        }
+
+        void reclaim_remote_frees() { pool.reclaim_remote_frees(); }
+
+    private:
+        _impl_owned_memory_pool_t pool;
+    };
+
+    template<typename T>
+    class owned_object_pool_t {
+    public:
+        owned_object_pool_t(size_t max_size = 100)
+            : pool(max_size) {}
+
+        template<typename ... params>
+        T* create(size_t size, params&& ... args) {
+            T* elements = pool.allocate(size);
+
+            for(size_t i = 0; i < size && elements; i++) {
+                pool.construct(&elements[i], args...);
+            }
+
+            return elements;
+        }
+
+        // safe to call from any thread, the destructors run on the calling thread
+        void destroy(T* ptr, size_t size) {
+            for(size_t i = 0; i < size; i++) {
+                pool.destroy(ptr + i);
+            }
+
+            pool.deallocate(ptr, size);
+        }
+
+    private:
+        owned_memory_pool_t<T> pool;
+    };
+}
@@ -0,0 +1,212 @@
+#include "persistent_memory_pool.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ptm {
+    _impl_persistent_memory_pool_t::_impl_persistent_memory_pool_t(const char* path, size_t element_bytesize, size_t initial_max_elements, size_t reserved_max_elements) {
+        if(!open(path, element_bytesize, initial_max_elements, reserved_max_elements)) {
+            log("Failed to open persistent pool %s\n", path);
+            throw std::exception();
+        }
+    }
+
+    _impl_persistent_memory_pool_t::_impl_persistent_memory_pool_t(_impl_persistent_memory_pool_t&& other) {
+        *this = std::move(other);
+    }
+
+    _impl_persistent_memory_pool_t& _impl_persistent_memory_pool_t::operator=(_impl_persistent_memory_pool_t&& other) {
+        if(this == &other)
+            return *this;
+
+        close();
+
+        header           = other.header;
+        fd               = other.fd;
+        created          = other.created;
+        elements_offset  = other.elements_offset;
+        mapping_bytesize = other.mapping_bytesize;
+        memory           = other.memory;
+
+        other.header = nullptr;
+        other.memory = nullptr;
+        other.fd     = -1;
+
+        return *this;
+    }
+
+    _impl_persistent_memory_pool_t::~_impl_persistent_memory_pool_t() {
+        close();
+    }
+
+    bool _impl_persistent_memory_pool_t::open(const char* path, size_t element_bytesize, size_t initial_max_elements, size_t reserved_max_elements) {
+        close();
+
+        fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if(fd < 0)
+            return false;
+
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            close();
+            return false;
+        }
+
+        persistent_pool_header_t stored;
+        created = info.st_size == 0;
+
+        if(created) {
+            if(reserved_max_elements == 0)
+                reserved_max_elements = default_reserve_bytesize / element_bytesize;
+            if(initial_max_elements > reserved_max_elements)
+                initial_max_elements = reserved_max_elements;
+
+            zero(&stored);
+            stored.magic   = persistent_pool_header_t::magic_value;
+            stored.version = persistent_pool_header_t::version_value;
+            stored.element_bytesize      = element_bytesize;
+            stored.reserved_max_elements = reserved_max_elements;
+            stored.root = UINT64_MAX;
+        } else {
+            if((size_t)info.st_size < page_size() || pread(fd, &stored, sizeof(stored), 0) != sizeof(stored) ||
+               stored.magic != persistent_pool_header_t::magic_value ||
+               stored.version != persistent_pool_header_t::version_value ||
+               stored.element_bytesize != element_bytesize) {
+                close();
+                return false;
+            }
+        }
+
+        // header page, then the flags for the whole reservation, then the elements
+        size_t flags_bytesize = round_up(round_up((size_t)stored.reserved_max_elements, bits_per_byte) / bits_per_byte, page_size());
+        elements_offset  = page_size() + flags_bytesize;
+        mapping_bytesize = elements_offset + round_up((size_t)(stored.reserved_max_elements * element_bytesize), page_size());
+
+        // a truncated or partly written file would fault on the first access past its end
+        if(!created && (stored.max_elements > stored.reserved_max_elements ||
+                        (size_t)info.st_size < elements_offset + stored.max_elements * element_bytesize)) {
+            log("persistent pool file %s is smaller than its header says\n", path);
+            close();
+            return false;
+        }
+
+        // mapping past the end of the file is fine as long as
+        // nothing past it is touched, the file grows with the pool
+        memory = mmap(nullptr, mapping_bytesize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+        if(memory == MAP_FAILED) {
+            memory = nullptr;
+            close();
+            return false;
+        }
+
+        header = (persistent_pool_header_t*)memory;
+
+        if(created) {
+            if(ftruncate(fd, elements_offset) != 0) {
+                close();
+                return false;
+            }
+
+            *header = stored;
+
+            if(!grow(initial_max_elements)) {
+                close();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void _impl_persistent_memory_pool_t::close() {
+        if(memory)
+            munmap(memory, mapping_bytesize);
+        if(fd >= 0)
+            ::close(fd);
+
+        header = nullptr;
+        memory = nullptr;
+        fd     = -1;
+    }
+
+    bool _impl_persistent_memory_pool_t::grow(size_t new_max_elements) {
+        if(new_max_elements <= header->max_elements)
+            return true;
+        if(new_max_elements > header->reserved_max_elements)
+            return false;
+
+        // newly added file space reads back as zero, so the new flags start free
+        if(ftruncate(fd, file_bytesize(new_max_elements)) != 0)
+            return false;
+
+        header->max_elements = new_max_elements;
+
+        return true;
+    }
+
+    bool _impl_persistent_memory_pool_t::sync() {
+        return msync(memory, file_bytesize(header->max_elements), MS_SYNC) == 0;
+    }
+
+    void* _impl_persistent_memory_pool_t::get_root() {
+        if(header->root == UINT64_MAX)
+            return nullptr;
+
+        return inc_by_byte(_elements(), header->root * header->element_bytesize);
+    }
+
+    void _impl_persistent_memory_pool_t::set_root(void* element) {
+        if(!element) {
+            header->root = UINT64_MAX;
+            return;
+        }
+
+        assert(elements_in_pool(element));
+
+        header->root = ((uint8_t*)element - _elements()) / header->element_bytesize;
+    }
+
+    void _impl_persistent_memory_pool_t::for_each(const std::function<void(void*)>& func) {
+        for(size_t i = 0; i < header->max_elements; i++) {
+            if(_flags()[i / bits_per_byte] == 0 && i % bits_per_byte == 0) {
+                i += bits_per_byte - 1;
+                continue;
+            }
+
+            if(!is_free(i))
+                func(inc_by_byte(_elements(), i * header->element_bytesize));
+        }
+    }
+
+    void* _impl_persistent_memory_pool_t::allocate(size_t n) {
+        if(n == 0 || !memory)
+            return nullptr;
+
+        size_t elements_index = find_free_bits_or_grow([&](size_t byte) { return _flags()[byte]; },
+                                                       header->last_free, header->max_elements, header->reserved_max_elements, n,
+                                                       [&](size_t new_max_elements) { return grow(new_max_elements); });
+        if(elements_index == SIZE_MAX)
+            return nullptr;
+
+        for(size_t i = elements_index; i < elements_index + n; i++) {
+            flip_bit(i);
+        }
+
+        header->last_free = elements_index + n;
+
+        return (void*)inc_by_byte(_elements(), elements_index * header->element_bytesize);
+    }
+
+    void _impl_persistent_memory_pool_t::deallocate(void* elements, size_t n) {
+        size_t elements_index = ((uint8_t*)elements - _elements()) / header->element_bytesize;
+
+        header->last_free = elements_index;
+
+        for(size_t i = elements_index; i < elements_index + n; i++) {
+            assert(!is_free(i));
+
+            flip_bit(i);
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "memory_pool.hpp"
+#include "virtual_memory.hpp"
+#include "pointer.hpp"
+
+namespace ptm {
+    // lives at the start of a persistent pool's file
+    struct persistent_pool_header_t {
+        static constexpr uint64_t magic_value   = 0x6c6f6f70'6d747028; // "(ptmpool"
+        static constexpr uint32_t version_value = 1;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved0;
+        uint64_t element_bytesize;
+        uint64_t reserved_max_elements;
+        uint64_t max_elements;  // elements backed by the file
+        uint64_t root;          // index of the root element, UINT64_MAX if there is none
+        uint64_t last_free;
+    };
+
+    // A continuous memory pool whose flags and elements are a memory mapped file.
+    // Reopening the file gives back every element exactly as it was left, so nothing
+    // has to be rebuilt. The whole reservation is mapped at once and the file is only
+    // extended as the pool grows, elements never move while the pool is open.
+    // Elements may be mapped at a different address the next time the file is opened,
+    // pointers stored in elements must be relative_ptr_t or indices, never raw pointers
+    class _impl_persistent_memory_pool_t {
+    public:
+        // 16 GiB of address space by default
+        static constexpr size_t default_reserve_bytesize = (size_t)1 << 34;
+
+        _impl_persistent_memory_pool_t() {}
+        // opens the pool stored in path, creating the file if it does not exist
+        _impl_persistent_memory_pool_t(const char* path, size_t element_bytesize, size_t initial_max_elements = 100, size_t reserved_max_elements = 0);
+        _impl_persistent_memory_pool_t(_impl_persistent_memory_pool_t&& other);
+        _impl_persistent_memory_pool_t& operator=(_impl_persistent_memory_pool_t&& other);
+        ~_impl_persistent_memory_pool_t();
+
+        // Returns false if the file could not be opened or was made with a
+        // different element size. reserved_max_elements is only used when the file is created
+        bool open(const char* path, size_t element_bytesize, size_t initial_max_elements = 100, size_t reserved_max_elements = 0);
+        void close();
+
+        bool valid() { return (uint8_t*)memory; }
+        // true if open() had to create the file
+        bool was_created() { return created; }
+
+        void* allocate(size_t n);
+        void deallocate(void* elements, size_t n);
+        bool grow(size_t new_max_elements);
+
+        // blocks until every change made so far is written to the file
+        bool sync();
+
+        // the root is how a program finds its way back into the pool after reopening it
+        void* get_root();
+        void set_root(void* element);
+
+        // calls func on every allocated element
+        void for_each(const std::function<void(void*)>& func);
+
+        void* get_block() { return (void*)_elements(); }
+        bool elements_in_pool(void* ptr) { return _elements() <= (uint8_t*)ptr && (uint8_t*)ptr < inc_by_byte(_elements(), header->max_elements * header->element_bytesize); }
+
+        size_t get_max_elements() { return header->max_elements; }
+
+    private:
+        static constexpr size_t bits_per_byte = 8;
+
+        size_t file_bytesize(size_t max_elements) { return elements_offset + max_elements * header->element_bytesize; }
+
+        uint8_t* _flags() { return inc_by_byte((uint8_t*)memory, page_size()); }
+        uint8_t* _elements() { return inc_by_byte((uint8_t*)memory, elements_offset); }
+
+        bool is_free(size_t index) { return !(_flags()[index / bits_per_byte] & (1 << (index % bits_per_byte))); }
+        void flip_bit(size_t index) { _flags()[index / bits_per_byte] ^= (1 << (index % bits_per_byte)); }
+
+    private:
+        persistent_pool_header_t* header = nullptr;
+
+        int    fd                = -1;
+        bool   created           = false;
+        size_t elements_offset   = 0;
+        size_t mapping_bytesize  = 0;
+        void*  memory            = nullptr;
+    };
+
+    template<typename T>
+    class persistent_object_pool_t {
+    public:
+        persistent_object_pool_t(const char* path, size_t initial_max_elements = 100, size_t reserved_max_elements = 0)
+            : pool(path, sizeof(T), initial_max_elements, reserved_max_elements) {}
+
+        bool valid() { return pool.valid(); }
+        bool was_created() { return pool.was_created(); }
+
+        template<typename ... params>
+        T* create(size_t size, params&& ... args) {
+            T* elements = (T*)pool.allocate(size);
+
+            for(size_t i = 0; i < size && elements; i++) {
+                new(&elements[i])T(args...);
+            }
+
+            return elements;
+        }
+
+        void destroy(T* ptr, size_t size) {
+            for(size_t i = 0; i < size; i++) {
+                ptr[i].~T();
+            }
+
+            pool.deallocate((void*)ptr, size);
+        }
+
+        T* get_root() { return (T*)pool.get_root(); }
+        void set_root(T* root) { pool.set_root((void*)root); }
+
+        template<typename func_t>
+        void for_each(func_t&& func) {
+            pool.for_each([&](void* element) { func(*(T*)element); });
+        }
+
+        bool sync() { return pool.sync(); }
+
+    private:
+        _impl_persistent_memory_pool_t pool;
+    };
+}
@@ -77,4 +77,167 @@ namespace ptm {
     private:
         T* object; 
     }; 
+
+    // A pointer stored as the distance from itself to the object. It stays valid when
+    // the memory holding both of them is mapped somewhere else, such as a
+    // persistent or shared pool being reopened. Copying recomputes the distance
+    template<typename T>
+    class relative_ptr_t {
+    public:
+        template<typename U>
+        static constexpr bool castable = std::is_convertible_v<U*, T*> || std::is_convertible_v<T*, U*>;
+
+        relative_ptr_t() {}
+
+        relative_ptr_t(T* object) {
+            set(object);
+        }
+
+        relative_ptr_t(const relative_ptr_t<T>& other) {
+            set(other.get());
+        }
+
+        template<typename U, bool can_convert = castable<U>>
+        relative_ptr_t(const relative_ptr_t<U>& other) {
+            static_assert(can_convert == true);
+
+            set(static_cast<T*>(other.get()));
+        }
+
+        relative_ptr_t<T>& operator=(const relative_ptr_t<T>& other) {
+            set(other.get());
+            return *this;
+        }
+
+        relative_ptr_t<T>& operator=(T* object) {
+            set(object);
+            return *this;
+        }
+
+        bool is_null() const {
+            return offset == null_offset;
+        }
+
+        void set(T* new_object) {
+            offset = new_object ? (intptr_t)new_object - (intptr_t)this : null_offset;
+        }
+
+        T* get() const {
+            return is_null() ? nullptr : (T*)((intptr_t)this + offset);
+        }
+
+        T& operator*() const {
+            return *get();
+        }
+
+        T* operator->() const {
+            return get();
+        }
+
+        bool operator==(const relative_ptr_t<T>& other) const {
+            return get() == other.get();
+        }
+
+        bool operator==(const T* other) const {
+            return get() == other;
+        }
+
+        bool operator!=(const relative_ptr_t<T>& other) const {
+            return get() != other.get();
+        }
+
+        bool operator!=(const T* other) const {
+            return get() != other;
+        }
+
+    private:
+        // 0 would be a pointer to itself, 1 can't be the distance to an aligned T
+        static constexpr intptr_t null_offset = 1;
+
+        intptr_t offset = null_offset;
+    };
+
+    // A 32 bit pointer into a pool, stored as the byte offset from the pool's base.
+    // pool_t must have a static base() that returns the base as a uint8_t*, an
+    // offset of 0 is null so the base itself must never be an object.
+    // See compressed_object_pool_t for a pool that hands these out
+    template<typename T, typename pool_t>
+    class pool_ptr_t {
+    public:
+        template<typename U>
+        static constexpr bool castable = std::is_convertible_v<U*, T*> || std::is_convertible_v<T*, U*>;
+
+        pool_ptr_t() {}
+                                                                 /* allows upcasting vvv */
+        template<typename U, bool can_convert = castable<U>>
+        pool_ptr_t(pool_ptr_t<U, pool_t> other) {
+            static_assert(can_convert == true);
+
+            set(static_cast<T*>(other.get()));
+        }
+
+        pool_ptr_t(T* object) {
+            set(object);
+        }
+
+        bool is_null() const {
+            return offset == 0;
+        }
+
+        void set(T* new_object) {
+            assert(!new_object || ((uint8_t*)new_object > pool_t::base() && (uint8_t*)new_object - pool_t::base() <= UINT32_MAX));
+
+            offset = new_object ? (uint32_t)((uint8_t*)new_object - pool_t::base()) : 0;
+        }
+
+        // compiles down to an add and a conditional move
+        T* get() const {
+            T* object = (T*)(pool_t::base() + offset);
+
+            return offset ? object : nullptr;
+        }
+
+        uint32_t get_offset() const {
+            return offset;
+        }
+
+        T& operator*() const {
+            return *get();
+        }
+
+        T* operator->() const {
+            return get();
+        }
+
+        template<typename U, bool can_convert = castable<U>>
+        operator U*() const {
+            return cast<U, can_convert>();
+        }
+
+        template<typename U, bool can_convert = castable<U>>
+        U* cast() const {
+            static_assert(can_convert == true);
+
+            return static_cast<U*>(get());
+        }
+
+        bool operator==(const pool_ptr_t<T, pool_t>& other) const {
+            return offset == other.offset;
+        }
+
+        bool operator==(const T* other) const {
+            return get() == other;
+        }
+
+        bool operator!=(const pool_ptr_t<T, pool_t>& other) const {
+            return offset != other.offset;
+        }
+
+        bool operator!=(const T* other) const {
+            return get() != other;
+        }
+
+    private:
+        uint32_t offset = 0;
+    };
 }
\ No newline at end of file
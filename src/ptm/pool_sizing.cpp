@@ -0,0 +1,171 @@
+#include "pool_sizing.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+
+namespace ptm {
+    struct learned_size_t {
+        size_t peak_live_elements;
+        double allocations_per_second;
+    };
+
+    struct pool_sizing_registry_t {
+        std::mutex mutex;
+
+        std::map<std::string, learned_size_t> loaded;
+        std::map<std::string, pool_usage_t>   destroyed; // the pools of this run that are gone
+        std::set<_impl_pool_sizing_t*>        alive;
+    };
+
+    static std::atomic<double> growth_horizon = default_pool_growth_horizon;
+
+    // never destroyed, static pools are destroyed after everything else
+    static pool_sizing_registry_t& registry() {
+        static pool_sizing_registry_t* registry = new pool_sizing_registry_t();
+        return *registry;
+    }
+
+    static void merge(pool_usage_t& usage, _impl_pool_sizing_t* sizing) {
+        usage.live_elements         += sizing->get_live_elements();
+        usage.peak_live_elements     = std::max(usage.peak_live_elements, sizing->get_peak_live_elements());
+        usage.allocations           += sizing->get_allocations();
+        usage.allocations_per_second = std::max(usage.allocations_per_second, sizing->get_allocations_per_second());
+    }
+
+    _impl_pool_sizing_t::_impl_pool_sizing_t(const char* name)
+        : name(name), growth_time(clock_t::now()) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+
+        auto learned = registry().loaded.find(this->name);
+        if(learned != registry().loaded.end())
+            learned_elements = learned->second.peak_live_elements;
+
+        registry().alive.insert(this);
+    }
+
+    _impl_pool_sizing_t::~_impl_pool_sizing_t() {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+
+        pool_usage_t& usage = registry().destroyed[name];
+        merge(usage, this);
+        usage.live_elements = 0;
+
+        registry().alive.erase(this);
+    }
+
+    size_t _impl_pool_sizing_t::get_initial_max_elements(size_t initial_max_elements) {
+        return learned_elements ? learned_elements : initial_max_elements;
+    }
+
+    size_t _impl_pool_sizing_t::next_max_elements(size_t max_elements, size_t largest_max_elements, size_t n) {
+        clock_t::time_point now     = clock_t::now();
+        double              seconds = std::max(std::chrono::duration<double>(now - growth_time).count(), 1e-6);
+
+        size_t grown = live_elements > live_at_growth ? live_elements - live_at_growth : 0;
+        allocations_per_second = std::max(allocations_per_second, (allocations - allocations_at_growth) / seconds);
+
+        double projected = grown / seconds * growth_horizon.load(std::memory_order_relaxed);
+        size_t next      = (size_t)std::min(projected, grown * 2.0);
+
+        live_at_growth        = live_elements;
+        allocations_at_growth = allocations;
+        growth_time           = now;
+
+        return std::max({next, largest_max_elements, max_elements / 2, n, min_growth_elements});
+    }
+
+    void set_pool_growth_horizon(double seconds) {
+        growth_horizon.store(seconds, std::memory_order_relaxed);
+    }
+
+    bool load_pool_sizes(const char* path) {
+        FILE* file = fopen(path, "r");
+        if(!file)
+            return false;
+
+        std::map<std::string, learned_size_t> loaded;
+
+        // each line is the peak, the rate and then the name, which may have spaces
+        char line[1024];
+        while(fgets(line, sizeof(line), file)) {
+            if(line[0] == '#')
+                continue;
+
+            learned_size_t learned;
+            int            name_start = 0;
+            if(sscanf(line, "%zu %lf %n", &learned.peak_live_elements, &learned.allocations_per_second, &name_start) != 2 || !name_start)
+                continue;
+
+            std::string name = line + name_start;
+            while(!name.empty() && (name.back() == '\n' || name.back() == '\r'))
+                name.pop_back();
+
+            if(!name.empty())
+                loaded[name] = learned;
+        }
+
+        fclose(file);
+
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().loaded = std::move(loaded);
+
+        return true;
+    }
+
+    bool save_pool_sizes(const char* path) {
+        std::map<std::string, learned_size_t> sizes;
+
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+
+            sizes = registry().loaded;
+
+            // what was seen in this run replaces what was loaded
+            std::map<std::string, pool_usage_t> seen = registry().destroyed;
+            for(_impl_pool_sizing_t* sizing : registry().alive)
+                merge(seen[sizing->get_name()], sizing);
+
+            for(auto& [name, usage] : seen) {
+                if(usage.peak_live_elements)
+                    sizes[name] = learned_size_t{usage.peak_live_elements, usage.allocations_per_second};
+            }
+        }
+
+        FILE* file = fopen(path, "w");
+        if(!file)
+            return false;
+
+        fprintf(file, "# portem pool sizes: peak live elements, allocations per second, name\n");
+        for(auto& [name, learned] : sizes)
+            fprintf(file, "%zu %.1f %s\n", learned.peak_live_elements, learned.allocations_per_second, name.c_str());
+
+        return fclose(file) == 0;
+    }
+
+    size_t get_learned_pool_size(const char* name) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+
+        auto learned = registry().loaded.find(name);
+        return learned == registry().loaded.end() ? 0 : learned->second.peak_live_elements;
+    }
+
+    pool_usage_t get_pool_usage(const char* name) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+
+        pool_usage_t usage;
+
+        auto destroyed = registry().destroyed.find(name);
+        if(destroyed != registry().destroyed.end())
+            usage = destroyed->second;
+
+        for(_impl_pool_sizing_t* sizing : registry().alive) {
+            if(sizing->get_name() == name) {
+                merge(usage, sizing);
+                usage.pools++;
+            }
+        }
+
+        return usage;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "base.hpp"
+#include <chrono>
+#include <string>
+
+// Adaptive pool sizing. A pool given a sizing name (object_pool_t, memory_pool_t and
+// rda_t::register_type all take one) records its peak number of live elements and
+// its allocation rate, and sizes each new sub pool from how fast it has been growing
+// instead of doubling. The peaks can be saved to a profile file and loaded at startup,
+// a pool whose name is in the loaded profile then starts with its learned size in one
+// sub pool:
+//
+//     ptm::load_pool_sizes("pool_sizes.txt");
+//     ptm::object_pool_t<node_t> nodes(100, "nodes");
+//     ...
+//     ptm::save_pool_sizes("pool_sizes.txt");
+//
+// Pools with the same name share their entry in the profile, which keeps the largest
+// peak of them. Loading and saving must not happen while other threads use named pools
+namespace ptm {
+    struct pool_usage_t {
+        size_t pools                 = 0; // named pools alive right now
+        size_t live_elements         = 0;
+        size_t peak_live_elements    = 0;
+        size_t allocations           = 0;
+        double allocations_per_second = 0.0; // the fastest seen between two growths
+    };
+
+    // Reads a profile written by save_pool_sizes, replacing what was loaded before.
+    // Returns false if the file can't be read
+    bool load_pool_sizes(const char* path);
+
+    // Writes the peak of every named pool seen in this run, as well as the loaded
+    // entries of names not seen. Returns false if the file can't be written
+    bool save_pool_sizes(const char* path);
+
+    // the number of elements a pool of this name starts with, 0 if it was not loaded
+    size_t get_learned_pool_size(const char* name);
+
+    // what the pools of this name have done in this run
+    pool_usage_t get_pool_usage(const char* name);
+
+    constexpr double default_pool_growth_horizon = 1.0;
+
+    // How many seconds of growth at their recent rate named pools add room for when
+    // they are full, by default default_pool_growth_horizon
+    void set_pool_growth_horizon(double seconds);
+
+    // The usage of one named sparse pool. It is kept behind a pointer so the pool
+    // can move while it is registered
+    class _impl_pool_sizing_t {
+    public:
+        static constexpr size_t min_growth_elements = 16;
+
+        _impl_pool_sizing_t(const char* name);
+        ~_impl_pool_sizing_t();
+
+        _impl_pool_sizing_t(const _impl_pool_sizing_t&) = delete;
+        _impl_pool_sizing_t& operator=(const _impl_pool_sizing_t&) = delete;
+
+        // initial_max_elements unless the name has a learned size
+        size_t get_initial_max_elements(size_t initial_max_elements);
+
+        // The size of the next sub pool once max_elements are full and n more are asked
+        // for. Enough for the live elements to keep growing at their recent rate for the
+        // growth horizon, up to twice what they grew by since the last sub pool. It is
+        // never smaller than the largest sub pool or half of max_elements, so a slowly
+        // growing pool still grows geometrically and keeps few sub pools
+        size_t next_max_elements(size_t max_elements, size_t largest_max_elements, size_t n);
+
+        void on_allocate(size_t n) {
+            allocations   += n;
+            live_elements += n;
+            peak_live_elements = std::max(peak_live_elements, live_elements);
+        }
+
+        void on_deallocate(size_t n) {
+            live_elements -= n;
+        }
+
+        const std::string& get_name() { return name; }
+        size_t get_live_elements() { return live_elements; }
+        size_t get_peak_live_elements() { return peak_live_elements; }
+        size_t get_allocations() { return allocations; }
+        double get_allocations_per_second() { return allocations_per_second; }
+
+    private:
+        using clock_t = std::chrono::steady_clock;
+
+        std::string name;
+        size_t      learned_elements   = 0;
+        size_t      live_elements      = 0;
+        size_t      peak_live_elements = 0;
+        size_t      allocations        = 0;
+        double      allocations_per_second = 0.0;
+
+        // where the pool was when its last sub pool was added
+        size_t            live_at_growth        = 0;
+        size_t            allocations_at_growth = 0;
+        clock_t::time_point growth_time;
+    };
+}
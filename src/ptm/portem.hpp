@@ -1,8 +1,27 @@
 #pragma once
 
 #include "memory_pool.hpp"
+#include "recycling_object_pool.hpp"
+#include "smart_pointer.hpp"
+#include "reserved_memory_pool.hpp"
+#include "compressed_object_pool.hpp"
+#include "owned_memory_pool.hpp"
+#include "coroutine_frame_pool.hpp"
+#include "persistent_memory_pool.hpp"
+#include "shared_memory_pool.hpp"
 #include "small_list.hpp"
 #include "free_list.hpp"
+#include "intrusive_list.hpp"
+#include "flat_hash_map.hpp"
+#include "lru_cache.hpp"
+#include "ring.hpp"
+#include "io_buffer_pool.hpp"
 #include "stack_allocator.hpp"
-#include "static_list.hpp"
-#include "runtime_dynamic_allocator.hpp"
\ No newline at end of file
+#include "composable_allocator.hpp"
+#include "basic_pool.hpp"
+#include "epoch.hpp"
+#include "heap_profiler.hpp"
+#include "pool_sizing.hpp"
+#include "inplace_vector.hpp"
+#include "runtime_dynamic_allocator.hpp"
+#include "archetype_storage.hpp"
\ No newline at end of file
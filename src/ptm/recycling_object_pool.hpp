@@ -0,0 +1,79 @@
+#pragma once
+
+#include "memory_pool.hpp"
+
+namespace ptm {
+    // How many bytes a recycled object holds on to outside of itself. Uses
+    // T::retained_bytesize() if it has one, the capacity of containers, otherwise 0
+    template<typename T>
+    struct retained_bytesize_of_t {
+        size_t operator()(const T& object) const {
+            if constexpr(requires { { object.retained_bytesize() } -> std::convertible_to<size_t>; }) {
+                return object.retained_bytesize();
+            } else if constexpr(requires { object.capacity(); typename T::value_type; }) {
+                return object.capacity() * sizeof(typename T::value_type);
+            } else {
+                return 0;
+            }
+        }
+    };
+
+    // An object pool that keeps destroyed objects constructed so the buffers they own
+    // survive to the next create. A recycled object is handed out again after calling
+    // its reset(args...), a new one is constructed from args. Objects that retain more
+    // than max_retained_bytesize, or arrive when max_recycled are already waiting,
+    // are destroyed for real
+    template<typename T, typename retained_bytesize_t = retained_bytesize_of_t<T>>
+    class recycling_object_pool_t {
+    public:
+        recycling_object_pool_t(size_t max_size = 100, size_t max_recycled = SIZE_MAX, size_t max_retained_bytesize = SIZE_MAX)
+            : max_recycled(max_recycled), max_retained_bytesize(max_retained_bytesize), pool(max_size) {}
+
+        ~recycling_object_pool_t() {
+            trim();
+        }
+
+        recycling_object_pool_t(const recycling_object_pool_t&) = delete;
+        recycling_object_pool_t& operator=(const recycling_object_pool_t&) = delete;
+
+        template<typename ... params>
+        T* create(params&& ... args) {
+            if(recycled.empty()) {
+                return pool.create(1, std::forward<params>(args)...);
+            }
+
+            // the most recently destroyed object is the most likely to be in cache
+            T* object = recycled.back();
+            recycled.pop_back();
+
+            object->reset(std::forward<params>(args)...);
+            return object;
+        }
+
+        void destroy(T* object) {
+            if(recycled.size() >= max_recycled || retained_bytesize_t()(*object) > max_retained_bytesize) {
+                pool.destroy(object, 1);
+                return;
+            }
+
+            recycled.push_back(object);
+        }
+
+        // destroys every object waiting to be recycled
+        void trim() {
+            for(T* object : recycled) {
+                pool.destroy(object, 1);
+            }
+
+            recycled.clear();
+        }
+
+        size_t get_recycled_count() { return recycled.size(); }
+
+    private:
+        size_t            max_recycled;
+        size_t            max_retained_bytesize;
+        std::vector<T*>   recycled;
+        object_pool_t<T>  pool;
+    };
+}
@@ -0,0 +1,140 @@
+#include "reserved_memory_pool.hpp"
+
+namespace ptm {
+    _impl_reserved_memory_pool_t::_impl_reserved_memory_pool_t(size_t element_bytesize, size_t initial_max_elements, size_t reserved_max_elements) {
+        reset(element_bytesize, initial_max_elements, reserved_max_elements);
+    }
+
+    _impl_reserved_memory_pool_t::_impl_reserved_memory_pool_t(_impl_reserved_memory_pool_t&& other) {
+        *this = std::move(other);
+    }
+
+    _impl_reserved_memory_pool_t& _impl_reserved_memory_pool_t::operator=(_impl_reserved_memory_pool_t&& other) {
+        if(this == &other)
+            return *this;
+
+        release();
+
+        cache                       = other.cache;
+        bytesize_of_element         = other.bytesize_of_element;
+        max_elements                = other.max_elements;
+        reserved_max_elements       = other.reserved_max_elements;
+        flags_reserved_bytesize     = other.flags_reserved_bytesize;
+        flags_committed_bytesize    = other.flags_committed_bytesize;
+        elements_committed_bytesize = other.elements_committed_bytesize;
+        reserved_bytesize           = other.reserved_bytesize;
+        memory                      = other.memory;
+
+        other.memory = nullptr;
+
+        return *this;
+    }
+
+    _impl_reserved_memory_pool_t::~_impl_reserved_memory_pool_t() {
+        release();
+    }
+
+    void _impl_reserved_memory_pool_t::release() {
+        if(memory)
+            release_virtual_memory(memory, reserved_bytesize);
+
+        memory = nullptr;
+    }
+
+    bool _impl_reserved_memory_pool_t::reset(size_t bytesize_of_element, size_t initial_max_elements, size_t reserved_max_elements) {
+        release();
+
+        if(reserved_max_elements == 0)
+            reserved_max_elements = default_reserve_bytesize / bytesize_of_element;
+        if(initial_max_elements > reserved_max_elements)
+            initial_max_elements = reserved_max_elements;
+
+        cache.last_free = 0;
+
+        this->bytesize_of_element   = bytesize_of_element;
+        this->reserved_max_elements = reserved_max_elements;
+        max_elements                = 0;
+        flags_committed_bytesize    = 0;
+        elements_committed_bytesize = 0;
+
+        // the flags get their own page aligned part of the reservation so both
+        // the flags and the elements can be committed independently
+        flags_reserved_bytesize = round_up(round_up(reserved_max_elements, bits_per_byte) / bits_per_byte, page_size());
+        reserved_bytesize       = flags_reserved_bytesize + round_up(reserved_max_elements * bytesize_of_element, page_size());
+
+        memory = reserve_virtual_memory(reserved_bytesize);
+        if(!memory) {
+            log("Failed to reserve %zu bytes of address space", reserved_bytesize);
+            throw std::exception();
+        }
+
+        if(!grow(initial_max_elements)) {
+            log("Failed to commit memory");
+            throw std::exception();
+        }
+
+        return memory != nullptr;
+    }
+
+    bool _impl_reserved_memory_pool_t::grow(size_t new_max_elements) {
+        if(new_max_elements <= max_elements)
+            return true;
+        if(new_max_elements > reserved_max_elements)
+            return false;
+
+        size_t new_flags_bytesize    = round_up(round_up(new_max_elements, bits_per_byte) / bits_per_byte, page_size());
+        size_t new_elements_bytesize = round_up(new_max_elements * bytesize_of_element, page_size());
+
+        if(new_flags_bytesize > flags_committed_bytesize) {
+            if(!commit_virtual_memory(_flags() + flags_committed_bytesize, new_flags_bytesize - flags_committed_bytesize))
+                return false;
+
+            flags_committed_bytesize = new_flags_bytesize;
+        }
+
+        if(new_elements_bytesize > elements_committed_bytesize) {
+            if(!commit_virtual_memory(_elements() + elements_committed_bytesize, new_elements_bytesize - elements_committed_bytesize))
+                return false;
+
+            elements_committed_bytesize = new_elements_bytesize;
+        }
+
+        // make use of the rest of the last committed page
+        max_elements = std::min(elements_committed_bytesize / bytesize_of_element,
+                                flags_committed_bytesize * bits_per_byte);
+        max_elements = std::min(max_elements, reserved_max_elements);
+
+        return true;
+    }
+
+    void* _impl_reserved_memory_pool_t::allocate(size_t n) {
+        if(n == 0 || !memory)
+            return nullptr;
+
+        size_t elements_index = find_free_bits_or_grow([&](size_t byte) { return _flags()[byte]; },
+                                                       cache.last_free, max_elements, reserved_max_elements, n,
+                                                       [&](size_t new_max_elements) { return grow(new_max_elements); });
+        if(elements_index == SIZE_MAX)
+            return nullptr;
+
+        for(size_t i = elements_index; i < elements_index + n; i++) {
+            flip_bit(i);
+        }
+
+        cache.last_free = elements_index + n;
+
+        return (void*)inc_by_byte(_elements(), elements_index * bytesize_of_element);
+    }
+
+    void _impl_reserved_memory_pool_t::deallocate(void* elements, size_t n) {
+        size_t elements_index = ((uint8_t*)elements - _elements()) / bytesize_of_element;
+
+        cache.last_free = elements_index;
+
+        for(size_t i = elements_index; i < elements_index + n; i++) {
+            assert(!is_free(i));
+
+            flip_bit(i);
+        }
+    }
+}
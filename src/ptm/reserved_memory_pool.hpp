@@ -0,0 +1,86 @@
+#pragma once
+
+#include "memory_pool.hpp"
+#include "virtual_memory.hpp"
+
+namespace ptm {
+    // A continuous memory pool that reserves a large range of address space up front
+    // and only commits the part of it that is in use. When the pool runs out of room
+    // more of the reservation is committed, so elements never move and
+    // all of them stay in one continuous array
+    class _impl_reserved_memory_pool_t {
+    public:
+        // 4 GiB of address space by default, it costs nothing until committed
+        static constexpr size_t default_reserve_bytesize = (size_t)1 << 32;
+
+        _impl_reserved_memory_pool_t() {}
+        _impl_reserved_memory_pool_t(size_t element_bytesize, size_t initial_max_elements, size_t reserved_max_elements = 0);
+        _impl_reserved_memory_pool_t(_impl_reserved_memory_pool_t&& other);
+        _impl_reserved_memory_pool_t& operator=(_impl_reserved_memory_pool_t&& other);
+        ~_impl_reserved_memory_pool_t();
+
+        // Releases the old reservation and makes a new one.
+        // All elements MUST be deallocated. if reserved_max_elements is 0
+        // default_reserve_bytesize is used. Returns true if reset was successful
+        bool reset(size_t element_bytesize, size_t initial_max_elements, size_t reserved_max_elements = 0);
+
+        bool valid() { return (uint8_t*)memory; }
+        void* allocate(size_t n);
+        void deallocate(void* elements, size_t n);
+
+        // Commits enough memory to hold at least new_max_elements,
+        // returns false if the reservation is too small or the commit failed
+        bool grow(size_t new_max_elements);
+
+        void* get_block() { return (void*)_elements(); }
+        bool elements_in_pool(void* ptr) { return _elements() <= (uint8_t*)ptr && (uint8_t*)ptr < inc_by_byte(_elements(), max_elements * bytesize_of_element); }
+
+        size_t get_max_elements() { return max_elements; }
+        size_t get_reserved_max_elements() { return reserved_max_elements; }
+
+    private:
+        static constexpr size_t bits_per_byte = 8;
+
+        void release();
+        uint8_t* _flags() { return (uint8_t*)memory; }
+        uint8_t* _elements() { return inc_by_byte((uint8_t*)memory, flags_reserved_bytesize); }
+
+        bool is_free(size_t index) { return !(_flags()[index / bits_per_byte] & (1 << (index % bits_per_byte))); }
+        void flip_bit(size_t index) { _flags()[index / bits_per_byte] ^= (1 << (index % bits_per_byte)); }
+
+    private:
+        struct {
+            size_t last_free;
+        } cache = {0};
+
+        size_t bytesize_of_element     = 0;
+        size_t max_elements            = 0; // elements backed by committed memory
+        size_t reserved_max_elements   = 0; // elements the reservation can ever hold
+        size_t flags_reserved_bytesize = 0;
+        size_t flags_committed_bytesize    = 0;
+        size_t elements_committed_bytesize = 0;
+        size_t reserved_bytesize       = 0;
+        void*  memory                  = nullptr;
+    };
+
+    template<typename T>
+    class reserved_memory_pool_t : public allocator_t<T> {
+    public:
+        reserved_memory_pool_t(size_t initial_max_elements = 100, size_t reserved_max_elements = 0)
+            : pool(sizeof(T), initial_max_elements, reserved_max_elements) {}
+
+        T* allocate(size_t n, const void* hint = 0) override {
+            return (T*)pool.allocate(n);
+        }
+
+        void deallocate(T* ptr, size_t n) override {
+            pool.deallocate((void*)ptr, n);
+        }
+
+        T* data() { return (T*)pool.get_block(); }
+        size_t get_max_elements() { return pool.get_max_elements(); }
+
+    private:
+        _impl_reserved_memory_pool_t pool;
+    };
+}
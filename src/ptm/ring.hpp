@@ -0,0 +1,299 @@
+#pragma once
+
+#include "virtual_memory.hpp"
+#include "allocator.hpp"
+#include <atomic>
+#include <bit>
+
+namespace ptm {
+    // The slots of a ring. They come from a Portem allocator or, without one,
+    // straight from the OS, optionally on huge pages
+    template<typename slot_t>
+    class _impl_ring_storage_t {
+    public:
+        _impl_ring_storage_t(size_t capacity, allocator_t<uint8_t>* allocator, bool huge_pages)
+            : allocator(allocator) {
+            assert(std::has_single_bit(capacity));
+
+            bytesize = capacity * sizeof(slot_t);
+
+            if(allocator) {
+                // the allocator only promises byte alignment, so leave room to align the slots
+                memory = allocator->allocate(bytesize + alignof(slot_t));
+                slots  = (slot_t*)round_up((size_t)memory, alignof(slot_t));
+            } else {
+                size_t granularity = huge_pages ? huge_page_size() : page_size();
+
+                bytesize = round_up(bytesize, granularity);
+                memory   = (uint8_t*)(huge_pages ? map_huge_virtual_memory(bytesize) : map_virtual_memory(bytesize));
+                slots    = (slot_t*)memory;
+            }
+
+            if(!memory) {
+                log("Failed to allocate a ring of %zu slots", capacity);
+                throw std::exception();
+            }
+        }
+
+        ~_impl_ring_storage_t() {
+            if(allocator) {
+                allocator->deallocate(memory, bytesize + alignof(slot_t));
+            } else {
+                release_virtual_memory(memory, bytesize);
+            }
+        }
+
+        _impl_ring_storage_t(const _impl_ring_storage_t&) = delete;
+        _impl_ring_storage_t& operator=(const _impl_ring_storage_t&) = delete;
+
+        slot_t* get_slots() { return slots; }
+
+    private:
+        allocator_t<uint8_t>* allocator;
+        uint8_t*              memory;
+        size_t                bytesize;
+        slot_t*               slots;
+    };
+
+    // A bounded lock free queue for exactly one producer thread and one consumer
+    // thread. capacity must be a power of two. Each side keeps a copy of the other's
+    // index and only reloads it when the ring looks full or empty
+    template<typename T>
+    class spsc_ring_t {
+    public:
+        spsc_ring_t(size_t capacity, allocator_t<uint8_t>* allocator = nullptr, bool huge_pages = false)
+            : mask(capacity - 1), storage(capacity, allocator, huge_pages) {}
+
+        ~spsc_ring_t() {
+            for(size_t i = consumer.head; i != producer.tail; i++) {
+                slots()[i & mask].~T();
+            }
+        }
+
+        spsc_ring_t(const spsc_ring_t&) = delete;
+        spsc_ring_t& operator=(const spsc_ring_t&) = delete;
+
+        // only call from the producer
+        template<typename U>
+        bool try_push(U&& value) {
+            size_t tail = producer.tail.load(std::memory_order_relaxed);
+
+            if(tail - producer.cached_head > mask) {
+                producer.cached_head = consumer.head.load(std::memory_order_acquire);
+                if(tail - producer.cached_head > mask)
+                    return false;
+            }
+
+            new(&slots()[tail & mask])T(std::forward<U>(value));
+            producer.tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // pushes as many of values as fit, returns how many. only call from the producer
+        size_t try_push(const T* values, size_t n) {
+            size_t tail = producer.tail.load(std::memory_order_relaxed);
+
+            if(mask + 1 - (tail - producer.cached_head) < n) {
+                producer.cached_head = consumer.head.load(std::memory_order_acquire);
+            }
+
+            n = std::min(n, mask + 1 - (tail - producer.cached_head));
+            for(size_t i = 0; i < n; i++) {
+                new(&slots()[(tail + i) & mask])T(values[i]);
+            }
+
+            producer.tail.store(tail + n, std::memory_order_release);
+            return n;
+        }
+
+        // only call from the consumer
+        bool try_pop(T& value) {
+            size_t head = consumer.head.load(std::memory_order_relaxed);
+
+            if(head == consumer.cached_tail) {
+                consumer.cached_tail = producer.tail.load(std::memory_order_acquire);
+                if(head == consumer.cached_tail)
+                    return false;
+            }
+
+            T* slot = &slots()[head & mask];
+            value = std::move(*slot);
+            slot->~T();
+
+            consumer.head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // pops up to n values into values, returns how many. only call from the consumer
+        size_t try_pop(T* values, size_t n) {
+            size_t head = consumer.head.load(std::memory_order_relaxed);
+
+            if(consumer.cached_tail - head < n) {
+                consumer.cached_tail = producer.tail.load(std::memory_order_acquire);
+            }
+
+            n = std::min(n, consumer.cached_tail - head);
+            for(size_t i = 0; i < n; i++) {
+                T* slot = &slots()[(head + i) & mask];
+                values[i] = std::move(*slot);
+                slot->~T();
+            }
+
+            consumer.head.store(head + n, std::memory_order_release);
+            return n;
+        }
+
+        // only exact when neither side is running
+        size_t size() { return producer.tail.load(std::memory_order_acquire) - consumer.head.load(std::memory_order_acquire); }
+        size_t capacity() { return mask + 1; }
+
+    private:
+        T* slots() { return storage.get_slots(); }
+
+    private:
+        // written by the producer and consumer respectively, kept on separate cache lines
+        struct alignas(cache_line_bytesize) {
+            std::atomic<size_t> tail = 0;
+            size_t              cached_head = 0;
+        } producer;
+
+        struct alignas(cache_line_bytesize) {
+            std::atomic<size_t> head = 0;
+            size_t              cached_tail = 0;
+        } consumer;
+
+        size_t                    mask;
+        _impl_ring_storage_t<T>   storage;
+    };
+
+    // A bounded lock free queue for any number of producers and consumers, after
+    // Dmitry Vyukov's. Every slot has a sequence number telling whether it is ready to
+    // be written or read on the current lap, so threads only contend on head or tail
+    template<typename T>
+    class mpmc_ring_t {
+    public:
+        mpmc_ring_t(size_t capacity, allocator_t<uint8_t>* allocator = nullptr, bool huge_pages = false)
+            : mask(capacity - 1), storage(capacity, allocator, huge_pages) {
+            for(size_t i = 0; i < capacity; i++) {
+                new(&slots()[i].sequence) std::atomic<size_t>(i);
+            }
+        }
+
+        ~mpmc_ring_t() {
+            for(size_t i = head_index; i != tail_index; i++) {
+                ((T*)slots()[i & mask].value)->~T();
+            }
+        }
+
+        mpmc_ring_t(const mpmc_ring_t&) = delete;
+        mpmc_ring_t& operator=(const mpmc_ring_t&) = delete;
+
+        template<typename U>
+        bool try_push(U&& value) {
+            size_t n = 1;
+            size_t tail = claim(tail_index, n, 0);
+            if(tail == SIZE_MAX)
+                return false;
+
+            publish(slots()[tail & mask], tail + 1, std::forward<U>(value));
+            return true;
+        }
+
+        // pushes as many of values as there are free slots in a row, returns how many
+        size_t try_push(const T* values, size_t n) {
+            size_t tail = claim(tail_index, n, 0);
+            if(tail == SIZE_MAX)
+                return 0;
+
+            for(size_t i = 0; i < n; i++) {
+                publish(slots()[(tail + i) & mask], tail + i + 1, values[i]);
+            }
+
+            return n;
+        }
+
+        bool try_pop(T& value) {
+            size_t n = 1;
+            size_t head = claim(head_index, n, 1);
+            if(head == SIZE_MAX)
+                return false;
+
+            take(slots()[head & mask], head + mask + 1, value);
+            return true;
+        }
+
+        // pops up to n values that are ready in a row, returns how many
+        size_t try_pop(T* values, size_t n) {
+            size_t head = claim(head_index, n, 1);
+            if(head == SIZE_MAX)
+                return 0;
+
+            for(size_t i = 0; i < n; i++) {
+                take(slots()[(head + i) & mask], head + i + mask + 1, values[i]);
+            }
+
+            return n;
+        }
+
+        size_t capacity() { return mask + 1; }
+
+    private:
+        struct slot_t {
+            std::atomic<size_t> sequence;
+            alignas(T) uint8_t  value[sizeof(T)];
+        };
+
+        slot_t* slots() { return storage.get_slots(); }
+
+        // Claims up to n slots in a row starting at index, whose sequence is index + lag
+        // when they are ready. n is set to how many were claimed, returns the first
+        // claimed index or SIZE_MAX if none were ready
+        size_t claim(std::atomic<size_t>& index, size_t& n, size_t lag) {
+            size_t position = index.load(std::memory_order_relaxed);
+
+            while(true) {
+                size_t ready = 0;
+                while(ready < n && slots()[(position + ready) & mask].sequence.load(std::memory_order_acquire) == position + ready + lag) {
+                    ready++;
+                }
+
+                if(ready == 0) {
+                    size_t sequence = slots()[position & mask].sequence.load(std::memory_order_acquire);
+
+                    // behind by a lap, the ring is full or empty
+                    if((intptr_t)(sequence - (position + lag)) < 0)
+                        return SIZE_MAX;
+
+                    // another thread moved index on, catch up
+                    position = index.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if(index.compare_exchange_weak(position, position + ready, std::memory_order_relaxed)) {
+                    n = ready;
+                    return position;
+                }
+            }
+        }
+
+        template<typename U>
+        void publish(slot_t& slot, size_t sequence, U&& value) {
+            new(slot.value)T(std::forward<U>(value));
+            slot.sequence.store(sequence, std::memory_order_release);
+        }
+
+        void take(slot_t& slot, size_t sequence, T& value) {
+            T* object = (T*)slot.value;
+
+            value = std::move(*object);
+            object->~T();
+            slot.sequence.store(sequence, std::memory_order_release);
+        }
+
+    private:
+        alignas(cache_line_bytesize) std::atomic<size_t> tail_index = 0;
+        alignas(cache_line_bytesize) std::atomic<size_t> head_index = 0;
+        alignas(cache_line_bytesize) size_t              mask;
+        _impl_ring_storage_t<slot_t>                     storage;
+    };
+}
@@ -3,22 +3,73 @@
 #include "memory_pool.hpp"
 
 namespace ptm {
+    // What the RDA knows about a registered type, enough to move and destroy
+    // values of it without knowing the type at compile time
+    struct rda_type_info_t {
+        uint32_t id;
+        size_t   bytesize;
+        size_t   alignment;
+        bool     trivially_relocatable;
+
+        // move constructs dst from src and destroys src, null if T can't be moved
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void* value);
+    };
+
     // The coolest allocator of them all!!
     // Allows a data type to be registered at runtime then a 
     // memory pool will be created for that type. If allocate
     // or deallocate is called it will then be passed down to that pool
     class rda_t { 
     public:
+        // a type registered with a sizing_name learns the size of its pool, see pool_sizing.hpp
         template<typename T>
-        bool register_type(size_t initial_max_elements) {
+        bool register_type(size_t initial_max_elements, const char* sizing_name = nullptr) {
             if(_pool_exists<T>())
                 return true;
 
-            pools[std::type_index(typeid(T))] = _impl_sparse_memory_pool_t(sizeof(T), initial_max_elements);
+            pools[std::type_index(typeid(T))] = _impl_sparse_memory_pool_t(sizeof(T), initial_max_elements, sizing_name);
+
+            rda_type_info_t info;
+            info.id                    = (uint32_t)type_infos.size();
+            info.bytesize              = sizeof(T);
+            info.alignment             = alignof(T);
+            info.trivially_relocatable = std::is_trivially_copyable_v<T>;
+            info.relocate = nullptr;
+            if constexpr(std::is_move_constructible_v<T>) {
+                info.relocate = [](void* dst, void* src) {
+                    new(dst) T(std::move(*(T*)src));
+                    ((T*)src)->~T();
+                };
+            }
+            info.destroy = [](void* value) {
+                ((T*)value)->~T();
+            };
+
+            type_ids[std::type_index(typeid(T))] = info.id;
+            type_infos.push_back(info);
 
             return true;
         }
 
+        template<typename T>
+        bool is_registered() {
+            return _pool_exists<T>();
+        }
+
+        // registered types are numbered from 0 in the order they were registered
+        template<typename T>
+        uint32_t get_type_id() {
+            assert(_pool_exists<T>());
+            return type_ids[std::type_index(typeid(T))];
+        }
+
+        const rda_type_info_t& get_type_info(uint32_t id) {
+            return type_infos[id];
+        }
+
+        size_t get_type_count() { return type_infos.size(); }
+
         template<typename T>
         T* allocate(size_t n) {
             assert(_pool_exists<T>());
@@ -66,5 +117,7 @@ namespace ptm {
         }
 
         std::map<std::type_index, _impl_sparse_memory_pool_t> pools;
+        std::map<std::type_index, uint32_t>                   type_ids;
+        std::vector<rda_type_info_t>                          type_infos;
     };
 }
\ No newline at end of file
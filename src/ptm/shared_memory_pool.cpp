@@ -0,0 +1,248 @@
+#include "shared_memory_pool.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+namespace ptm {
+    _impl_shared_memory_pool_t::_impl_shared_memory_pool_t(_impl_shared_memory_pool_t&& other) {
+        *this = std::move(other);
+    }
+
+    _impl_shared_memory_pool_t& _impl_shared_memory_pool_t::operator=(_impl_shared_memory_pool_t&& other) {
+        if(this == &other)
+            return *this;
+
+        detach();
+
+        header           = other.header;
+        fd               = other.fd;
+        owners_offset    = other.owners_offset;
+        elements_offset  = other.elements_offset;
+        mapping_bytesize = other.mapping_bytesize;
+        memory           = other.memory;
+
+        other.header = nullptr;
+        other.memory = nullptr;
+        other.fd     = -1;
+
+        return *this;
+    }
+
+    _impl_shared_memory_pool_t::~_impl_shared_memory_pool_t() {
+        detach();
+    }
+
+    void _impl_shared_memory_pool_t::compute_layout(size_t element_bytesize, size_t max_elements) {
+        // header page, flags, owner pids, then the page aligned elements
+        size_t flags_bytesize = round_up((max_elements + bits_per_word - 1) / bits_per_word * sizeof(uint64_t), (size_t)64);
+
+        owners_offset    = page_size() + flags_bytesize;
+        elements_offset  = round_up(owners_offset + max_elements * sizeof(int32_t), page_size());
+        mapping_bytesize = elements_offset + round_up(max_elements * element_bytesize, page_size());
+    }
+
+    bool _impl_shared_memory_pool_t::map(int fd, size_t bytesize) {
+        if(fd >= 0) {
+            memory = mmap(nullptr, bytesize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        } else {
+            memory = mmap(nullptr, bytesize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        }
+
+        if(memory == MAP_FAILED) {
+            memory = nullptr;
+            return false;
+        }
+
+        header = (shared_pool_header_t*)memory;
+        mapping_bytesize = bytesize;
+
+        return true;
+    }
+
+    bool _impl_shared_memory_pool_t::create(const char* name, size_t element_bytesize, size_t max_elements) {
+        detach();
+
+        if(element_bytesize == 0 || max_elements == 0)
+            return false;
+
+        compute_layout(element_bytesize, max_elements);
+
+        if(name) {
+            fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        } else {
+#ifdef __linux__
+            fd = memfd_create("portem_shared_pool", MFD_CLOEXEC);
+#endif
+        }
+
+        if((name || fd >= 0) && (fd < 0 || ftruncate(fd, mapping_bytesize) != 0)) {
+            detach();
+            return false;
+        }
+
+        if(!map(fd, mapping_bytesize)) {
+            detach();
+            return false;
+        }
+
+        // the memory is zero, which is already a valid empty pool, only the header
+        // needs filling in. Attaching processes ignore it until it is marked ready
+        header->magic            = shared_pool_header_t::magic_value;
+        header->version          = shared_pool_header_t::version_value;
+        header->element_bytesize = element_bytesize;
+        header->max_elements     = max_elements;
+        header->checksum         = header->compute_checksum();
+        header->next_word.store(0, std::memory_order_relaxed);
+        header->state.store(shared_pool_header_t::ready, std::memory_order_release);
+
+        return true;
+    }
+
+    bool _impl_shared_memory_pool_t::attach(const char* name) {
+        int named_fd = shm_open(name, O_RDWR, 0);
+        if(named_fd < 0)
+            return false;
+
+        bool attached = attach_fd(named_fd);
+        ::close(named_fd);
+
+        return attached;
+    }
+
+    bool _impl_shared_memory_pool_t::attach_fd(int other_fd) {
+        detach();
+
+        fd = dup(other_fd);
+        if(fd < 0)
+            return false;
+
+        struct stat info;
+        if(fstat(fd, &info) != 0 || (size_t)info.st_size < page_size() || !map(fd, info.st_size)) {
+            detach();
+            return false;
+        }
+
+        // a creator that crashed half way leaves a header that is not ready or does not add up
+        if(header->state.load(std::memory_order_acquire) != shared_pool_header_t::ready ||
+           header->magic != shared_pool_header_t::magic_value ||
+           header->version != shared_pool_header_t::version_value ||
+           header->checksum != header->compute_checksum()) {
+            detach();
+            return false;
+        }
+
+        size_t file_bytesize = mapping_bytesize;
+        compute_layout(header->element_bytesize, header->max_elements);
+
+        if(mapping_bytesize > file_bytesize) {
+            mapping_bytesize = file_bytesize;
+            detach();
+            return false;
+        }
+
+        mapping_bytesize = file_bytesize;
+
+        return true;
+    }
+
+    void _impl_shared_memory_pool_t::detach() {
+        if(memory)
+            munmap(memory, mapping_bytesize);
+        if(fd >= 0)
+            ::close(fd);
+
+        header = nullptr;
+        memory = nullptr;
+        fd     = -1;
+    }
+
+    void _impl_shared_memory_pool_t::unlink(const char* name) {
+        shm_unlink(name);
+    }
+
+    void _impl_shared_memory_pool_t::set_owner(size_t index, size_t n, int32_t pid) {
+        for(size_t i = index; i < index + n; i++) {
+            _owners()[i].store(pid, std::memory_order_relaxed);
+        }
+    }
+
+    shm_handle_t _impl_shared_memory_pool_t::allocate(size_t n) {
+        assert(n >= 1 && n <= bits_per_word);
+
+        const uint64_t mask  = n == bits_per_word ? UINT64_MAX : ((uint64_t)1 << n) - 1;
+        const size_t   words = word_count();
+        const size_t   first = header->next_word.load(std::memory_order_relaxed) % words;
+
+        for(size_t i = 0; i < words; i++) {
+            size_t w     = (first + i) % words;
+            size_t limit = std::min(bits_per_word, (size_t)header->max_elements - w * bits_per_word);
+
+            uint64_t word = _flags()[w].load(std::memory_order_relaxed);
+
+            for(size_t bit = 0; bit + n <= limit;) {
+                if(word == UINT64_MAX)
+                    break;
+
+                if((word >> bit) & mask) {
+                    bit++;
+                    continue;
+                }
+
+                // another process may have taken bits of this word, if so look at it again
+                if(!_flags()[w].compare_exchange_weak(word, word | (mask << bit), std::memory_order_acquire, std::memory_order_relaxed)) {
+                    bit = 0;
+                    continue;
+                }
+
+                size_t index = w * bits_per_word + bit;
+
+                set_owner(index, n, (int32_t)getpid());
+                header->next_word.store(w, std::memory_order_relaxed);
+
+                return (shm_handle_t)(index * header->element_bytesize);
+            }
+        }
+
+        return null_shm_handle;
+    }
+
+    void _impl_shared_memory_pool_t::deallocate(shm_handle_t handle, size_t n) {
+        assert(n >= 1 && n <= bits_per_word);
+
+        const uint64_t mask  = n == bits_per_word ? UINT64_MAX : ((uint64_t)1 << n) - 1;
+        const size_t   index = handle / header->element_bytesize;
+
+        set_owner(index, n, 0);
+
+        uint64_t previous = _flags()[index / bits_per_word].fetch_and(~(mask << (index % bits_per_word)), std::memory_order_release);
+        assert((previous & (mask << (index % bits_per_word))) == (mask << (index % bits_per_word)));
+        (void)previous;
+    }
+
+    void _impl_shared_memory_pool_t::adopt(shm_handle_t handle, size_t n) {
+        set_owner(handle / header->element_bytesize, n, (int32_t)getpid());
+    }
+
+    size_t _impl_shared_memory_pool_t::reclaim_dead_owners() {
+        size_t reclaimed = 0;
+
+        for(size_t i = 0; i < header->max_elements; i++) {
+            int32_t pid = _owners()[i].load(std::memory_order_relaxed);
+
+            if(pid == 0 || kill(pid, 0) == 0 || errno != ESRCH)
+                continue;
+
+            // only one process gets to free it
+            if(!_owners()[i].compare_exchange_strong(pid, 0, std::memory_order_relaxed))
+                continue;
+
+            _flags()[i / bits_per_word].fetch_and(~((uint64_t)1 << (i % bits_per_word)), std::memory_order_release);
+            reclaimed++;
+        }
+
+        return reclaimed;
+    }
+}
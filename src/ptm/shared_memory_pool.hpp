@@ -0,0 +1,125 @@
+#pragma once
+
+#include "memory_pool.hpp"
+#include "virtual_memory.hpp"
+#include <atomic>
+
+namespace ptm {
+    // refers to elements of a shared pool, valid in every process that maps the pool
+    typedef uint64_t shm_handle_t;
+    constexpr shm_handle_t null_shm_handle = UINT64_MAX;
+
+    struct shared_pool_header_t {
+        static constexpr uint64_t magic_value   = 0x6d68737f'6d747028; // "(ptm\x7fshm"
+        static constexpr uint32_t version_value = 1;
+
+        enum state_t : uint32_t {
+            initializing = 0,
+            ready        = 1
+        };
+
+        uint64_t              magic;
+        uint32_t              version;
+        std::atomic<uint32_t> state;
+        uint64_t              element_bytesize;
+        uint64_t              max_elements;
+        uint64_t              checksum; // of the fields above, a torn header won't match
+        std::atomic<uint64_t> next_word; // where the next search starts
+
+        uint64_t compute_checksum() const {
+            return (magic ^ (element_bytesize * 0x9e3779b97f4a7c15) ^ (max_elements * 0xc2b2ae3d27d4eb4f)) + version;
+        }
+    };
+
+    // A fixed size pool in shared memory that several processes can map at once.
+    // Allocation only uses atomic operations on the flags, so no process can leave the
+    // pool locked by crashing. Every element records the pid of the process that owns
+    // it, reclaim_dead_owners() frees the elements of processes that have exited.
+    // Memory may be mapped at a different address in every process, pass shm_handle_t
+    // between processes and keep pointers inside elements relative
+    class _impl_shared_memory_pool_t {
+    public:
+        _impl_shared_memory_pool_t() {}
+        _impl_shared_memory_pool_t(_impl_shared_memory_pool_t&& other);
+        _impl_shared_memory_pool_t& operator=(_impl_shared_memory_pool_t&& other);
+        ~_impl_shared_memory_pool_t();
+
+        // Creates a pool. If name is nullptr the pool is anonymous, it is inherited
+        // through fork() or can be passed on with get_fd(). Otherwise it is a
+        // POSIX shared memory object other processes can attach() to by name
+        bool create(const char* name, size_t element_bytesize, size_t max_elements);
+        bool attach(const char* name);
+        bool attach_fd(int fd);
+        void detach();
+
+        // removes a named pool, processes that have it mapped keep it
+        static void unlink(const char* name);
+
+        bool valid() { return (uint8_t*)memory; }
+        int  get_fd() { return fd; }
+
+        // n may be at most 64 elements
+        shm_handle_t allocate(size_t n);
+        void deallocate(shm_handle_t handle, size_t n);
+
+        // makes the calling process the owner of elements another process allocated
+        void adopt(shm_handle_t handle, size_t n);
+
+        // frees every element owned by a process that no longer exists, returns how many
+        size_t reclaim_dead_owners();
+
+        void* get(shm_handle_t handle) { return handle == null_shm_handle ? nullptr : inc_by_byte(_elements(), handle); }
+        shm_handle_t handle_of(void* element) { return element ? (shm_handle_t)((uint8_t*)element - _elements()) : null_shm_handle; }
+
+        size_t get_max_elements() { return header->max_elements; }
+
+    private:
+        static constexpr size_t bits_per_word = 64;
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<int32_t>::is_always_lock_free,
+                      "atomics in shared memory must be lock free");
+
+        bool map(int fd, size_t bytesize);
+        void compute_layout(size_t element_bytesize, size_t max_elements);
+        void set_owner(size_t index, size_t n, int32_t pid);
+
+        size_t word_count() { return (header->max_elements + bits_per_word - 1) / bits_per_word; }
+        std::atomic<uint64_t>* _flags() { return (std::atomic<uint64_t>*)inc_by_byte((uint8_t*)memory, page_size()); }
+        std::atomic<int32_t>* _owners() { return (std::atomic<int32_t>*)inc_by_byte((uint8_t*)memory, owners_offset); }
+        uint8_t* _elements() { return inc_by_byte((uint8_t*)memory, elements_offset); }
+
+    private:
+        shared_pool_header_t* header = nullptr;
+
+        int    fd               = -1;
+        size_t owners_offset    = 0;
+        size_t elements_offset  = 0;
+        size_t mapping_bytesize = 0;
+        void*  memory           = nullptr;
+    };
+
+    // T must be trivially copyable, it is shared between processes as plain bytes
+    template<typename T>
+    class shared_object_pool_t {
+        static_assert(std::is_trivially_copyable_v<T>, "objects in shared memory must be trivially copyable");
+
+    public:
+        bool create(const char* name, size_t max_elements) { return pool.create(name, sizeof(T), max_elements); }
+        bool attach(const char* name) { return pool.attach(name); }
+        bool attach_fd(int fd) { return pool.attach_fd(fd); }
+
+        bool valid() { return pool.valid(); }
+        int  get_fd() { return pool.get_fd(); }
+
+        T* allocate(size_t n = 1) { return (T*)pool.get(pool.allocate(n)); }
+        void deallocate(T* elements, size_t n = 1) { pool.deallocate(pool.handle_of(elements), n); }
+        void adopt(T* elements, size_t n = 1) { pool.adopt(pool.handle_of(elements), n); }
+        size_t reclaim_dead_owners() { return pool.reclaim_dead_owners(); }
+
+        T* get(shm_handle_t handle) { return (T*)pool.get(handle); }
+        shm_handle_t handle_of(T* elements) { return pool.handle_of(elements); }
+
+    private:
+        _impl_shared_memory_pool_t pool;
+    };
+}
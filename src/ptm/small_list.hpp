@@ -1,79 +1,363 @@
 #pragma once
 
 #include "base.hpp"
+#include "allocator.hpp"
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
 
 namespace ptm {
-    // a list for holding simple data types or structs
-    // use only trivial objects
+    // A vector that keeps up to max elements inside itself and only allocates
+    // once it holds more. The inline storage is left uninitialized until it is used,
+    // spilling moves the elements over and heap storage grows geometrically. Any type
+    // std::vector takes works, trivially copyable ones are moved with memcpy. Heap
+    // storage comes from allocator, which can be a memory_pool_t or any other
+    // allocator_t. Iterators are plain pointers and are invalidated like std::vector's,
+    // and also by moving the list while it is inline
     template<typename T, size_t max = 128>
     class small_list_t {
-        using stack_buffer_t = std::array<T, max>;
-        using heap_buffer_t  = std::vector<T>;
+        static_assert(max > 0, "a small list needs room for at least one element inline");
 
     public:
-        small_list_t() {} // variants by default, construct the first alternative
-
-        void emplace_back(const T& element) {
-            if(use_heap) {
-                heap_buffer().emplace_back(element);
-            } else if(count + 1 > max) {
-                // copy the contents of the stack buffer over 
-                // to a new heap buffer
-                std::vector<T> new_buffer = {};
-                // reserve enough space for all previous elements
-                // and the new one
-                new_buffer.reserve(max + 1);
-                new_buffer.insert(new_buffer.begin(), stack_buffer().begin(), stack_buffer().end());
-                
-                // set the variant as a heap buffer
-                use_heap = true; 
-                buffer.template emplace<1>(new_buffer);
-                heap_buffer().emplace_back(element);
-            } else {
-                stack_buffer()[count] = std::move(element);
+        using value_type             = T;
+        using size_type              = size_t;
+        using difference_type        = ptrdiff_t;
+        using reference              = T&;
+        using const_reference        = const T&;
+        using pointer                = T*;
+        using const_pointer          = const T*;
+        using iterator               = T*;
+        using const_iterator         = const T*;
+        using reverse_iterator       = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        static constexpr size_t inline_capacity = max;
+
+        small_list_t(allocator_t<T>* allocator = nullptr)
+            : allocator(allocator ? allocator : &default_allocator) {}
+
+        small_list_t(size_t n, const T& value, allocator_t<T>* allocator = nullptr)
+            : small_list_t(allocator) {
+            insert(end(), n, value);
+        }
+
+        small_list_t(std::initializer_list<T> values, allocator_t<T>* allocator = nullptr)
+            : small_list_t(allocator) {
+            insert(end(), values.begin(), values.end());
+        }
+
+        small_list_t(const small_list_t& other)
+            : small_list_t(other.allocator) {
+            insert(end(), other.begin(), other.end());
+        }
+
+        small_list_t(small_list_t&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+            : small_list_t(other.allocator) {
+            take(other);
+        }
+
+        small_list_t& operator=(const small_list_t& other) {
+            if(this != &other) {
+                clear();
+                insert(end(), other.begin(), other.end());
             }
 
-            // cant forget this
-            count++;
+            return *this;
         }
 
-        T pop_back() {
-            T last_element;
-         
-            if(use_heap) {
-                last_element = heap_buffer().back();
-                heap_buffer().pop_back();
-            } else {
-                last_element = stack_buffer()[count - 1];
+        small_list_t& operator=(small_list_t&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if(this != &other) {
+                clear();
+                release();
+
+                allocator = other.allocator;
+                take(other);
             }
 
-            count--;
+            return *this;
+        }
 
-            return last_element;
+        ~small_list_t() {
+            clear();
+            release();
         }
 
+        iterator begin() { return elements; }
+        iterator end() { return elements + count; }
+        const_iterator begin() const { return elements; }
+        const_iterator end() const { return elements + count; }
+        const_iterator cbegin() const { return elements; }
+        const_iterator cend() const { return elements + count; }
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        T* data() { return elements; }
+        const T* data() const { return elements; }
+
+        size_t size() const { return count; }
+        size_t capacity() const { return max_count; }
+        bool empty() const { return count == 0; }
+
+        // true while the elements are stored inside the list itself
+        bool is_inline() const { return elements == inline_elements(); }
+
         T& operator[](size_t i) {
             assert(i < count);
+            return elements[i];
+        }
 
-            if(use_heap)
-                return heap_buffer()[i];
-            else 
-                return stack_buffer()[i];
+        const T& operator[](size_t i) const {
+            assert(i < count);
+            return elements[i];
         }
 
-        size_t size() {
-            return count;
+        T& front() { return (*this)[0]; }
+        T& back() { return (*this)[count - 1]; }
+        const T& front() const { return (*this)[0]; }
+        const T& back() const { return (*this)[count - 1]; }
+
+        template<typename ... params>
+        T& emplace_back(params&& ... args) {
+            if(count == max_count) {
+                // construct the new element first, args may refer to an element of this list
+                size_t new_capacity = grown_capacity(count + 1);
+                T*     new_elements = allocate(new_capacity);
+
+                new(&new_elements[count]) T(std::forward<params>(args)...);
+                replace_storage(new_elements, new_capacity);
+            } else {
+                new(&elements[count]) T(std::forward<params>(args)...);
+            }
+
+            return elements[count++];
+        }
+
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        void pop_back() {
+            assert(count > 0);
+            elements[--count].~T();
+        }
+
+        // inserts an element constructed from args before position
+        template<typename ... params>
+        iterator emplace(const_iterator position, params&& ... args) {
+            size_t index = position - begin();
+
+            if(index == count) {
+                emplace_back(std::forward<params>(args)...);
+            } else {
+                // args may refer to an element that is about to move
+                T value(std::forward<params>(args)...);
+
+                open_gap(index, 1);
+                new(&elements[index]) T(std::move(value));
+            }
+
+            return begin() + index;
+        }
+
+        iterator insert(const_iterator position, const T& value) { return emplace(position, value); }
+        iterator insert(const_iterator position, T&& value) { return emplace(position, std::move(value)); }
+
+        iterator insert(const_iterator position, size_t n, const T& value) {
+            size_t index = position - begin();
+            if(n == 0)
+                return begin() + index;
+
+            T copy(value);
+
+            open_gap(index, n);
+            std::uninitialized_fill_n(elements + index, n, copy);
+
+            return begin() + index;
+        }
+
+        // the range must not be part of this list
+        template<typename iterator_t, typename = typename std::iterator_traits<iterator_t>::iterator_category>
+        iterator insert(const_iterator position, iterator_t first, iterator_t last) {
+            size_t index = position - begin();
+            size_t n     = std::distance(first, last);
+            if(n == 0)
+                return begin() + index;
+
+            open_gap(index, n);
+            std::uninitialized_copy(first, last, elements + index);
+
+            return begin() + index;
+        }
+
+        iterator insert(const_iterator position, std::initializer_list<T> values) {
+            return insert(position, values.begin(), values.end());
+        }
+
+        iterator erase(const_iterator position) {
+            return erase(position, position + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last) {
+            size_t index = first - begin();
+            size_t n     = last - first;
+
+            std::destroy(elements + index, elements + index + n);
+            relocate(elements + index, elements + index + n, count - index - n);
+            count -= n;
+
+            return begin() + index;
+        }
+
+        void clear() {
+            std::destroy(elements, elements + count);
+            count = 0;
+        }
+
+        // makes room for n elements, never shrinks
+        void reserve(size_t n) {
+            if(n > max_count)
+                replace_storage(allocate(n), n);
+        }
+
+        void resize(size_t n) {
+            resize_with(n, [](T* element) { new(element) T(); });
+        }
+
+        void resize(size_t n, const T& value) {
+            T copy(value);
+            resize_with(n, [&](T* element) { new(element) T(copy); });
+        }
+
+        // gives back heap storage that is not needed, moving the elements inline if they fit
+        void shrink_to_fit() {
+            if(is_inline() || count == max_count)
+                return;
+
+            if(count <= max) {
+                T* heap = elements;
+                relocate(inline_elements(), heap, count);
+                deallocate(heap, max_count);
+
+                elements  = inline_elements();
+                max_count = max;
+            } else {
+                replace_storage(allocate(count), count);
+            }
+        }
+
+        allocator_t<T>* get_allocator() const { return allocator; }
+
+        bool operator==(const small_list_t& other) const {
+            return count == other.count && std::equal(begin(), end(), other.begin());
+        }
+
+        bool operator!=(const small_list_t& other) const { return !(*this == other); }
+
+    private:
+        T* inline_elements() { return (T*)inline_buffer; }
+        const T* inline_elements() const { return (const T*)inline_buffer; }
+
+        T* allocate(size_t n) { return allocator->allocate(n); }
+        void deallocate(T* ptr, size_t n) { allocator->deallocate(ptr, n); }
+
+        size_t grown_capacity(size_t needed) const {
+            return std::max(needed, (size_t)max_count * 2);
+        }
+
+        // moves n elements from src to dst and ends their lifetime at src. Works for
+        // overlapping ranges when dst is before src or after all of it
+        static void relocate(T* dst, T* src, size_t n) {
+            if constexpr(std::is_trivially_copyable_v<T>) {
+                if(n)
+                    memmove((void*)dst, (void*)src, n * sizeof(T));
+            } else if(dst < src) {
+                for(size_t i = 0; i < n; i++) {
+                    new(&dst[i]) T(std::move(src[i]));
+                    src[i].~T();
+                }
+            } else {
+                for(size_t i = n; i > 0; i--) {
+                    new(&dst[i - 1]) T(std::move(src[i - 1]));
+                    src[i - 1].~T();
+                }
+            }
+        }
+
+        // moves the elements to new_elements, which holds new_capacity of them
+        void replace_storage(T* new_elements, size_t new_capacity) {
+            relocate(new_elements, elements, count);
+            release();
+
+            elements  = new_elements;
+            max_count = (uint32_t)new_capacity;
+        }
+
+        // gives back the heap storage, if any
+        void release() {
+            if(!is_inline())
+                deallocate(elements, max_count);
+
+            elements  = inline_elements();
+            max_count = max;
+        }
+
+        // leaves [index, index + n) uninitialized, moving the elements after it back
+        void open_gap(size_t index, size_t n) {
+            if(count + n > max_count) {
+                size_t new_capacity = grown_capacity(count + n);
+                T*     new_elements = allocate(new_capacity);
+
+                relocate(new_elements, elements, index);
+                relocate(new_elements + index + n, elements + index, count - index);
+                release();
+
+                elements  = new_elements;
+                max_count = (uint32_t)new_capacity;
+            } else {
+                relocate(elements + index + n, elements + index, count - index);
+            }
+
+            count += n;
+        }
+
+        template<typename construct_t>
+        void resize_with(size_t n, construct_t&& construct) {
+            if(n < count) {
+                std::destroy(elements + n, elements + count);
+            } else {
+                reserve(n);
+                for(size_t i = count; i < n; i++)
+                    construct(&elements[i]);
+            }
+
+            count = (uint32_t)n;
+        }
+
+        // takes the elements of other, leaving it empty and inline
+        void take(small_list_t& other) {
+            if(other.is_inline()) {
+                relocate(inline_elements(), other.inline_elements(), other.count);
+            } else {
+                elements  = other.elements;
+                max_count = other.max_count;
+
+                other.elements  = other.inline_elements();
+                other.max_count = max;
+            }
+
+            count = other.count;
+            other.count = 0;
         }
 
     private:
-        stack_buffer_t& stack_buffer() { return std::get<0>(buffer); }
-        heap_buffer_t& heap_buffer() { return std::get<1>(buffer); }
+        static inline allocator_t<T> default_allocator;
 
-        uint32_t count    = 0;
-        bool     use_heap = false;
+        T*              elements  = inline_elements();
+        uint32_t        count     = 0;
+        uint32_t        max_count = max;
+        allocator_t<T>* allocator;
 
-        // an index into the variant that points
-        // to either the stack based array or the vector
-        std::variant<stack_buffer_t, heap_buffer_t> buffer;
+        alignas(T) uint8_t inline_buffer[max * sizeof(T)];
     };
-}
\ No newline at end of file
+}
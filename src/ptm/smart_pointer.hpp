@@ -0,0 +1,221 @@
+#pragma once
+
+#include "memory_pool.hpp"
+#include <atomic>
+
+namespace ptm {
+    // Gives an object back to the pool it was created in
+    template<typename T, typename pool_t = object_pool_t<T>>
+    struct pool_deleter_t {
+        pool_t* pool = nullptr;
+
+        void operator()(T* object) const {
+            pool->destroy(object, 1);
+        }
+    };
+
+    // One pool per T and tag_t that lives as long as the program
+    template<typename T, typename tag_t = T>
+    object_pool_t<T>& global_object_pool() {
+        static object_pool_t<T> pool;
+        return pool;
+    }
+
+    // Gives an object back to global_object_pool<T, tag_t>(), it has no state so
+    // a pool_unique_ptr using it is as big as a raw pointer
+    template<typename T, typename tag_t = T>
+    struct global_pool_deleter_t {
+        void operator()(T* object) const {
+            global_object_pool<T, tag_t>().destroy(object, 1);
+        }
+    };
+
+    template<typename T, typename deleter_t = pool_deleter_t<T>>
+    using pool_unique_ptr = std::unique_ptr<T, deleter_t>;
+
+    template<typename T, typename ... params>
+    pool_unique_ptr<T> make_pool_unique(object_pool_t<T>& pool, params&& ... args) {
+        return pool_unique_ptr<T>(pool.create(1, std::forward<params>(args)...), pool_deleter_t<T>{&pool});
+    }
+
+    template<typename T, typename tag_t = T, typename ... params>
+    pool_unique_ptr<T, global_pool_deleter_t<T, tag_t>> make_global_pool_unique(params&& ... args) {
+        return pool_unique_ptr<T, global_pool_deleter_t<T, tag_t>>(global_object_pool<T, tag_t>().create(1, std::forward<params>(args)...));
+    }
+
+    // Slots for std::shared_ptr control blocks with their object inside. The size of
+    // a control block is only known once std::allocate_shared asks for one, so the
+    // pool is made on the first allocation. It must outlive every pointer made from it
+    template<typename T>
+    class shared_ptr_pool_t {
+    public:
+        shared_ptr_pool_t(size_t initial_max_elements = 100)
+            : initial_max_elements(initial_max_elements) {}
+
+        void* allocate(size_t bytesize) {
+            if(pool.get_bytesize_of_element() == SIZE_MAX) {
+                pool = _impl_sparse_memory_pool_t(bytesize, initial_max_elements);
+            }
+
+            assert(pool.get_bytesize_of_element() == bytesize);
+            return pool.allocate(1);
+        }
+
+        void deallocate(void* block) {
+            pool.deallocate(block, 1);
+        }
+
+    private:
+        size_t                     initial_max_elements;
+        _impl_sparse_memory_pool_t pool;
+    };
+
+    // The allocator std::allocate_shared rebinds to its control block type
+    template<typename T, typename pooled_t>
+    struct _impl_shared_ptr_allocator_t {
+        using value_type = T;
+
+        shared_ptr_pool_t<pooled_t>* pool;
+
+        _impl_shared_ptr_allocator_t(shared_ptr_pool_t<pooled_t>* pool)
+            : pool(pool) {}
+
+        template<typename U>
+        _impl_shared_ptr_allocator_t(const _impl_shared_ptr_allocator_t<U, pooled_t>& other)
+            : pool(other.pool) {}
+
+        T* allocate(size_t n) {
+            assert(n == 1);
+            return (T*)pool->allocate(sizeof(T));
+        }
+
+        void deallocate(T* ptr, size_t n) {
+            pool->deallocate(ptr);
+        }
+
+        template<typename U>
+        bool operator==(const _impl_shared_ptr_allocator_t<U, pooled_t>& other) const { return pool == other.pool; }
+    };
+
+    // Like std::make_shared, but the control block and the object share one slot in pool
+    template<typename T, typename ... params>
+    std::shared_ptr<T> allocate_shared_in(shared_ptr_pool_t<T>& pool, params&& ... args) {
+        return std::allocate_shared<T>(_impl_shared_ptr_allocator_t<T, T>(&pool), std::forward<params>(args)...);
+    }
+
+    template<typename T>
+    class intrusive_ptr_t;
+
+    // Base for objects that count their own references, with the pool they came
+    // from next to the count. Use with make_intrusive_in and intrusive_ptr_t. Objects
+    // that are never shared between threads can skip the atomics with thread_safe
+    template<typename T, bool thread_safe = true>
+    class ref_counted_t {
+    public:
+        using ref_counted_base_t = ref_counted_t;
+        using count_t = std::conditional_t<thread_safe, std::atomic<uint32_t>, uint32_t>;
+
+        ref_counted_t() {}
+
+        // a copy is a different object, it keeps its own count and pool
+        ref_counted_t(const ref_counted_t&) {}
+        ref_counted_t& operator=(const ref_counted_t&) { return *this; }
+
+        uint32_t get_reference_count() const { return references; }
+
+    private:
+        template<typename U>
+        friend class intrusive_ptr_t;
+
+        template<typename U, typename ... params>
+        friend intrusive_ptr_t<U> make_intrusive_in(object_pool_t<U>& pool, params&& ... args);
+
+        void acquire() {
+            if constexpr(thread_safe) {
+                references.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                references++;
+            }
+        }
+
+        // returns true when the last reference was released
+        bool release() {
+            if constexpr(thread_safe) {
+                // acq_rel so the last owner sees every other owner's writes
+                return references.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            } else {
+                return --references == 0;
+            }
+        }
+
+        count_t           references = 0;
+        object_pool_t<T>* pool = nullptr;
+    };
+
+    // A shared pointer the size of a raw pointer, the count lives in the object
+    template<typename T>
+    class intrusive_ptr_t {
+    public:
+        intrusive_ptr_t() {}
+
+        explicit intrusive_ptr_t(T* object)
+            : object(object) {
+            acquire();
+        }
+
+        intrusive_ptr_t(const intrusive_ptr_t& other)
+            : object(other.object) {
+            acquire();
+        }
+
+        intrusive_ptr_t(intrusive_ptr_t&& other)
+            : object(other.object) {
+            other.object = nullptr;
+        }
+
+        ~intrusive_ptr_t() {
+            release();
+        }
+
+        intrusive_ptr_t& operator=(intrusive_ptr_t other) {
+            std::swap(object, other.object);
+            return *this;
+        }
+
+        void reset() {
+            release();
+            object = nullptr;
+        }
+
+        T* get() const { return object; }
+        T& operator*() const { return *object; }
+        T* operator->() const { return object; }
+        explicit operator bool() const { return object != nullptr; }
+
+    private:
+        using base_t = typename T::ref_counted_base_t;
+
+        void acquire() {
+            if(object)
+                object->base_t::acquire();
+        }
+
+        void release() {
+            if(object && object->base_t::release())
+                object->base_t::pool->destroy(object, 1);
+        }
+
+    private:
+        T* object = nullptr;
+    };
+
+    template<typename T, typename ... params>
+    intrusive_ptr_t<T> make_intrusive_in(object_pool_t<T>& pool, params&& ... args) {
+        T* object = pool.create(1, std::forward<params>(args)...);
+        if(!object)
+            return intrusive_ptr_t<T>();
+
+        object->T::ref_counted_base_t::pool = &pool;
+        return intrusive_ptr_t<T>(object);
+    }
+}
@@ -1,15 +1,24 @@
 #pragma once
 
 #include "pointer.hpp"
+#include "heap_profiler.hpp"
+#include "virtual_memory.hpp"
 
 namespace ptm {
     struct stack_block_info_t {
         std::function<void()> deconstruct; // calls the deconstructor
         stack_block_info_t*   prev = nullptr; // the previous block
+        bool                  sampled = false; // by the heap profiler
     };
 
+    // Objects are pushed on top of each other and popped in reverse. It also has the
+    // raw allocate, deallocate and owns of composable_allocator.hpp, those bytes are
+    // aligned to alignment and only the newest can be given back before a pop or
+    // reset. Popping a block gives back everything allocated after it too
     class stack_allocator_t {
     public:
+        static constexpr size_t default_alignment = 16;
+
         stack_allocator_t(size_t max_size = 4096) {
             memory = (uint8_t*)malloc(max_size);
             last   = nullptr;
@@ -17,8 +26,50 @@ namespace ptm {
             this->max_size = max_size;
         }
 
+        // Uses memory owned by the caller instead of allocating it, which must be
+        // aligned to alignment
+        stack_allocator_t(void* memory, size_t max_size, size_t alignment = default_alignment) {
+            this->memory    = (uint8_t*)memory;
+            last            = nullptr;
+            count           = 0;
+            this->max_size  = max_size;
+            this->alignment = alignment;
+            owns_memory     = false;
+        }
+
         ~stack_allocator_t() {
             while(pop());
+
+            if(owns_memory)
+                free(memory);
+        }
+
+        stack_allocator_t(const stack_allocator_t&) = delete;
+        stack_allocator_t& operator=(const stack_allocator_t&) = delete;
+
+        // bytesize raw bytes, nullptr if they don't fit. They are not reported to the heap profiler
+        void* allocate(size_t bytesize) {
+            size_t begin = round_up(count, alignment);
+            if(begin + bytesize > max_size) {
+                return nullptr;
+            }
+
+            count = begin + bytesize;
+            return memory + begin;
+        }
+
+        // gives the bytes back if they are the newest, anything else stays until a pop or reset
+        void deallocate(void* ptr, size_t bytesize) {
+            if((uint8_t*)ptr + bytesize == memory + count)
+                count = (uint8_t*)ptr - memory;
+        }
+
+        bool owns(const void* ptr) { return memory <= (uint8_t*)ptr && (uint8_t*)ptr < memory + max_size; }
+
+        // pops every block and gives back every raw allocation
+        void reset() {
+            while(pop());
+            count = 0;
         }
 
         template<typename T, typename ... params> 
@@ -27,12 +78,13 @@ namespace ptm {
             const size_t total_size = sizeof(block_t);
             block_t*     block      = nullptr;
 
-            if(max_size <= count + total_size) {
+            size_t begin = round_up(count, alignof(block_t));
+            if(max_size <= begin + total_size) {
                 return nullptr;
             }
 
-            block = (block_t*)(memory + count);
-            count += total_size;
+            block = (block_t*)(memory + begin);
+            count = begin + total_size;
 
             // std::function in stack_block_info_t has a constructor
             new(&block->first)stack_block_info_t();
@@ -46,6 +98,7 @@ namespace ptm {
 
             new(&block->second)T(args...);
 
+            block->first.sampled = heap_profiler_on_allocate(block, total_size);
             return ptr_t(&block->second);
         }
 
@@ -55,8 +108,16 @@ namespace ptm {
                 return false;
             }
 
+            if(last->sampled)
+                heap_profiler_on_deallocate(last);
+
             last->deconstruct();
-            last = last->prev;
+
+            stack_block_info_t* prev = last->prev;
+            last->~stack_block_info_t();
+
+            count = (uint8_t*)last - memory;
+            last  = prev;
 
             return true;
         }
@@ -65,6 +126,8 @@ namespace ptm {
         uint8_t* memory;
         size_t   count; // the amount bytes in use 
         size_t   max_size;
+        size_t   alignment   = default_alignment;
+        bool     owns_memory = true;
         stack_block_info_t* last;
     };
 }
\ No newline at end of file
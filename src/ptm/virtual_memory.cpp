@@ -0,0 +1,104 @@
+#include "virtual_memory.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ptm {
+    size_t page_size() {
+        static const size_t bytesize = []() -> size_t {
+#ifdef _WIN32
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+#else
+            return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+        }();
+
+        return bytesize;
+    }
+
+    void* reserve_virtual_memory(size_t bytesize) {
+#ifdef _WIN32
+        return VirtualAlloc(nullptr, bytesize, MEM_RESERVE, PAGE_NOACCESS);
+#else
+        void* memory = mmap(nullptr, bytesize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        return memory == MAP_FAILED ? nullptr : memory;
+#endif
+    }
+
+    bool commit_virtual_memory(void* ptr, size_t bytesize) {
+#ifdef _WIN32
+        return VirtualAlloc(ptr, bytesize, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+        return mprotect(ptr, bytesize, PROT_READ | PROT_WRITE) == 0;
+#endif
+    }
+
+    void decommit_virtual_memory(void* ptr, size_t bytesize) {
+#ifdef _WIN32
+        VirtualFree(ptr, bytesize, MEM_DECOMMIT);
+#else
+        // replacing the mapping drops the pages and makes the range inaccessible again
+        mmap(ptr, bytesize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+    }
+
+    void* map_virtual_memory(size_t bytesize) {
+#ifdef _WIN32
+        return VirtualAlloc(nullptr, bytesize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+        void* memory = mmap(nullptr, bytesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        return memory == MAP_FAILED ? nullptr : memory;
+#endif
+    }
+
+    size_t huge_page_size() {
+#ifdef _WIN32
+        size_t bytesize = GetLargePageMinimum();
+        return bytesize ? bytesize : page_size();
+#else
+        return 2 * 1024 * 1024;
+#endif
+    }
+
+    void* map_huge_virtual_memory(size_t bytesize) {
+        assert(bytesize % huge_page_size() == 0);
+
+#ifdef _WIN32
+        // large pages need SeLockMemoryPrivilege, without it this fails
+        void* memory = VirtualAlloc(nullptr, bytesize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        return memory ? memory : map_virtual_memory(bytesize);
+#else
+        void* memory = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+        memory = mmap(nullptr, bytesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(memory != MAP_FAILED)
+            return memory;
+#endif
+
+        memory = map_virtual_memory(bytesize);
+#ifdef MADV_HUGEPAGE
+        if(memory)
+            madvise(memory, bytesize, MADV_HUGEPAGE);
+#endif
+
+        return memory;
+#endif
+    }
+
+    void release_virtual_memory(void* ptr, size_t bytesize) {
+#ifdef _WIN32
+        VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+        munmap(ptr, bytesize);
+#endif
+    }
+}
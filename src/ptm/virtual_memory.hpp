@@ -0,0 +1,38 @@
+#pragma once
+
+#include "base.hpp"
+
+namespace ptm {
+    template<typename int_t>
+    constexpr int_t round_up(int_t value, int_t multiple) {
+        return ((value + multiple - 1) / multiple) * multiple;
+    }
+
+    // size in bytes of a single page of virtual memory
+    size_t page_size();
+
+    // Reserves a range of address space without backing it with memory,
+    // any access before it is committed will fault. Returns nullptr on failure
+    void* reserve_virtual_memory(size_t bytesize);
+
+    // Backs a page aligned part of a reserved range with readable and writable
+    // memory. Newly committed memory is always zero. Returns true on success
+    bool commit_virtual_memory(void* ptr, size_t bytesize);
+
+    // Gives the memory of a committed range back to the OS, the range stays reserved
+    void decommit_virtual_memory(void* ptr, size_t bytesize);
+
+    // Reserves and commits a range in one go, returns nullptr on failure
+    void* map_virtual_memory(size_t bytesize);
+
+    // size in bytes of the huge pages map_huge_virtual_memory tries to use
+    size_t huge_page_size();
+
+    // Like map_virtual_memory but backed by huge pages when the system has any to
+    // give, falling back to transparent huge pages and then to normal pages. bytesize
+    // must be a multiple of huge_page_size(). Returns nullptr on failure
+    void* map_huge_virtual_memory(size_t bytesize);
+
+    // Unmaps a range returned by reserve_virtual_memory or map_virtual_memory
+    void release_virtual_memory(void* ptr, size_t bytesize);
+}
@@ -1,4 +1,10 @@
 #include <ptm/portem.hpp>
+#include <set>
+#include <string>
+#include <coroutine>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
 
 struct object_t {
     const char* name = "The name";
@@ -70,6 +76,126 @@ void test_memory_pool(size_t test_size) {
     }
 }
 
+// runs must never reach into the padding bits of the last flags byte
+void test_continuous_pool_tail(size_t test_size) {
+    {
+        ptm::_impl_continuous_memory_pool_t pool(8, 100);
+        uint8_t* block = (uint8_t*)pool.get_block();
+
+        void* first = pool.allocate(10);
+        pool.allocate(80);
+        pool.deallocate(first, 10);
+
+        uint8_t* tail = (uint8_t*)pool.allocate(14);
+        if(tail && (tail < block || tail + 14 * 8 > block + 100 * 8)) {
+            printf("continuous pool handed out elements past its end\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for(size_t max_elements = 1; max_elements < test_size / 10; max_elements++) {
+        if(max_elements % 8 == 0)
+            continue;
+
+        ptm::_impl_continuous_memory_pool_t pool(8, max_elements);
+        uint8_t* end = (uint8_t*)pool.get_block() + max_elements * 8;
+
+        for(size_t n = 1; n <= max_elements; n++) {
+            void* head = pool.allocate(max_elements - n);
+            uint8_t* run = (uint8_t*)pool.allocate(n + 1);
+
+            if(run && run + (n + 1) * 8 > end) {
+                printf("continuous pool of %zu handed out %zu elements past its end\n", max_elements, n + 1);
+                exit(EXIT_FAILURE);
+            }
+
+            if(run)
+                pool.deallocate(run, n + 1);
+            if(head)
+                pool.deallocate(head, max_elements - n);
+        }
+    }
+}
+
+// checks the shared free bit search against a scan of one bit at a time, with
+// random bits past max_bits that must never be part of a run
+template<typename word_t>
+void test_bitmap(size_t test_size) {
+    constexpr size_t word_bits = sizeof(word_t) * 8;
+
+    for(size_t i = 0; i < test_size; i++) {
+        size_t max_bits = rand() % 300 + 1;
+        std::vector<word_t> words((max_bits + word_bits - 1) / word_bits);
+
+        // runs of used and free bits of varied length, so whole words of both show up
+        bool used = rand() % 2;
+        for(size_t bit = 0; bit < words.size() * word_bits; bit++) {
+            if(rand() % 24 == 0)
+                used = !used;
+            if(used || (bit >= max_bits && rand() % 2))
+                words[bit / word_bits] |= (word_t)1 << (bit % word_bits);
+        }
+
+        auto load    = [&](size_t word) { return words[word]; };
+        auto is_free = [&](size_t bit) { return !(words[bit / word_bits] & ((word_t)1 << (bit % word_bits))); };
+
+        size_t begin = rand() % max_bits;
+        size_t end   = begin + rand() % (max_bits - begin + 1);
+        size_t n     = rand() % 40 + 1;
+
+        size_t expected = SIZE_MAX;
+        for(size_t start = begin; start < end && start + n <= max_bits && expected == SIZE_MAX; start++) {
+            bool fits = true;
+            for(size_t bit = start; bit < start + n && fits; bit++)
+                fits = is_free(bit);
+            if(fits)
+                expected = start;
+        }
+
+        size_t found = ptm::find_free_bits(load, begin, end, max_bits, n);
+        if(found != expected) {
+            printf("find_free_bits found %zu instead of %zu for %zu bits from %zu to %zu of %zu\n", found, expected, n, begin, end, max_bits);
+            exit(EXIT_FAILURE);
+        }
+
+        size_t tail = max_bits;
+        while(tail > 0 && is_free(tail - 1))
+            tail--;
+
+        if(ptm::free_tail_of_bits(load, max_bits) != tail) {
+            printf("free_tail_of_bits did not find the free tail at %zu of %zu\n", tail, max_bits);
+            exit(EXIT_FAILURE);
+        }
+
+        // every free run from begin on, in order and each as long as it goes
+        size_t next = begin;
+        ptm::for_each_free_bits(load, begin, max_bits, [&](size_t start, size_t length) {
+            while(next < start && !is_free(next))
+                next++;
+
+            bool whole = next == start && length > 0 && (start + length == max_bits || !is_free(start + length));
+            for(size_t bit = start; bit < start + length && whole; bit++)
+                whole = is_free(bit);
+
+            if(!whole) {
+                printf("for_each_free_bits visited %zu bits from %zu which is not a free run\n", length, start);
+                exit(EXIT_FAILURE);
+            }
+
+            next = start + length;
+            return false;
+        });
+
+        while(next < max_bits && !is_free(next))
+            next++;
+
+        if(next != max_bits) {
+            printf("for_each_free_bits missed the free run at %zu\n", next);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
 template<typename T>
 void test_rda(ptm::rda_t& rda, size_t test_size) {
     if(!rda.register_type<T>(test_size)) {
@@ -77,57 +203,1748 @@ void test_rda(ptm::rda_t& rda, size_t test_size) {
         exit(EXIT_FAILURE);
     }
 
-    for(uint32_t i = 0; i < 10; i++) {
-        std::vector<T> const_values;
-        const_values.reserve(test_size);
-        for(uint32_t i = 0; i < test_size; i++) {
-            const_values.push_back((T)rand());
+    for(uint32_t i = 0; i < 10; i++) {
+        std::vector<T> const_values;
+        const_values.reserve(test_size);
+        for(uint32_t i = 0; i < test_size; i++) {
+            const_values.push_back((T)rand());
+        }
+
+        std::vector<T*> test_values;
+        test_values.reserve(test_size);
+        for(uint32_t i = 0; i < test_size; i++) {
+            test_values.push_back(rda.allocate<T>(10));
+
+            if(test_values[i] == nullptr) {
+                printf("RDA Failed to allocate\n");
+                exit(EXIT_FAILURE);
+            }
+
+            for(int j = 0; j < 10; j++) {
+                test_values[i][j] = const_values[i];
+            } 
+
+            if(rand() % 1) {
+                rda.deallocate(test_values.back(), 10);
+                test_values[i] = nullptr;
+                continue;
+            }
+        }
+
+        for(uint32_t i = 0; i < test_size; i++) {
+            if(!test_values[i])
+                continue;
+
+            for(uint32_t j = 0; j < 10; j++) {
+                if(test_values[i][j] != const_values[i]) {
+                    printf("a value was found that was not valid\n");
+
+                    for(auto ptr : test_values)
+                        rda.deallocate<T>(ptr, 10);
+
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+
+        for(auto ptr : test_values) {
+            if(ptr)
+                rda.deallocate<T>(ptr, 10);
+        }
+    }
+}
+
+void test_reserved_memory_pool(size_t test_size) {
+    // a small reservation so growing up to it is exercised as well
+    ptm::reserved_memory_pool_t<object_t> pool(16, test_size * 10);
+    object_t* block = pool.data();
+
+    std::vector<object_t*> test_values;
+    for(uint32_t i = 0; i < test_size; i++) {
+        test_values.push_back(pool.allocate(10));
+
+        if(test_values[i] == nullptr) {
+            printf("reserved pool failed to allocate\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for(uint32_t j = 0; j < 10; j++) {
+            new(&test_values[i][j])object_t();
+            test_values[i][j].mass = (float)i;
+        }
+    }
+
+    if(pool.data() != block || pool.get_max_elements() < test_size * 10) {
+        printf("reserved pool moved or did not grow\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(uint32_t i = 0; i < test_size; i++) {
+        // every element must be in the one continuous block
+        if(test_values[i] != block + i * 10) {
+            printf("reserved pool is not continuous\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for(uint32_t j = 0; j < 10; j++) {
+            if(test_values[i][j].mass != (float)i) {
+                printf("a value was found that was not valid\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    if(pool.allocate(10) != nullptr) {
+        printf("reserved pool allocated past its reservation\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(auto ptr : test_values) {
+        pool.deallocate(ptr, 10);
+    }
+
+    // the reservation is full, so this can only succeed by reusing elements
+    if(pool.allocate(10) == nullptr) {
+        printf("reserved pool did not reuse freed elements\n");
+        exit(EXIT_FAILURE);
+    }
+}
+void test_owned_object_pool(size_t test_size) {
+    ptm::owned_object_pool_t<object_t> pool(test_size);
+
+    std::vector<object_t*> test_values;
+    for(uint32_t i = 0; i < test_size; i++) {
+        test_values.push_back(pool.create(1));
+    }
+
+    // every object is freed by a thread that does not own the pool
+    std::thread remote([&]() {
+        for(auto ptr : test_values)
+            pool.destroy(ptr, 1);
+    });
+    remote.join();
+
+    // the first sub pool is full, so the pool would grow
+    // instead of reusing the objects if the remote frees were not reclaimed
+    std::set<object_t*> freed(test_values.begin(), test_values.end());
+    for(uint32_t i = 0; i < test_size; i++) {
+        if(freed.count(pool.create(1)) == 0) {
+            printf("owned pool did not reclaim remote frees\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+struct pooled_task_t {
+    struct promise_type : ptm::pooled_coroutine_frame_t {
+        int value = 0;
+
+        pooled_task_t get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_value(int result) { value = result; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+pooled_task_t pooled_coroutine(int value) {
+    co_return value * 2;
+}
+
+void test_coroutine_frame_pool(size_t test_size) {
+    std::vector<pooled_task_t> tasks;
+    for(uint32_t i = 0; i < test_size; i++) {
+        tasks.push_back(pooled_coroutine(i));
+    }
+
+    for(uint32_t i = 0; i < test_size; i++) {
+        tasks[i].handle.resume();
+
+        if(tasks[i].handle.promise().value != (int)i * 2) {
+            printf("a pooled coroutine returned the wrong value\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // half of the frames are freed by a thread that did not allocate them
+    std::thread remote([&]() {
+        for(uint32_t i = 0; i < test_size / 2; i++)
+            tasks[i].handle.destroy();
+    });
+    remote.join();
+
+    for(uint32_t i = test_size / 2; i < test_size; i++) {
+        tasks[i].handle.destroy();
+    }
+}
+struct persistent_node_t {
+    uint32_t value;
+    ptm::relative_ptr_t<persistent_node_t> next;
+};
+
+void test_persistent_object_pool(size_t test_size) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/portem_test_%d.pool", (int)getpid());
+    remove(path);
+
+    {
+        ptm::persistent_object_pool_t<persistent_node_t> pool(path, 16, test_size * 4);
+
+        // a list built back to front, the root is the head
+        persistent_node_t* head = nullptr;
+        for(uint32_t i = 0; i < test_size; i++) {
+            persistent_node_t* node = pool.create(1);
+            node->value = test_size - 1 - i;
+            node->next  = head;
+            head = node;
+        }
+
+        pool.set_root(head);
+
+        if(!pool.was_created() || !pool.sync()) {
+            printf("persistent pool was not created\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    {
+        ptm::persistent_object_pool_t<persistent_node_t> pool(path);
+
+        if(pool.was_created()) {
+            printf("persistent pool was not reopened\n");
+            exit(EXIT_FAILURE);
+        }
+
+        uint32_t count = 0;
+        for(persistent_node_t* node = pool.get_root(); node; node = node->next.get()) {
+            if(node->value != count++) {
+                printf("a value was found that was not valid\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        size_t live = 0;
+        pool.for_each([&](persistent_node_t&) { live++; });
+
+        if(count != test_size || live != test_size) {
+            printf("persistent pool lost elements\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // a partly written file is rejected instead of faulting on its missing pages
+    struct stat info;
+    stat(path, &info);
+    if(truncate(path, info.st_size / 2) != 0) {
+        printf("could not truncate the persistent pool file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bool rejected = false;
+    try {
+        ptm::persistent_object_pool_t<persistent_node_t> pool(path);
+    } catch(const std::exception&) {
+        rejected = true;
+    }
+
+    if(!rejected) {
+        printf("persistent pool opened a truncated file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    remove(path);
+}
+struct compressed_base_t {
+    uint32_t id;
+};
+
+struct compressed_derived_t : compressed_base_t {
+    uint32_t extra;
+};
+
+void test_compressed_object_pool(size_t test_size) {
+    using pool_t = ptm::compressed_object_pool_t<compressed_derived_t>;
+    pool_t pool(16);
+
+    std::vector<pool_t::pointer_t> test_values;
+    for(uint32_t i = 0; i < test_size; i++) {
+        test_values.push_back(pool.create());
+        test_values.back()->id    = i;
+        test_values.back()->extra = i * 2;
+    }
+
+    for(uint32_t i = 0; i < test_size; i++) {
+        // upcasting keeps pointing at the same object
+        ptm::pool_ptr_t<compressed_base_t, pool_t> base = test_values[i];
+
+        if(sizeof(base) != sizeof(uint32_t) || base->id != i || test_values[i]->extra != i * 2) {
+            printf("a value was found that was not valid\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if(!pool_t::pointer_t().is_null() || pool_t::pointer_t(nullptr).get() != nullptr) {
+        printf("a null pool_ptr_t was not null\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(auto ptr : test_values)
+        pool.destroy(ptr);
+}
+struct shared_message_t {
+    uint32_t id;
+    char     text[60];
+};
+
+void test_shared_object_pool(size_t test_size) {
+    ptm::shared_object_pool_t<shared_message_t> pool;
+
+    if(!pool.create(nullptr, test_size)) {
+        printf("shared pool could not be created\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int handles[2];
+    if(pipe(handles) != 0) {
+        printf("pipe failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the child allocates messages in place and only sends the handles
+    pid_t child = fork();
+    if(child == 0) {
+        ptm::shared_object_pool_t<shared_message_t> attached;
+        if(!attached.attach_fd(pool.get_fd()))
+            _exit(EXIT_FAILURE);
+
+        for(uint32_t i = 0; i < test_size / 2; i++) {
+            shared_message_t* message = attached.allocate();
+            if(!message)
+                _exit(EXIT_FAILURE);
+
+            message->id = i;
+            snprintf(message->text, sizeof(message->text), "message %u", i);
+
+            ptm::shm_handle_t handle = attached.handle_of(message);
+            if(write(handles[1], &handle, sizeof(handle)) != sizeof(handle))
+                _exit(EXIT_FAILURE);
+        }
+
+        // leaked on purpose, the parent reclaims it once the child is gone
+        attached.allocate();
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(handles[1]);
+
+    std::vector<shared_message_t*> messages;
+    ptm::shm_handle_t handle;
+    while(read(handles[0], &handle, sizeof(handle)) == sizeof(handle)) {
+        char expected[60];
+        shared_message_t* message = pool.get(handle);
+        snprintf(expected, sizeof(expected), "message %u", (uint32_t)messages.size());
+
+        if(message->id != messages.size() || strcmp(message->text, expected) != 0) {
+            printf("a value was found that was not valid\n");
+            exit(EXIT_FAILURE);
+        }
+
+        pool.adopt(message);
+        messages.push_back(message);
+    }
+    close(handles[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS || messages.size() != test_size / 2) {
+        printf("the child process failed to allocate\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(pool.reclaim_dead_owners() != 1) {
+        printf("shared pool did not reclaim the dead process's message\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(auto message : messages)
+        pool.deallocate(message);
+}
+void test_large_allocations(size_t test_size) {
+    ptm::_impl_sparse_memory_pool_t pool(sizeof(object_t), 16);
+
+    // far bigger than any sub pool, it used to return nullptr
+    object_t* large = (object_t*)pool.allocate(test_size * 10);
+    object_t* small = (object_t*)pool.allocate(1);
+
+    if(!large || !small || pool.get_large_allocation_count() != 1) {
+        printf("large allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(uint32_t i = 0; i < test_size * 10; i++) {
+        new(&large[i])object_t();
+    }
+
+    pool.deallocate(large, test_size * 10);
+    pool.deallocate(small, 1);
+
+    if(pool.get_large_allocation_count() != 0) {
+        printf("large allocation was not given back\n");
+        exit(EXIT_FAILURE);
+    }
+}
+struct counted_t {
+    static inline size_t live = 0;
+
+    counted_t() { live++; }
+    ~counted_t() { live--; }
+};
+
+void test_epoch(size_t test_size) {
+    ptm::object_pool_t<counted_t> pool(test_size);
+    ptm::epoch_t epoch;
+
+    ptm::epoch_t::local_t writer(epoch);
+    {
+        ptm::epoch_t::local_t reader(epoch);
+        auto guard = reader.pin();
+
+        for(uint32_t i = 0; i < test_size; i++) {
+            writer.retire(pool, pool.create(1));
+        }
+
+        // the reader is still pinned, nothing retired since may be freed
+        writer.collect();
+        writer.collect();
+        if(counted_t::live != test_size) {
+            printf("an object was freed while a reader could see it\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for(uint32_t i = 0; i < 3; i++)
+        writer.collect();
+
+    if(counted_t::live != 0 || writer.get_retired_count() != 0) {
+        printf("retired objects were not freed\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// readers dereference shared nodes while writers swap them out and retire them,
+// a node marked dead while a reader holds it was freed under that reader
+struct epoch_node_t {
+    uint32_t alive = 1; // read and written through std::atomic_ref
+    uint64_t value = 0;
+};
+
+void test_epoch_stress(size_t test_size) {
+    constexpr size_t writer_count = 2;
+    constexpr size_t reader_count = 2;
+    constexpr size_t slot_count   = 16;
+
+    std::atomic<epoch_node_t*> slots[writer_count][slot_count];
+    std::atomic<bool>   done     = false;
+    std::atomic<bool>   failed   = false;
+    std::atomic<size_t> finished = 0;
+
+    // each writer has a pool of its own, locked as orphaned retires may be freed by any thread
+    struct locked_pool_t {
+        ptm::object_pool_t<epoch_node_t> pool;
+        std::mutex                       mutex;
+
+        locked_pool_t(size_t size)
+            : pool(size) {}
+    };
+
+    // the epoch frees what is still retired when it is destroyed, so it goes before the pools
+    std::vector<std::unique_ptr<locked_pool_t>> pools;
+    ptm::epoch_t epoch;
+
+    for(size_t w = 0; w < writer_count; w++) {
+        pools.push_back(std::make_unique<locked_pool_t>(test_size));
+        for(size_t i = 0; i < slot_count; i++)
+            slots[w][i].store(pools[w]->pool.create(1), std::memory_order_relaxed);
+    }
+
+    auto kill = [](void* context, void* object) {
+        locked_pool_t* pool = (locked_pool_t*)context;
+        std::lock_guard<std::mutex> lock(pool->mutex);
+
+        std::atomic_ref<uint32_t>(((epoch_node_t*)object)->alive).store(0, std::memory_order_relaxed);
+        pool->pool.destroy((epoch_node_t*)object, 1);
+    };
+
+    std::vector<std::thread> readers;
+    for(size_t r = 0; r < reader_count; r++) {
+        readers.emplace_back([&]() {
+            ptm::epoch_t::local_t local(epoch);
+
+            while(!done.load(std::memory_order_relaxed)) {
+                auto guard = local.pin();
+
+                for(size_t w = 0; w < writer_count; w++) {
+                    for(size_t i = 0; i < slot_count; i++) {
+                        epoch_node_t* node = slots[w][i].load(std::memory_order_acquire);
+                        if(!std::atomic_ref<uint32_t>(node->alive).load(std::memory_order_relaxed))
+                            failed = true;
+                    }
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for(size_t w = 0; w < writer_count; w++) {
+        writers.emplace_back([&, w]() {
+            ptm::epoch_t::local_t local(epoch);
+
+            for(size_t i = 0; i < test_size * 100; i++) {
+                epoch_node_t* node;
+                {
+                    std::lock_guard<std::mutex> lock(pools[w]->mutex);
+                    node = pools[w]->pool.create(1);
+                }
+                node->value = i;
+
+                epoch_node_t* old = slots[w][i % slot_count].exchange(node, std::memory_order_acq_rel);
+                local.retire(old, pools[w].get(), kill);
+            }
+
+            // wait for the readers before the local frees what is left
+            finished++;
+            while(!done.load(std::memory_order_relaxed))
+                std::this_thread::yield();
+        });
+    }
+
+    while(finished.load() < writer_count)
+        std::this_thread::yield();
+
+    done = true;
+    for(std::thread& thread : readers)
+        thread.join();
+    for(std::thread& thread : writers)
+        thread.join();
+
+    if(failed) {
+        printf("an epoch protected node was freed while a reader held it\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(size_t w = 0; w < writer_count; w++) {
+        for(size_t i = 0; i < slot_count; i++)
+            pools[w]->pool.destroy(slots[w][i].load(), 1);
+    }
+}
+template<bool stable_nodes>
+void test_flat_hash_map(size_t test_size) {
+    ptm::memory_pool_t<uint8_t> backing(test_size * 64);
+    ptm::flat_hash_map_t<uint64_t, std::string, stable_nodes> map(&backing);
+    std::map<uint64_t, std::string> expected;
+
+    for(uint64_t i = 0; i < test_size * 10; i++) {
+        uint64_t key = (uint64_t)rand() % (test_size * 4);
+
+        if(rand() % 3 == 0) {
+            if(map.erase(key) != (expected.erase(key) == 1)) {
+                printf("flat_hash_map_t erase disagreed\n");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            std::string value = std::to_string(i);
+
+            map[key] = value;
+            expected[key] = value;
+        }
+    }
+
+    if(map.size() != expected.size()) {
+        printf("flat_hash_map_t has the wrong size\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(uint64_t key = 0; key < test_size * 4; key++) {
+        std::string* value = map.find(key);
+        auto found = expected.find(key);
+
+        if((value == nullptr) != (found == expected.end()) || (value && *value != found->second)) {
+            printf("a value was found that was not valid\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void test_create_near(size_t test_size) {
+    ptm::object_pool_t<uint64_t> pool(test_size);
+
+    std::vector<uint64_t*> test_values;
+    for(uint32_t i = 0; i < test_size; i++) {
+        test_values.push_back(pool.create(1, i));
+    }
+
+    // leave a hole after every other element
+    for(uint32_t i = 1; i < test_size; i += 2) {
+        pool.destroy(test_values[i], 1);
+    }
+
+    uint64_t* parent = test_values[test_size / 2];
+    uint64_t* child  = pool.create_near(parent, 1, 0);
+
+    if(child != parent + 1 && child != parent - 1) {
+        printf("create_near did not place the element next to its hint\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+struct bulk_pod_t {
+    uint32_t a;
+    uint16_t b;
+    uint8_t  c;
+};
+
+// constructed from several threads at once by create_parallel
+struct bulk_counted_t {
+    static inline std::atomic<int> alive = 0;
+    static inline std::atomic<int> throw_after = -1; // the constructor throws once this many are alive
+
+    bulk_counted_t(int value) : value(value) {
+        int count = alive++;
+        if(count == throw_after.load()) {
+            alive--;
+            throw std::runtime_error("bulk_counted_t");
+        }
+    }
+
+    bulk_counted_t(const bulk_counted_t& other) : value(other.value) { alive++; }
+    ~bulk_counted_t() { alive--; }
+
+    int value;
+};
+
+void test_bulk_create(size_t test_size) {
+    ptm::object_pool_t<bulk_pod_t> pods(test_size * 4);
+
+    // dirty the memory first so a skipped construction is visible
+    bulk_pod_t* dirty = pods.create(test_size, bulk_pod_t{7, 7, 7});
+    pods.destroy(dirty, test_size);
+
+    bulk_pod_t* zeroed = pods.create(test_size);
+    bulk_pod_t* copies = pods.create(test_size * 3 - 1, bulk_pod_t{1, 2, 3});
+    for(size_t i = 0; i < test_size; i++) {
+        if(zeroed[i].a != 0 || zeroed[i].b != 0 || zeroed[i].c != 0) {
+            printf("bulk create did not value initialize element %zu\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for(size_t i = 0; i < test_size * 3 - 1; i++) {
+        if(copies[i].a != 1 || copies[i].b != 2 || copies[i].c != 3) {
+            printf("bulk create did not copy into element %zu\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // a threshold this low makes even a small array go through the threads
+    ptm::object_pool_t<bulk_counted_t> counted(test_size);
+    counted.set_parallel_construction(sizeof(bulk_counted_t), 4);
+
+    bulk_counted_t* objects = counted.create_parallel(test_size, 5);
+    if(bulk_counted_t::alive != (int)test_size || objects[0].value != 5 || objects[test_size - 1].value != 5) {
+        printf("bulk create did not construct every object\n");
+        exit(EXIT_FAILURE);
+    }
+
+    counted.destroy(objects, test_size);
+    if(bulk_counted_t::alive != 0) {
+        printf("bulk destroy did not destroy every object\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // a constructor that throws on one of the threads leaves nothing behind
+    bulk_counted_t::throw_after = (int)test_size / 2;
+    bool thrown = false;
+    try {
+        counted.create_parallel(test_size, 5);
+    } catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    bulk_counted_t::throw_after = -1;
+
+    if(!thrown || bulk_counted_t::alive != 0) {
+        printf("bulk create did not clean up after a throwing constructor\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // and the memory was given back
+    objects = counted.create_parallel(test_size, 5);
+    counted.destroy(objects, test_size);
+
+    // a single element gets its arguments forwarded, so it is moved into
+    ptm::object_pool_t<std::vector<int>> vectors(1);
+    std::vector<int> source(test_size, 1);
+    std::vector<int>* moved = vectors.create(1, std::move(source));
+    if(moved->size() != test_size || !source.empty()) {
+        printf("create did not forward its arguments\n");
+        exit(EXIT_FAILURE);
+    }
+
+    vectors.destroy(moved, 1);
+}
+
+struct recycled_t {
+    static inline int constructed = 0;
+
+    recycled_t() { constructed++; }
+
+    void reset() { buffer.clear(); }
+    size_t retained_bytesize() const { return buffer.capacity() * sizeof(int); }
+
+    std::vector<int> buffer;
+};
+
+void test_recycling_object_pool(size_t test_size) {
+    ptm::recycling_object_pool_t<recycled_t> pool(test_size, test_size, test_size * sizeof(int));
+
+    std::vector<recycled_t*> objects;
+    for(size_t i = 0; i < test_size; i++) {
+        objects.push_back(pool.create());
+        objects.back()->buffer.resize(i + 1);
+    }
+
+    for(recycled_t* object : objects) {
+        pool.destroy(object);
+    }
+
+    if(pool.get_recycled_count() != test_size) {
+        printf("recycling pool did not keep the destroyed objects\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // reuse hands back reset objects that kept their buffers
+    for(size_t i = 0; i < test_size; i++) {
+        objects[i] = pool.create();
+
+        if(!objects[i]->buffer.empty() || objects[i]->buffer.capacity() == 0) {
+            printf("recycling pool did not reset the object or lost its buffer\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if(recycled_t::constructed != (int)test_size) {
+        printf("recycling pool constructed objects it could have reused\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // an object that grew past the cap is destroyed instead
+    objects[0]->buffer.resize(test_size * 2);
+    pool.destroy(objects[0]);
+    if(pool.get_recycled_count() != 0) {
+        printf("recycling pool kept an object over its capacity cap\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(size_t i = 1; i < test_size; i++) {
+        pool.destroy(objects[i]);
+    }
+}
+
+void test_spsc_ring(size_t test_size) {
+    ptm::memory_pool_t<uint8_t> memory(4096);
+    ptm::spsc_ring_t<size_t> ring(64, &memory);
+    size_t count = test_size * 100;
+
+    // single pushes, then batches, so both paths see the ring wrap and fill up
+    std::thread producer([&]() {
+        size_t batch[16];
+        for(size_t i = 0; i < count;) {
+            if(i < count / 2) {
+                while(!ring.try_push(i)) std::this_thread::yield();
+                i++;
+            } else {
+                size_t n = std::min<size_t>(16, count - i);
+                for(size_t j = 0; j < n; j++)
+                    batch[j] = i + j;
+
+                size_t pushed = 0;
+                while(pushed < n) {
+                    pushed += ring.try_push(batch + pushed, n - pushed);
+                    std::this_thread::yield();
+                }
+                i += n;
+            }
+        }
+    });
+
+    size_t batch[16];
+    for(size_t expected = 0; expected < count;) {
+        size_t popped = ring.try_pop(batch, 16);
+        for(size_t j = 0; j < popped; j++, expected++) {
+            if(batch[j] != expected) {
+                printf("spsc ring popped %zu instead of %zu\n", batch[j], expected);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        if(popped == 0)
+            std::this_thread::yield();
+    }
+
+    producer.join();
+}
+
+void test_mpmc_ring(size_t test_size) {
+    ptm::mpmc_ring_t<size_t> ring(64);
+    size_t per_producer = test_size * 50;
+
+    std::atomic<size_t> sum = 0;
+    std::atomic<size_t> popped = 0;
+    std::vector<std::thread> threads;
+
+    for(size_t p = 0; p < 2; p++) {
+        threads.emplace_back([&]() {
+            size_t batch[4] = {1, 2, 3, 4};
+            for(size_t i = 0; i < per_producer; i += 4) {
+                size_t pushed = 0;
+                while(pushed < 4) {
+                    pushed += ring.try_push(batch + pushed, 4 - pushed);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for(size_t c = 0; c < 2; c++) {
+        threads.emplace_back([&]() {
+            size_t value;
+            while(popped.load() < per_producer * 2) {
+                if(ring.try_pop(value)) {
+                    sum += value;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for(auto& thread : threads)
+        thread.join();
+
+    // every batch of four adds up to 10
+    if(sum != per_producer * 2 / 4 * 10) {
+        printf("mpmc ring lost or duplicated values\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+struct shared_counted_t : ptm::ref_counted_t<shared_counted_t> {
+    static inline int alive = 0;
+
+    shared_counted_t(int value) : value(value) { alive++; }
+    ~shared_counted_t() { alive--; }
+
+    int value;
+};
+
+void test_smart_pointers(size_t test_size) {
+    {
+        ptm::object_pool_t<shared_counted_t> pool(test_size);
+        std::vector<ptm::pool_unique_ptr<shared_counted_t>> objects;
+
+        for(size_t i = 0; i < test_size; i++) {
+            objects.push_back(ptm::make_pool_unique(pool, (int)i));
+        }
+
+        objects.clear();
+        if(shared_counted_t::alive != 0) {
+            printf("pool_unique_ptr did not destroy its objects\n");
+            exit(EXIT_FAILURE);
+        }
+
+        auto global = ptm::make_global_pool_unique<shared_counted_t>(1);
+        if(sizeof(global) != sizeof(void*)) {
+            printf("pool_unique_ptr with a global pool is bigger than a pointer\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    {
+        ptm::shared_ptr_pool_t<shared_counted_t> pool(test_size);
+        std::vector<std::shared_ptr<shared_counted_t>> objects;
+
+        for(size_t i = 0; i < test_size; i++) {
+            objects.push_back(ptm::allocate_shared_in(pool, (int)i));
+        }
+
+        std::vector<std::shared_ptr<shared_counted_t>> copies = objects;
+        objects.clear();
+        if(shared_counted_t::alive != (int)test_size || copies.back()->value != (int)test_size - 1) {
+            printf("allocate_shared_in destroyed objects that were still shared\n");
+            exit(EXIT_FAILURE);
+        }
+
+        copies.clear();
+        if(shared_counted_t::alive != 0) {
+            printf("allocate_shared_in did not destroy its objects\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    {
+        ptm::object_pool_t<shared_counted_t> pool(test_size);
+        std::vector<ptm::intrusive_ptr_t<shared_counted_t>> objects;
+
+        for(size_t i = 0; i < test_size; i++) {
+            objects.push_back(ptm::make_intrusive_in(pool, (int)i));
+        }
+
+        std::vector<ptm::intrusive_ptr_t<shared_counted_t>> copies = objects;
+        if(copies[0]->get_reference_count() != 2) {
+            printf("intrusive_ptr_t did not count its references\n");
+            exit(EXIT_FAILURE);
+        }
+
+        objects.clear();
+        copies.clear();
+        if(shared_counted_t::alive != 0) {
+            printf("intrusive_ptr_t did not destroy its objects\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+struct run_queue_tag_t {};
+
+struct task_t : ptm::list_base_hook_t<run_queue_tag_t>, ptm::doubly_linked_list_element_t {
+    size_t           id;
+    ptm::list_hook_t all_tasks;
+};
+
+using run_queue_t = ptm::intrusive_list_t<task_t, ptm::base_hook_t<task_t, run_queue_tag_t>>;
+using task_list_t = ptm::intrusive_list_t<task_t, ptm::member_hook_t<task_t, &task_t::all_tasks>>;
+
+void test_intrusive_list(size_t test_size) {
+    std::vector<task_t> tasks(test_size);
+    run_queue_t even, odd;
+    task_list_t all;
+
+    // every task is in two lists at once
+    for(size_t i = 0; i < test_size; i++) {
+        tasks[i].id = i;
+        all.push_back(&tasks[i]);
+        (i % 2 ? odd : even).push_back(&tasks[i]);
+    }
+
+    size_t expected = 0;
+    for(task_t& task : all) {
+        if(task.id != expected++) {
+            printf("intrusive list iterated out of order\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    even.splice(even.end(), odd);
+    if(!odd.empty() || even.size() != test_size || even.back()->id != test_size - 1) {
+        printf("intrusive list splice lost elements\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // removing from one list leaves the other alone
+    even.remove(&tasks[0]);
+    if(run_queue_t::is_linked(&tasks[0]) || !task_list_t::is_linked(&tasks[0]) || all.front() != &tasks[0]) {
+        printf("intrusive list removed from the wrong list\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while(all.pop_front()) {}
+    if(!all.empty() || all.pop_back() != nullptr) {
+        printf("intrusive list did not pop every element\n");
+        exit(EXIT_FAILURE);
+    }
+
+    even.clear();
+
+    // popping the last element used to leave the old list dangling
+    ptm::doubly_linked_list_header_t<task_t> header;
+    header.push_back(&tasks[0]);
+    header.pop_front();
+    header.push_back(&tasks[1]);
+    header.push_back(&tasks[2]);
+    header.pop_back();
+    header.pop_back();
+    if(!header.is_empty() || header.last != nullptr) {
+        printf("doubly linked list header was left inconsistent\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void test_lru_cache(size_t test_size) {
+    using cache_t = ptm::lru_cache_t<uint32_t, std::string>;
+
+    // room for about 100 entries with empty strings
+    size_t entry_bytesize = ptm::entry_bytesize_of_t<uint32_t, std::string>()(0, std::string());
+    cache_t cache(entry_bytesize * 100);
+
+    for(uint32_t i = 0; i < test_size; i++) {
+        cache.put(i, std::string());
+
+        // keep touching the first key so it is never the least recently used
+        if(!cache.get(0)) {
+            printf("lru cache evicted a recently used entry\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if(cache.size() != 100 || cache.get_used_bytesize() > cache.get_max_bytesize()) {
+        printf("lru cache did not keep to its budget\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(cache.peek(1) || !cache.peek(test_size - 1)) {
+        printf("lru cache evicted the wrong entries\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // a value that retains a lot pushes out older entries to make room
+    cache.put(test_size, std::string(entry_bytesize * 50, 'x'));
+    if(cache.size() > 50 || !cache.peek(test_size) || cache.get_used_bytesize() > cache.get_max_bytesize()) {
+        printf("lru cache did not account for the bytes values retain\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ptm::sharded_lru_cache_t<uint32_t, uint32_t> sharded(test_size * 1024);
+    std::vector<std::thread> threads;
+    for(uint32_t t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            for(uint32_t i = 0; i < test_size; i++)
+                sharded.put(i * 4 + t, i);
+        });
+    }
+
+    for(auto& thread : threads)
+        thread.join();
+
+    if(sharded.size() != test_size * 4 || sharded.get(5).value_or(0) != 1) {
+        printf("sharded lru cache lost entries\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void test_composable_allocator(size_t test_size) {
+    // a small arena first, then pools by size class, then malloc for anything big
+    using small_t = ptm::fallback_t<ptm::stack_arena_t<1024>, ptm::bucketizer_t<ptm::pool_allocator_t, 0, 256, 32>>;
+    ptm::segregator_t<256, small_t, ptm::malloc_allocator_t> allocator;
+
+    std::vector<std::pair<uint8_t*, size_t>> blocks;
+    for(size_t i = 0; i < test_size; i++) {
+        size_t bytesize = 1 + (i * 37) % 512;
+        uint8_t* block  = (uint8_t*)allocator.allocate(bytesize);
+
+        memset(block, (int)i, bytesize);
+        blocks.push_back({block, bytesize});
+    }
+
+    auto& small = allocator.get_small();
+    if(!small.get_primary().owns(blocks[0].first) || small.get_primary().owns(blocks[test_size - 1].first)) {
+        printf("fallback did not use its primary allocator first\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(size_t i = 0; i < test_size; i++) {
+        auto [block, bytesize] = blocks[i];
+
+        if(bytesize <= 256 && !small.owns(block)) {
+            printf("segregator sent a small block to the large allocator\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for(size_t j = 0; j < bytesize; j++) {
+            if(block[j] != (uint8_t)i) {
+                printf("composed allocator handed out overlapping blocks\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    for(auto [block, bytesize] : blocks) {
+        allocator.deallocate(block, bytesize);
+    }
+
+    // the buckets are empty again, so a block of the same size comes back
+    void* reused = allocator.allocate(blocks[test_size - 2].second);
+    if(!small.get_secondary().owns(reused)) {
+        printf("bucketizer did not route the free back to its bucket\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the arena is a stack_allocator_t, raw bytes and pushed objects share its memory
+    ptm::stack_arena_t<1024> arena;
+    void* first = arena.allocate(24);
+    void* top   = arena.allocate(40);
+    arena.deallocate(top, 40);
+    if(arena.allocate(40) != top || (size_t)first % ptm::stack_allocator_t::default_alignment || (size_t)top % ptm::stack_allocator_t::default_alignment) {
+        printf("stack arena did not give back its newest allocation\n");
+        exit(EXIT_FAILURE);
+    }
+
+    object_t* pushed = arena.push<object_t>().get();
+    arena.pop();
+    if(arena.push<object_t>().get() != pushed) {
+        printf("stack allocator did not reuse the memory of a popped block\n");
+        exit(EXIT_FAILURE);
+    }
+
+    arena.reset();
+    if(arena.allocate(24) != first) {
+        printf("stack arena did not reset\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void test_io_buffer_pool(size_t test_size) {
+    ptm::io_buffer_pool_t pool(1000, 8);
+
+    if(pool.get_buffer_bytesize() != ptm::page_size()) {
+        printf("io buffer size was not rounded to a page\n");
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<ptm::io_buffer_t> buffers;
+    while(ptm::io_buffer_t buffer = pool.acquire()) {
+        if((size_t)buffer.data() % ptm::page_size() != 0) {
+            printf("io buffer is not page aligned\n");
+            exit(EXIT_FAILURE);
+        }
+
+        buffers.push_back(std::move(buffer));
+    }
+
+    if(buffers.size() != 8 || pool.get_free_count() != 0) {
+        printf("io buffer pool handed out the wrong number of buffers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // a slice keeps its buffer out of the pool after the buffer itself is gone
+    const char* line = "key=value\n";
+    memcpy(buffers[0].data(), line, strlen(line));
+    buffers[0].resize(strlen(line));
+
+    ptm::io_slice_t value = buffers[0].slice().slice(4, 5);
+    buffers.clear();
+
+    if(pool.get_free_count() != 7 || value.view() != "value") {
+        printf("io slice did not keep its buffer alive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    value = ptm::io_slice_t();
+    if(pool.get_free_count() != 8) {
+        printf("io buffer was not given back after its last slice\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // handing buffers back and forth never grows the pool
+    for(size_t i = 0; i < test_size; i++) {
+        ptm::io_buffer_t buffer = pool.acquire();
+        ptm::io_slice_t  slice  = buffer.slice(0, 1);
+        if(!buffer || buffer.get_index() >= 8) {
+            printf("io buffer pool ran dry\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if(pool.get_free_count() != 8) {
+        printf("io buffer pool leaked buffers\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+struct ecs_position_t {
+    float x, y;
+};
+
+struct ecs_velocity_t {
+    float x, y;
+};
+
+void test_archetype_storage(size_t test_size) {
+    ptm::rda_t rda;
+    rda.register_type<ecs_position_t>(test_size);
+    rda.register_type<ecs_velocity_t>(test_size);
+    rda.register_type<std::string>(test_size);
+
+    ptm::archetype_storage_t storage(rda);
+    std::vector<ptm::entity_t> entities;
+
+    for(size_t i = 0; i < test_size; i++) {
+        ptm::entity_t entity = storage.create();
+        storage.add<ecs_position_t>(entity, ecs_position_t{(float)i, 0.0f});
+
+        if(i % 2 == 0)
+            storage.add<ecs_velocity_t>(entity, ecs_velocity_t{1.0f, 2.0f});
+        if(i % 3 == 0)
+            storage.add<std::string>(entity, std::to_string(i) + " has a name long enough to be on the heap");
+
+        entities.push_back(entity);
+    }
+
+    ptm::query_t<ecs_position_t, ecs_velocity_t> moving(storage);
+    if(moving.size() != (test_size + 1) / 2) {
+        printf("archetype query matched the wrong entities\n");
+        exit(EXIT_FAILURE);
+    }
+
+    moving.each([](ecs_position_t& position, ecs_velocity_t& velocity) {
+        position.x += velocity.x;
+        position.y += velocity.y;
+    });
+
+    for(size_t i = 0; i < test_size; i++) {
+        ecs_position_t* position = storage.get<ecs_position_t>(entities[i]);
+        float expected = (float)i + (i % 2 == 0 ? 1.0f : 0.0f);
+
+        if(!position || position->x != expected || storage.has<ecs_velocity_t>(entities[i]) != (i % 2 == 0)) {
+            printf("archetype storage lost a component\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // moving entities between archetypes keeps the components they still have
+    for(size_t i = 0; i < test_size; i += 3) {
+        storage.remove<ecs_velocity_t>(entities[i]);
+    }
+
+    for(size_t i = 0; i < test_size; i += 5) {
+        storage.destroy(entities[i]);
+    }
+
+    size_t named = 0;
+    storage.each<std::string>([&](ptm::entity_t entity, std::string& name) {
+        if(name.substr(0, name.find(' ')) != std::to_string(entity.index)) {
+            printf("archetype storage mixed up rows\n");
+            exit(EXIT_FAILURE);
+        }
+
+        named++;
+    });
+
+    for(size_t i = 0; i < test_size; i++) {
+        if(storage.is_alive(entities[i]) != (i % 5 != 0)) {
+            printf("archetype storage has the wrong entities alive\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    size_t expected_named = 0, expected_moving = 0;
+    for(size_t i = 0; i < test_size; i++) {
+        expected_named  += i % 3 == 0 && i % 5 != 0;
+        expected_moving += i % 2 == 0 && i % 3 != 0 && i % 5 != 0;
+    }
+
+    if(named != expected_named || moving.size() != expected_moving) {
+        printf("archetype storage has the wrong entities after moves\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // a destroyed entity's record is reused with a new generation
+    ptm::entity_t reused = storage.create();
+    if(storage.is_alive(entities[0]) || reused.index % 5 != 0 || reused.generation != 1) {
+        printf("archetype storage did not reuse a destroyed entity\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void test_small_list(size_t test_size) {
+    // so std::vector moves them instead of copying when it grows
+    static_assert(std::is_nothrow_move_constructible_v<ptm::small_list_t<std::string, 8>>);
+    static_assert(std::is_nothrow_move_assignable_v<ptm::small_list_t<std::string, 8>>);
+
+    ptm::small_list_t<std::string, 8> list;
+    std::vector<std::string>          expected;
+
+    auto check = [&](const char* what) {
+        if(list.size() != expected.size() || !std::equal(list.begin(), list.end(), expected.begin())) {
+            printf("small_list_t %s failed\n", what);
+            exit(EXIT_FAILURE);
+        }
+    };
+
+    for(size_t i = 0; i < 8; i++) {
+        list.push_back(std::to_string(i) + " is a string too long for small string optimization");
+        expected.push_back(list.back());
+    }
+
+    if(!list.is_inline()) {
+        printf("small_list_t spilled before it was full\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // an argument that refers to the list itself survives the spill
+    list.push_back(list[0]);
+    expected.push_back(expected[0]);
+    check("spilling");
+
+    for(size_t i = 0; i < test_size; i++) {
+        size_t at = (i * 7) % (list.size() + 1);
+
+        list.insert(list.begin() + at, std::to_string(i));
+        expected.insert(expected.begin() + at, std::to_string(i));
+    }
+    check("insert");
+
+    list.insert(list.begin() + 3, 5, "repeated");
+    expected.insert(expected.begin() + 3, 5, "repeated");
+    std::vector<std::string> head(expected.begin(), expected.begin() + 10);
+    list.insert(list.end(), head.begin(), head.end());
+    expected.insert(expected.end(), head.begin(), head.end());
+    check("range insert");
+
+    for(size_t i = 0; list.size() > 4; i++) {
+        size_t at = (i * 13) % list.size();
+        size_t n  = std::min<size_t>(3, list.size() - at);
+
+        list.erase(list.begin() + at, list.begin() + at + n);
+        expected.erase(expected.begin() + at, expected.begin() + at + n);
+    }
+    check("erase");
+
+    list.shrink_to_fit();
+    if(!list.is_inline()) {
+        printf("small_list_t did not shrink back inline\n");
+        exit(EXIT_FAILURE);
+    }
+    check("shrink_to_fit");
+
+    ptm::small_list_t<std::string, 8> moved = std::move(list);
+    std::swap(list, moved);
+    list.resize(20, "filler");
+    expected.resize(20, "filler");
+    check("move and resize");
+
+    // heap storage can come from a pool
+    ptm::memory_pool_t<uint64_t>       pool(64);
+    ptm::small_list_t<uint64_t, 4>     pooled(&pool);
+    for(uint64_t i = 0; i < test_size; i++)
+        pooled.push_back(i);
+
+    for(uint64_t i = 0; i < test_size; i++) {
+        if(pooled[i] != i) {
+            printf("small_list_t with a pool allocator failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// builds and edits a vector at compile time
+constexpr int inplace_vector_constexpr_sum() {
+    ptm::inplace_vector_t<int, 8> vector = {1, 2, 3, 4};
+
+    vector.insert(vector.begin() + 1, 10);
+    vector.erase(vector.begin() + 3);
+    vector.push_back(5);
+
+    int sum = 0;
+    for(int value : vector)
+        sum += value;
+
+    return sum;
+}
+
+static_assert(inplace_vector_constexpr_sum() == 1 + 10 + 2 + 4 + 5);
+static_assert(sizeof(ptm::inplace_vector_t<uint8_t, 15>) == 16);
+static_assert(std::is_trivially_copyable_v<ptm::inplace_vector_t<int, 4>>);
+
+void test_inplace_vector(size_t test_size) {
+    ptm::inplace_vector_t<std::string, 64> vector;
+    std::vector<std::string>               expected;
+
+    auto check = [&](const char* what) {
+        if(vector.size() != expected.size() || !std::equal(vector.begin(), vector.end(), expected.begin())) {
+            printf("inplace_vector_t %s failed\n", what);
+            exit(EXIT_FAILURE);
         }
+    };
 
-        std::vector<T*> test_values;
-        test_values.reserve(test_size);
-        for(uint32_t i = 0; i < test_size; i++) {
-            test_values.push_back(rda.allocate<T>(10));
+    for(size_t i = 0; i < test_size; i++) {
+        std::string value = std::to_string(i) + " is a string too long for small string optimization";
 
-            if(test_values[i] == nullptr) {
-                printf("RDA Failed to allocate\n");
+        if(vector.full()) {
+            if(vector.try_push_back(value)) {
+                printf("inplace_vector_t took more than its capacity\n");
                 exit(EXIT_FAILURE);
             }
 
-            for(int j = 0; j < 10; j++) {
-                test_values[i][j] = const_values[i];
-            } 
+            // erase a run from the middle to make room again
+            size_t at = i % 32;
+            vector.erase(vector.begin() + at, vector.begin() + at + 16);
+            expected.erase(expected.begin() + at, expected.begin() + at + 16);
+            check("erase");
+        }
 
-            if(rand() % 1) {
-                rda.deallocate(test_values.back(), 10);
-                test_values[i] = nullptr;
-                continue;
+        size_t at = (i * 7) % (vector.size() + 1);
+        vector.insert(vector.begin() + at, value);
+        expected.insert(expected.begin() + at, value);
+    }
+    check("insert");
+
+    ptm::inplace_vector_t<std::string, 64> copy = vector;
+    ptm::inplace_vector_t<std::string, 64> moved = std::move(copy);
+    if(moved != vector || !copy.empty()) {
+        printf("inplace_vector_t copy or move failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    vector.resize(10);
+    expected.resize(10);
+    vector.insert(vector.begin() + 2, 3, "repeated");
+    expected.insert(expected.begin() + 2, 3, "repeated");
+    check("resize and fill insert");
+
+    // the pieces of a pooled object need no allocation of their own
+    struct pooled_t {
+        ptm::inplace_vector_t<uint32_t, 6> children;
+        ptm::inplace_vector_t<uint16_t, 3> tags;
+    };
+
+    ptm::object_pool_t<pooled_t> pool(test_size);
+    pooled_t* object = pool.create(1);
+
+    for(uint32_t i = 0; i < 6; i++)
+        object->children.push_back(i);
+    object->children.erase(object->children.begin());
+
+    if(object->children.size() != 5 || object->children[0] != 1 || object->children.back() != 5) {
+        printf("inplace_vector_t in a pooled object failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pool.destroy(object, 1);
+}
+
+void test_heap_profiler(size_t test_size) {
+    ptm::start_heap_profiler(4096);
+
+    ptm::object_pool_t<object_t> pool(test_size);
+    ptm::stack_allocator_t       stack(test_size * sizeof(object_t) * 2);
+    std::vector<object_t*>       objects;
+
+    for(size_t i = 0; i < test_size; i++) {
+        objects.push_back(pool.create(1));
+        stack.push<object_t>();
+    }
+
+    // about one sample every 4096 bytes of the two allocators together
+    size_t expected = test_size * sizeof(object_t) * 2 / 4096;
+    size_t sampled  = ptm::get_live_sample_count();
+    if(sampled < expected / 4 || sampled > expected * 4) {
+        printf("heap profiler sampled %zu allocations, expected about %zu\n", sampled, expected);
+        exit(EXIT_FAILURE);
+    }
+
+    const char* path = "/tmp/portem_test_heap_profile";
+    double      window_seconds = 0.0;
+    if(!ptm::write_heap_profile(path) || !ptm::write_allocation_profile(path, &window_seconds) || window_seconds <= 0.0) {
+        printf("heap profiler could not write a profile\n");
+        exit(EXIT_FAILURE);
+    }
+
+    char header[64] = {};
+    FILE* file = fopen(path, "r");
+    fgets(header, sizeof(header), file);
+    fclose(file);
+    remove(path);
+
+    if(strncmp(header, "heap profile: ", 14) != 0 || !strstr(header, "@ heap_v2/4096")) {
+        printf("heap profile has the wrong header: %s\n", header);
+        exit(EXIT_FAILURE);
+    }
+
+    for(object_t* object : objects)
+        pool.destroy(object, 1);
+    while(stack.pop());
+
+    if(ptm::get_live_sample_count() != 0) {
+        printf("heap profiler missed frees of sampled allocations\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ptm::stop_heap_profiler();
+}
+
+// allocates and frees test_size elements in a shuffled order, checking no element is handed out twice
+template<typename pool_t>
+void test_basic_pool_churn(pool_t& pool, size_t test_size, const char* name) {
+    std::vector<uint64_t*> elements;
+    std::set<uint64_t*>    live;
+
+    for(size_t round = 0; round < 4; round++) {
+        for(size_t i = 0; i < test_size; i++) {
+            uint64_t* element = pool.allocate(1);
+            if(!element || !live.insert(element).second || !pool.owns(element)) {
+                printf("basic_pool_t %s handed out a bad element\n", name);
+                exit(EXIT_FAILURE);
             }
+
+            *element = (uint64_t)element;
+            elements.push_back(element);
         }
 
-        for(uint32_t i = 0; i < test_size; i++) {
-            if(!test_values[i])
-                continue;
+        // free every other element so the pool has holes to fit into
+        for(size_t i = 0; i < elements.size(); i += 2) {
+            if(*elements[i] != (uint64_t)elements[i]) {
+                printf("basic_pool_t %s elements overlap\n", name);
+                exit(EXIT_FAILURE);
+            }
 
-            for(uint32_t j = 0; j < 10; j++) {
-                if(test_values[i][j] != const_values[i]) {
-                    printf("a value was found that was not valid\n");
+            live.erase(elements[i]);
+            pool.deallocate(elements[i], 1);
+        }
 
-                    for(auto ptr : test_values)
-                        rda.deallocate<T>(ptr, 10);
+        std::vector<uint64_t*> kept;
+        for(size_t i = 1; i < elements.size(); i += 2)
+            kept.push_back(elements[i]);
+        elements = std::move(kept);
+    }
 
-                    exit(EXIT_FAILURE);
-                }
+    for(uint64_t* element : elements)
+        pool.deallocate(element, 1);
+}
+
+void test_basic_pool(size_t test_size) {
+    namespace policy = ptm::pool_policy;
+
+    {
+        ptm::basic_pool_t<uint64_t> pool(64);
+        test_basic_pool_churn(pool, test_size, "first fit");
+    }
+
+    {
+        ptm::basic_pool_t<uint64_t, policy::next_fit_t, policy::linear_growth_t, policy::mutex_locked_t> pool(64);
+        test_basic_pool_churn(pool, test_size, "next fit");
+
+        // linear growth adds chunks of the initial size
+        if(pool.get_capacity() != pool.get_chunk_count() * 64) {
+            printf("basic_pool_t linear growth made chunks of the wrong size\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    {
+        ptm::basic_pool_t<uint64_t, policy::best_fit_t, policy::virtual_memory_backed_t, policy::counted_stats_t> pool(256);
+
+        // leave a hole of 8 and a hole of 3, a run of 3 must go in the smaller one
+        uint64_t* first  = pool.allocate(10);
+        uint64_t* hole   = pool.allocate(8);
+        uint64_t* middle = pool.allocate(1);
+        uint64_t* small  = pool.allocate(3);
+        uint64_t* last   = pool.allocate(1);
+        pool.deallocate(hole, 8);
+        pool.deallocate(small, 3);
+
+        if(pool.allocate(3) != small || pool.allocate(8) != hole) {
+            printf("basic_pool_t best fit did not pick the smallest hole\n");
+            exit(EXIT_FAILURE);
+        }
+
+        pool.deallocate(first, 10);
+        pool.deallocate(middle, 1);
+        pool.deallocate(last, 1);
+        pool.deallocate(small, 3);
+        pool.deallocate(hole, 8);
+
+        test_basic_pool_churn(pool, test_size, "best fit");
+
+        ptm::pool_stats_t stats = pool.get_stats();
+        if(stats.live_elements != 0 || stats.allocations != stats.deallocations || stats.peak_live_elements < test_size) {
+            printf("basic_pool_t stats are wrong\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    {
+        // a fixed size pool runs out instead of growing
+        ptm::basic_pool_t<object_t, policy::fixed_size_t, policy::aligned_t<128>> pool(test_size / 10);
+        std::vector<object_t*> objects;
+
+        while(object_t* object = pool.create()) {
+            if((size_t)object % 128 != 0) {
+                printf("basic_pool_t element is not aligned\n");
+                exit(EXIT_FAILURE);
             }
+
+            objects.push_back(object);
         }
 
-        for(auto ptr : test_values) {
-            if(ptr)
-                rda.deallocate<T>(ptr, 10);
+        if(objects.size() != test_size / 10 || pool.get_chunk_count() != 1) {
+            printf("basic_pool_t fixed size pool grew\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for(object_t* object : objects)
+            pool.destroy(object);
+    }
+
+    {
+        ptm::basic_pool_t<uint64_t, policy::lock_free_t, policy::counted_stats_t> pool(16);
+        constexpr size_t thread_count = 4;
+
+        std::vector<std::thread> threads;
+        std::atomic<bool>        failed = false;
+
+        for(size_t t = 0; t < thread_count; t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<uint64_t*> elements;
+
+                for(size_t round = 0; round < 8; round++) {
+                    for(size_t i = 0; i < test_size / 4; i++) {
+                        uint64_t* element = pool.allocate();
+                        *element = t;
+                        elements.push_back(element);
+                    }
+
+                    for(uint64_t* element : elements) {
+                        if(*element != t)
+                            failed = true;
+                        pool.deallocate(element);
+                    }
+                    elements.clear();
+                }
+            });
+        }
+
+        for(std::thread& thread : threads)
+            thread.join();
+
+        if(failed || pool.get_stats().live_elements != 0 || pool.get_stats().allocations != thread_count * 8 * (test_size / 4)) {
+            printf("basic_pool_t lock free pool shared an element between threads\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void test_pool_sizing(size_t test_size) {
+    const char* path = "/tmp/portem_test_pool_sizes";
+
+    {
+        ptm::object_pool_t<object_t> pool(16, "test objects");
+        ptm::rda_t                   rda;
+        rda.register_type<uint64_t>(16, "test rda values");
+
+        std::vector<object_t*> objects;
+        std::vector<uint64_t*> values;
+        for(size_t i = 0; i < test_size; i++) {
+            objects.push_back(pool.create(1));
+            values.push_back(rda.create<uint64_t>(1));
+        }
+
+        // half go away, the peak stays
+        for(size_t i = 0; i < test_size / 2; i++)
+            pool.destroy(objects[i], 1);
+
+        ptm::pool_usage_t usage = ptm::get_pool_usage("test objects");
+        if(usage.pools != 1 || usage.peak_live_elements != test_size || usage.live_elements != test_size - test_size / 2 || usage.allocations != test_size) {
+            printf("pool sizing recorded the wrong usage\n");
+            exit(EXIT_FAILURE);
+        }
+
+        if(!ptm::save_pool_sizes(path)) {
+            printf("pool sizing could not save a profile\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for(size_t i = test_size / 2; i < test_size; i++)
+            pool.destroy(objects[i], 1);
+        for(uint64_t* value : values)
+            rda.destroy(value, 1);
+    }
+
+    if(!ptm::load_pool_sizes(path) || ptm::get_learned_pool_size("test objects") != test_size ||
+       ptm::get_learned_pool_size("test rda values") != test_size || ptm::get_learned_pool_size("unknown") != 0) {
+        printf("pool sizing did not load what it saved\n");
+        exit(EXIT_FAILURE);
+    }
+    remove(path);
+
+    // the next run starts with the learned size in one sub pool
+    ptm::_impl_sparse_memory_pool_t learned(sizeof(object_t), 16, "test objects");
+    std::vector<void*> elements;
+    for(size_t i = 0; i < test_size; i++)
+        elements.push_back(learned.allocate(1));
+
+    if(learned.get_sub_pool_count() != 1) {
+        printf("pool sizing did not preallocate the learned size\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // past the learned size it grows from its usage, and always fits the request
+    void* beyond = learned.allocate(test_size / 4);
+    if(!beyond || learned.get_sub_pool_count() != 2) {
+        printf("pool sizing did not grow past the learned size\n");
+        exit(EXIT_FAILURE);
+    }
+
+    learned.deallocate(beyond, test_size / 4);
+    for(void* element : elements)
+        learned.deallocate(element, 1);
+
+    {
+        // a pool filled slowly still grows geometrically, a horizon this short makes every fill look slow
+        ptm::set_pool_growth_horizon(1e-9);
+
+        ptm::_impl_sparse_memory_pool_t slow(8, 150, "test slow pool");
+        std::vector<void*> slow_elements;
+        for(size_t i = 0; i < test_size * 10; i++)
+            slow_elements.push_back(slow.allocate(1));
+
+        // 1.5 times bigger each time at least, so about log1.5(10000 / 150) of them
+        if(slow.get_sub_pool_count() > 16) {
+            printf("pool sizing shrank the sub pools of a slowly growing pool, %zu of them\n", slow.get_sub_pool_count());
+            exit(EXIT_FAILURE);
         }
+
+        void* run = slow.allocate(32);
+        if(slow.get_large_allocation_count() != 0) {
+            printf("pool sizing sent a small request to its own mapping\n");
+            exit(EXIT_FAILURE);
+        }
+
+        slow.deallocate(run, 32);
+        for(void* element : slow_elements)
+            slow.deallocate(element, 1);
+
+        ptm::set_pool_growth_horizon(ptm::default_pool_growth_horizon);
+    }
+
+    if(ptm::load_pool_sizes("/nonexistent/portem_pool_sizes") || ptm::get_learned_pool_size("test objects") != test_size) {
+        printf("pool sizing lost the profile loading a missing file\n");
+        exit(EXIT_FAILURE);
     }
 }
 
+// every live allocation, even of zero bytes, must be its own. Run under
+// portem_malloc by test_field_portem_malloc
+void test_zero_byte_aligned_allocations(size_t test_size) {
+    for(size_t alignment : {16, 32, 64, 256}) {
+        std::set<void*> live;
+
+        for(size_t i = 0; i < test_size; i++) {
+            void* ptr = aligned_alloc(alignment, 0);
+            if(!ptr)
+                continue;
+
+            if((size_t)ptr % alignment != 0 || !live.insert(ptr).second) {
+                printf("aligned_alloc(%zu, 0) handed out a live allocation again\n", alignment);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        for(void* ptr : live)
+            free(ptr);
+    }
+}
 
 int main() {
     constexpr size_t test_size = 1000;
@@ -183,11 +2000,154 @@ int main() {
         printf("success\n\n");
     }
 
+    printf("# testing small_list_t with non trivial types #\n");
+    test_small_list(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing inplace_vector_t #\n");
+    test_inplace_vector(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing flat_hash_map_t #\n");
+    test_flat_hash_map<false>(test_size);
+    test_flat_hash_map<true>(test_size);
+
+    printf("success\n\n");
+
     printf("# testing memory pool and object pool #\n");
     test_memory_pool<object_t>(test_size);
 
     printf("success\n\n");
 
+    printf("# testing continuous pool tail #\n");
+    test_continuous_pool_tail(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing bitmap search #\n");
+    test_bitmap<uint8_t>(test_size * 10);
+    test_bitmap<uint64_t>(test_size * 10);
+
+    printf("success\n\n");
+
+
+    printf("# testing create_near #\n");
+    test_create_near(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing bulk create #\n");
+    test_bulk_create(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing recycling object pool #\n");
+    test_recycling_object_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing intrusive list #\n");
+    test_intrusive_list(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing composable allocator #\n");
+    test_composable_allocator(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing lru cache #\n");
+    test_lru_cache(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing smart pointers #\n");
+    test_smart_pointers(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing io buffer pool #\n");
+    test_io_buffer_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing pool sizing #\n");
+    test_pool_sizing(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing heap profiler #\n");
+    test_heap_profiler(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing zero byte aligned allocations #\n");
+    test_zero_byte_aligned_allocations(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing basic pool #\n");
+    test_basic_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing spsc ring #\n");
+    test_spsc_ring(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing mpmc ring #\n");
+    test_mpmc_ring(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing large allocations #\n");
+    test_large_allocations(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing reserved memory pool #\n");
+    test_reserved_memory_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing compressed object pool #\n");
+    test_compressed_object_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing owned object pool #\n");
+    test_owned_object_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing coroutine frame pool #\n");
+    test_coroutine_frame_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing persistent object pool #\n");
+    test_persistent_object_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing shared object pool #\n");
+    test_shared_object_pool(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing epoch reclamation #\n");
+    test_epoch(test_size);
+    test_epoch_stress(test_size);
+
+    printf("success\n\n");
+
+    printf("# testing archetype storage #\n");
+    test_archetype_storage(test_size);
+
+    printf("success\n\n");
 
     printf("# testing RDA #\n");
     ptm::rda_t rda;
@@ -198,6 +2158,15 @@ int main() {
     test_rda<uint32_t>(rda, test_size);
     test_rda<uint8_t>(rda, test_size);
 
+    // types that can't be moved can still be registered, they just can't be relocated
+    rda.register_type<std::mutex>(test_size);
+    std::mutex* mutex = rda.create<std::mutex>(1);
+    if(rda.get_type_info(rda.get_type_id<std::mutex>()).relocate) {
+        printf("RDA gave a non movable type a relocate function\n");
+        exit(EXIT_FAILURE);
+    }
+    rda.destroy(mutex, 1);
+
     printf("success\n\n");
 
     return 0;